@@ -1,11 +1,411 @@
 #include "opencv2/opencv.hpp"
 #include "Camera.h"
-#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
 
 using namespace cv;
 using namespace std;
 
+/*
+    棋盘格标定
+    主线程: 取图 -> 缩小成预览图 -> 交给预览检测线程(只保留最新一帧) -> 显示预览和最近一次的检测结果
+    预览检测线程: 在缩小的灰度图上粗找角点,不拖慢主线程的帧率
+    工作线程池: 对采纳的帧在原图上亚像素精化角点,异步保存图片
+    按c(或退出时)用采纳的全部帧调用calibrateCamera,输出重投影误差并写入标定文件,检测程序启动时用--camera读取
+*/
+
+// 标定参数
+struct CalibConfig
+{
+    Size pattern = Size(9, 6);           // 棋盘格内角点数(列,行)
+    float square = 0.02f;                // 方格边长(m)
+    string output = "camera.yaml";       // 标定文件
+    string save_dir = ".";               // 采纳的图片保存目录,为空时不保存
+    string images;                       // 不为空时从该目录的图片离线标定,不打开相机
+    int preview_width = 640;             // 预览检测图像宽度
+    int workers = 0;                     // 精化线程数,0为cpu核数-2
+    int min_views = 10;                  // 标定所需的最少帧数
+    double auto_interval = 0.0;          // 大于0时每隔该秒数自动采纳一帧
+    double min_motion = 20.0;            // 自动采纳时角点相对上一帧的最小平均位移(原图像素)
+};
+
+// 一次粗检测的结果
+struct CoarseResult
+{
+    Mat frame;                  // 原图(彩色)
+    bool found = false;         // 是否找到完整的棋盘格
+    vector<Point2f> corners;    // 原图坐标下的粗角点
+    uint64_t id = 0;            // 帧序号
+};
+
+// 精化后的一帧
+struct CalibView
+{
+    int index = 0;              // 采纳序号
+    vector<Point2f> corners;    // 原图坐标下的亚像素角点
+};
+
+// 在缩小的灰度图上粗找角点
+bool find_coarse_corners(const Mat &preview, Size pattern, double scale, vector<Point2f> &corners)
+{
+    Mat gray;
+    if (preview.channels() == 3)
+    {
+        cvtColor(preview, gray, COLOR_BGR2GRAY);
+    }
+    else
+    {
+        gray = preview;
+    }
+
+    // FAST_CHECK: 画面中没有棋盘格时很快返回
+    bool found = findChessboardCorners(gray, pattern, corners,
+                                       CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE | CALIB_CB_FAST_CHECK);
+    for (Point2f &point : corners)
+    {
+        point *= static_cast<float>(1.0 / scale);
+    }
+    return found;
+}
+
+// 在原图上亚像素精化,粗角点来自缩小的图,搜索窗口按缩放比例放大
+void refine_corners(const Mat &frame, double scale, vector<Point2f> &corners)
+{
+    Mat gray;
+    cvtColor(frame, gray, COLOR_BGR2GRAY);
+    int half = max(5, cvRound(2.0 / scale));
+    cornerSubPix(gray, corners, Size(half, half), Size(-1, -1),
+                 TermCriteria(TermCriteria::EPS + TermCriteria::COUNT, 40, 0.01));
+}
+
+// 预览检测线程: submit覆盖尚未处理的旧帧,latest取最近一次的结果
+class PreviewDetector
+{
+public:
+    PreviewDetector(Size pattern, double scale) : m_pattern(pattern), m_scale(scale)
+    {
+        m_thread = thread(&PreviewDetector::run, this);
+    }
+
+    ~PreviewDetector()
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+    void submit(const Mat &frame, const Mat &preview, uint64_t id)
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_frame = frame;
+            m_preview = preview;
+            m_id = id;
+            m_has_job = true;
+        }
+        m_cv.notify_one();
+    }
+
+    CoarseResult latest()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        return m_result;
+    }
+
+private:
+    Size m_pattern;
+    double m_scale;
+    thread m_thread;
+    mutex m_mutex;
+    condition_variable m_cv;
+    bool m_running = true;
+    bool m_has_job = false;
+    Mat m_frame, m_preview;
+    uint64_t m_id = 0;
+    CoarseResult m_result;
+
+    void run()
+    {
+        while (true)
+        {
+            CoarseResult result;
+            Mat preview;
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_has_job || !m_running; });
+                if (!m_running)
+                {
+                    break;
+                }
+                result.frame = std::move(m_frame);
+                result.id = m_id;
+                preview = std::move(m_preview);
+                m_has_job = false;
+            }
+
+            result.found = find_coarse_corners(preview, m_pattern, m_scale, result.corners);
+
+            lock_guard<mutex> lock(m_mutex);
+            m_result = std::move(result);
+        }
+    }
+};
+
+// 精化线程池: 精化角点并保存图片,结果收集到views中
+class RefinePool
+{
+public:
+    RefinePool(int workers, double scale, Size pattern, const string &save_dir)
+        : m_scale(scale), m_pattern(pattern), m_save_dir(save_dir)
+    {
+        for (int i = 0; i < workers; i++)
+        {
+            m_threads.emplace_back(&RefinePool::run, this);
+        }
+    }
+
+    ~RefinePool()
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_cv.notify_all();
+        for (thread &t : m_threads)
+        {
+            t.join();
+        }
+    }
+
+    // 采纳一帧; corners为空时先在该帧上粗检测(离线标定)
+    void submit(const Mat &frame, const vector<Point2f> &corners)
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_jobs.push(Job{frame, corners, m_submitted++});
+        }
+        m_cv.notify_one();
+    }
+
+    // 等待全部任务完成
+    void wait_idle()
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_idle_cv.wait(lock, [this] { return m_jobs.empty() && m_busy == 0; });
+    }
+
+    // 已精化完成的帧,按采纳顺序排列
+    vector<CalibView> get_views()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        vector<CalibView> views = m_views;
+        sort(views.begin(), views.end(), [](const CalibView &a, const CalibView &b) { return a.index < b.index; });
+        return views;
+    }
+
+    int get_pending()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        return static_cast<int>(m_jobs.size()) + m_busy;
+    }
+
+private:
+    struct Job
+    {
+        Mat frame;
+        vector<Point2f> corners;
+        int index;
+    };
+
+    double m_scale;
+    Size m_pattern;
+    string m_save_dir;
+    vector<thread> m_threads;
+    mutex m_mutex;
+    condition_variable m_cv, m_idle_cv;
+    queue<Job> m_jobs;
+    vector<CalibView> m_views;
+    int m_submitted = 0;
+    int m_busy = 0;
+    bool m_running = true;
+
+    void run()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return !m_jobs.empty() || !m_running; });
+                if (m_jobs.empty())
+                {
+                    break;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop();
+                m_busy++;
+            }
+
+            bool ok = true;
+            if (job.corners.empty())
+            {
+                Mat preview;
+                resize(job.frame, preview, Size(), m_scale, m_scale, INTER_AREA);
+                ok = find_coarse_corners(preview, m_pattern, m_scale, job.corners);
+            }
+            if (ok)
+            {
+                refine_corners(job.frame, m_scale, job.corners);
+                if (!m_save_dir.empty())
+                {
+                    imwrite(m_save_dir + "/" + to_string(job.index + 1) + ".jpg", job.frame);
+                }
+            }
+
+            lock_guard<mutex> lock(m_mutex);
+            if (ok)
+            {
+                m_views.push_back(CalibView{job.index, std::move(job.corners)});
+            }
+            m_busy--;
+            if (m_jobs.empty() && m_busy == 0)
+            {
+                m_idle_cv.notify_all();
+            }
+        }
+    }
+};
+
+// 用采纳的帧标定,输出重投影误差并写入标定文件
+bool run_calibration(const CalibConfig &config, const vector<CalibView> &views, Size image_size)
+{
+    if (static_cast<int>(views.size()) < config.min_views)
+    {
+        cout << "有效帧数" << views.size() << "少于" << config.min_views << ",不进行标定" << endl;
+        return false;
+    }
+
+    // 棋盘格角点的3D坐标(z=0平面)
+    vector<Point3f> board;
+    for (int r = 0; r < config.pattern.height; r++)
+    {
+        for (int c = 0; c < config.pattern.width; c++)
+        {
+            board.emplace_back(c * config.square, r * config.square, 0.0f);
+        }
+    }
+    vector<vector<Point3f>> object_points(views.size(), board);
+    vector<vector<Point2f>> image_points;
+    for (const CalibView &view : views)
+    {
+        image_points.push_back(view.corners);
+    }
+
+    Mat K, D, std_intrinsics, std_extrinsics, per_view_errors;
+    vector<Mat> rvecs, tvecs;
+    cout << "使用" << views.size() << "帧标定..." << endl;
+    double rms = calibrateCamera(object_points, image_points, image_size, K, D, rvecs, tvecs,
+                                 std_intrinsics, std_extrinsics, per_view_errors);
+
+    // 重投影误差报告: 总体RMS和误差最大的几帧
+    cout << "重投影误差RMS: " << rms << " 像素" << endl;
+    vector<int> order(views.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = static_cast<int>(i);
+    }
+    sort(order.begin(), order.end(), [&](int a, int b) { return per_view_errors.at<double>(a) > per_view_errors.at<double>(b); });
+    cout << "误差最大的帧:" << endl;
+    for (size_t i = 0; i < min<size_t>(5, order.size()); i++)
+    {
+        cout << "  " << views[order[i]].index + 1 << ".jpg: " << per_view_errors.at<double>(order[i]) << " 像素" << endl;
+    }
+    cout << "K = " << endl << K << endl << "D = " << D << endl;
+
+    // 写入标定文件,键名与CameraModel::load一致
+    FileStorage fs(config.output, FileStorage::WRITE);
+    if (!fs.isOpened())
+    {
+        cout << "无法写入标定文件：" << config.output << endl;
+        return false;
+    }
+    time_t now = time(nullptr);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+    fs << "calibration_time" << date;
+    fs << "image_width" << image_size.width;
+    fs << "image_height" << image_size.height;
+    fs << "board_width" << config.pattern.width;
+    fs << "board_height" << config.pattern.height;
+    fs << "square_size" << config.square;
+    fs << "views" << static_cast<int>(views.size());
+    fs << "rms" << rms;
+    fs << "camera_matrix" << K;
+    fs << "dist_coeffs" << D;
+    fs << "per_view_errors" << per_view_errors;
+    cout << "标定结果已写入" << config.output << ", 检测程序使用 --camera " << config.output << " 读取" << endl;
+    return true;
+}
+
+// 离线标定: 图片目录中的全部图片交给线程池检测和精化
+int calibrate_images(const CalibConfig &config)
+{
+    vector<String> files;
+    glob(config.images + "/*.jpg", files);
+    if (files.empty())
+    {
+        cout << "目录中没有jpg图片：" << config.images << endl;
+        return 1;
+    }
+
+    Size image_size;
+    double scale = 1.0;
+    unique_ptr<RefinePool> pool;
+    for (const String &file : files)
+    {
+        Mat frame = imread(file);
+        if (frame.empty())
+        {
+            continue;
+        }
+        if (!pool)
+        {
+            image_size = frame.size();
+            scale = min(1.0, static_cast<double>(config.preview_width) / image_size.width);
+            pool = make_unique<RefinePool>(config.workers, scale, config.pattern, "");
+        }
+        if (frame.size() != image_size)
+        {
+            cout << "分辨率不一致,跳过：" << file << endl;
+            continue;
+        }
+        pool->submit(frame, vector<Point2f>());
+    }
+    if (!pool)
+    {
+        return 1;
+    }
+    pool->wait_idle();
+    vector<CalibView> views = pool->get_views();
+    cout << files.size() << "张图片中找到棋盘格" << views.size() << "张" << endl;
+    return run_calibration(config, views, image_size) ? 0 : 1;
+}
+
 // 枚举相机设备，返回设备列表
 MV_CC_DEVICE_INFO_LIST get_device_list()
 {
@@ -37,8 +437,79 @@ MV_CC_DEVICE_INFO_LIST get_device_list()
     return device_list;
 }
 
-int main()
+// 两组角点的平均位移
+double mean_motion(const vector<Point2f> &a, const vector<Point2f> &b)
+{
+    if (a.size() != b.size() || a.empty())
+    {
+        return numeric_limits<double>::max();
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        sum += norm(a[i] - b[i]);
+    }
+    return sum / a.size();
+}
+
+int main(int argc, char const *argv[])
 {
+    // 命令行参数: --board <列x行> 内角点数, --square <m> 方格边长
+    //            --out <标定文件> --save-dir <目录> 采纳的图片保存位置(为空不保存)
+    //            --images <目录> 用目录中已有的图片离线标定
+    //            --preview-width <像素> 预览检测宽度, --workers <n> 精化线程数
+    //            --min-views <n> 最少帧数, --auto <秒> 自动采纳间隔
+    CalibConfig config;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--board" && i + 1 < argc)
+        {
+            sscanf(argv[++i], "%dx%d", &config.pattern.width, &config.pattern.height);
+        }
+        else if (arg == "--square" && i + 1 < argc)
+        {
+            config.square = stof(argv[++i]);
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            config.output = argv[++i];
+        }
+        else if (arg == "--save-dir" && i + 1 < argc)
+        {
+            config.save_dir = argv[++i];
+        }
+        else if (arg == "--images" && i + 1 < argc)
+        {
+            config.images = argv[++i];
+        }
+        else if (arg == "--preview-width" && i + 1 < argc)
+        {
+            config.preview_width = stoi(argv[++i]);
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            config.workers = stoi(argv[++i]);
+        }
+        else if (arg == "--min-views" && i + 1 < argc)
+        {
+            config.min_views = stoi(argv[++i]);
+        }
+        else if (arg == "--auto" && i + 1 < argc)
+        {
+            config.auto_interval = stod(argv[++i]);
+        }
+    }
+    if (config.workers <= 0)
+    {
+        config.workers = max(1, static_cast<int>(thread::hardware_concurrency()) - 2);
+    }
+
+    if (!config.images.empty())
+    {
+        return calibrate_images(config);
+    }
+
     // 初始化SDK
     MV_CC_Initialize();
 
@@ -60,24 +531,80 @@ int main()
     // 启动采集
     c1->camera_start_grab();
 
-    cv::Mat frame;
-    std::string imgname;
-    int f = 1;
+    cv::Mat frame = c1->camera_grab();
+    if (frame.empty())
+    {
+        cout << "相机取图失败" << endl;
+        return 1;
+    }
+    const Size image_size = frame.size();
+    const double scale = min(1.0, static_cast<double>(config.preview_width) / image_size.width);
+
+    PreviewDetector detector(config.pattern, scale);
+    RefinePool pool(config.workers, scale, config.pattern, config.save_dir);
+    cout << "s/空格: 采纳当前帧  c: 标定  ESC: 标定并退出" << endl;
+
+    uint64_t frame_id = 0;
+    uint64_t last_accepted_id = 0;
+    vector<Point2f> last_accepted_corners;
+    auto last_accept_time = chrono::steady_clock::now();
     while (1) // Show the image captured in the window and repeat
     {
         frame = c1->camera_grab(); // read
         if (frame.empty())
             break; // check if at end
-        cv::imshow("Camera", frame);
+
+        // 预览图同时用于显示和粗检测; 每帧新分配,检测线程可能还在读上一帧的预览图
+        Mat preview;
+        resize(frame, preview, Size(), scale, scale, INTER_AREA);
+        detector.submit(frame, preview, ++frame_id);
+
+        // 画出最近一次的检测结果(可能落后一两帧)
+        CoarseResult result = detector.latest();
+        Mat canvas = preview.clone();
+        if (!result.corners.empty())
+        {
+            vector<Point2f> shown = result.corners;
+            for (Point2f &point : shown)
+            {
+                point *= static_cast<float>(scale);
+            }
+            drawChessboardCorners(canvas, config.pattern, shown, result.found);
+        }
+        putText(canvas, format("views: %d  pending: %d", static_cast<int>(pool.get_views().size()), pool.get_pending()),
+                Point(10, 25), FONT_HERSHEY_SIMPLEX, 0.6, Scalar(0, 255, 0), 2);
+        cv::imshow("Camera", canvas);
+
         char key = waitKey(1);
         if (key == 27)
             break;
-        if (key == 's' || key == 'S')
+
+        // 采纳: 手动按键,或自动模式下间隔足够且棋盘格移动足够
+        bool accept = key == 's' || key == 'S' || key == ' ';
+        if (config.auto_interval > 0 &&
+            chrono::duration<double>(chrono::steady_clock::now() - last_accept_time).count() >= config.auto_interval &&
+            mean_motion(result.corners, last_accepted_corners) >= config.min_motion)
+        {
+            accept = true;
+        }
+        if (accept && result.found && result.id != last_accepted_id)
         {
-            imgname = to_string(f++) + ".jpg";
-            imwrite(imgname, frame);
+            pool.submit(result.frame, result.corners);
+            last_accepted_id = result.id;
+            last_accepted_corners = result.corners;
+            last_accept_time = chrono::steady_clock::now();
+        }
+
+        if (key == 'c' || key == 'C')
+        {
+            pool.wait_idle();
+            run_calibration(config, pool.get_views(), image_size);
         }
     }
+
+    // 退出前用全部采纳的帧标定一次
+    pool.wait_idle();
+    run_calibration(config, pool.get_views(), image_size);
     cout << "Finished writing" << endl;
     return 0;
-}
\ No newline at end of file
+}
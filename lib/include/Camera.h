@@ -30,8 +30,8 @@ class Camera
     
 
     private:
-    //滑动条初始值
-    int brightness = 50;
+    //滑动条初始值(显示线程写,取图线程读)
+    atomic<int> brightness{50};
     //原子变量（确保多线程同步）
     atomic<bool> is_running{true};
     //相机检查次数
@@ -76,6 +76,9 @@ class Camera
     //采集一帧图像(已转换为Mat格式)
     Mat camera_grab();
 
+    //采集一帧图像到img,尺寸不变时复用img的缓冲区(img不能与其他Mat共享数据)
+    void camera_grab(Mat& img);
+
     //显示图像
     void camera_display();
     
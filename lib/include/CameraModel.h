@@ -0,0 +1,75 @@
+#ifndef CAMERAMODEL_H
+#define CAMERAMODEL_H
+#include<opencv2/opencv.hpp>
+#include<memory>
+#include<string>
+#include<vector>
+
+/*
+    标定好的相机模型(内参矩阵 + 5参数畸变)
+    启动时按网格预计算 像素坐标→归一化去畸变坐标 的查找表,
+    之后每帧的关键点只需查表+双线性插值,不再对每个点迭代求逆畸变。
+    位姿解算在归一化平面上进行(内参为单位阵、无畸变),与畸变模型无关
+*/
+class CameraModel
+{
+    public:
+    //传入内参矩阵、畸变参数、图像分辨率,grid_step为查找表网格间距(像素)
+    CameraModel(const cv::Mat& camera_matrix,const cv::Mat& dist_coeffs,cv::Size image_size,int grid_step = 8);
+
+    //从标定文件读取(camera_matrix, dist_coeffs, image_width, image_height),失败返回nullptr
+    static std::shared_ptr<CameraModel> load(const std::string& yaml_path,int grid_step = 8);
+
+
+    private:
+    //相机内参矩阵(3x3,CV_64F)
+    cv::Mat my_camera_matrix;
+    //畸变参数(1x5,CV_64F)
+    cv::Mat my_dist_coeffs;
+    //图像分辨率
+    cv::Size my_image_size;
+    //内参
+    double my_fx = 0,my_fy = 0,my_cx = 0,my_cy = 0,my_skew = 0;
+    //畸变参数 k1 k2 p1 p2 k3
+    double my_k1 = 0,my_k2 = 0,my_p1 = 0,my_p2 = 0,my_k3 = 0;
+    //畸变参数超过5个且非零时,正向投影交给cv::projectPoints
+    bool my_simple_distortion = true;
+    //查找表网格间距、行列数
+    int my_grid_step = 8;
+    int my_grid_cols = 0;
+    int my_grid_rows = 0;
+    //查找表: 网格点(c*step, r*step)对应的归一化去畸变坐标,按行存放
+    std::vector<cv::Point2f> my_grid;
+
+    private:
+    //预计算查找表
+    void build_grid();
+
+    //查找表之外的点用OpenCV迭代求逆畸变
+    cv::Point2f undistort_slow(const cv::Point2f& pixel) const;
+
+
+    public:
+    //一批像素坐标→归一化去畸变坐标(可以原地转换)
+    void undistort_points(const cv::Point2f* pixels,cv::Point2f* normalized,size_t count) const;
+    void undistort_points(const std::vector<cv::Point2f>& pixels,std::vector<cv::Point2f>& normalized) const;
+
+    //归一化坐标→带畸变的像素坐标
+    cv::Point2f distort_point(const cv::Point2f& normalized) const;
+
+    //3D点投影到带畸变的图像上(用于画坐标轴等叠加显示)
+    void project_points(const std::vector<cv::Point3f>& object_points,const cv::Vec3d& rvec,const cv::Vec3d& tvec,std::vector<cv::Point2f>& pixels) const;
+
+    //平均焦距,用于把归一化平面上的误差换算成像素
+    double get_focal() const;
+
+    const cv::Mat& get_camera_matrix() const;
+
+    const cv::Mat& get_dist_coeffs() const;
+
+    cv::Size get_image_size() const;
+};
+
+
+
+#endif
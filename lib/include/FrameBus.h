@@ -0,0 +1,110 @@
+#ifndef FRAME_BUS_H
+#define FRAME_BUS_H
+#include<opencv2/core.hpp>
+#include<cstdint>
+#include<memory>
+#include<string>
+
+//共享内存帧总线: 采集进程把相机帧和元数据发布到POSIX共享内存中的环形槽位,
+//任意数量的本机进程(录像、调试显示、第二个检测器)只读映射后直接使用最新帧,不经过socket拷贝
+//每个槽位是一个seqlock: 写者从不等待读者,读者用完后检查序号确认期间没有被覆盖
+//新帧到达时写者通过futex唤醒等待的读者
+namespace FrameBus
+{
+
+//一帧的元数据
+struct FrameMeta
+{
+    uint64_t sequence = 0;      //帧序号,从1开始
+    int64_t timestamp_ns = 0;   //采集时刻(steady_clock,各进程可比较)
+    int32_t width = 0;          //宽
+    int32_t height = 0;         //高
+    int32_t type = 0;           //OpenCV类型(CV_8UC3等)
+    int32_t step = 0;           //每行字节数
+    uint32_t bytes = 0;         //图像数据字节数
+    uint32_t user = 0;          //调用者自定义的数据(如曝光)
+};
+
+//读者得到的零拷贝视图,image指向共享内存(只读)
+//写者最多再发布slot_count-1帧之后该槽位会被覆盖,用完后用Reader::still_valid检查
+struct FrameView
+{
+    FrameMeta meta;
+    cv::Mat image;
+    int slot = -1;              //槽位编号
+    uint64_t slot_version = 0;  //取得视图时槽位的seqlock序号
+};
+
+class Writer
+{
+    public:
+    //创建共享内存(同名的旧总线先删除),max_frame_bytes为一帧的最大字节数,失败返回nullptr
+    static std::unique_ptr<Writer> create(const std::string& name,size_t max_frame_bytes,int slot_count = 4);
+    ~Writer();
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    //拷贝一帧到下一个槽位并发布,不等待读者;帧超过max_frame_bytes时返回false
+    bool publish(const cv::Mat& frame,int64_t timestamp_ns,uint32_t user = 0);
+
+    //原地写入: 返回指向下一个槽位的Mat,调用者直接写入后调用commit发布(省去一次拷贝)
+    //超过max_frame_bytes时返回空Mat
+    cv::Mat begin_write(int rows,int cols,int type);
+    void commit(int64_t timestamp_ns,uint32_t user = 0);
+
+    //已发布的帧数
+    uint64_t get_published() const { return my_sequence; }
+    const std::string& get_name() const { return my_name; }
+
+    private:
+    Writer() = default;
+
+    std::string my_name;
+    void* my_base = nullptr;
+    size_t my_size = 0;
+    uint64_t my_sequence = 0;
+    int my_writing_slot = -1;
+    FrameMeta my_pending;
+};
+
+class Reader
+{
+    public:
+    //只读映射已有的总线,不存在或格式不符时返回nullptr
+    static std::unique_ptr<Reader> open(const std::string& name);
+    ~Reader();
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    //最新一帧的零拷贝视图,没有比after更新的帧时返回false
+    bool latest(FrameView& view,uint64_t after = 0) const;
+
+    //视图取得之后槽位是否没有被覆盖
+    bool still_valid(const FrameView& view) const;
+
+    //拷贝最新一帧(保证拷贝到的是完整的一帧),没有比after更新的帧时返回false
+    bool read_copy(cv::Mat& image,FrameMeta& meta,uint64_t after = 0) const;
+
+    //等待比after更新的帧,超时或写者已关闭返回false
+    bool wait(uint64_t after,int timeout_ms) const;
+
+    //最新一帧的序号,还没有帧时为0
+    uint64_t get_latest_sequence() const;
+
+    //写者已经关闭(进程退出前析构了Writer)
+    bool writer_closed() const;
+
+    int get_slot_count() const;
+
+    private:
+    Reader() = default;
+
+    void* my_base = nullptr;
+    size_t my_size = 0;
+};
+
+} // namespace FrameBus
+
+#endif
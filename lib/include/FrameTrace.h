@@ -0,0 +1,75 @@
+#ifndef FRAME_TRACE_H
+#define FRAME_TRACE_H
+#include<chrono>
+#include<cstdint>
+#include<string>
+
+//逐帧耗时追踪: 每个片段(span)记录名称、起止时间和所属帧号
+//每个线程写自己的环形缓冲区(单写者,无锁),写满后覆盖最旧的记录,保留最近几秒到几十秒
+//导出为Chrome trace_event格式的json,可以在ui.perfetto.dev或chrome://tracing中打开,按args.frame过滤某一帧
+//StageProfiler的STAGE_TIMER在追踪打开时同时写入片段,不需要再加一处计时
+namespace FrameTrace
+{
+
+//运行时开关(默认关闭,也可以用环境变量FRAME_TRACE=1打开)
+void set_enabled(bool enabled);
+bool is_enabled();
+
+//当前线程正在处理的帧号,之后记录的片段都标记为这一帧(0为不属于任何帧)
+void set_frame(uint64_t frame_id);
+uint64_t current_frame();
+
+//单调时钟(纳秒),与std::chrono::steady_clock相同
+inline int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//记录一个片段,name必须是静态字符串(只保存指针); arg_name非空时附加一个整数参数
+void record(const char* name,int64_t begin_ns,int64_t end_ns,const char* arg_name = nullptr,int64_t arg_value = 0);
+
+//导出全部线程缓冲区中的片段,成功返回写入的片段数,失败返回-1
+//同一帧在不同线程上的相邻片段用flow箭头连接
+long dump(const std::string& path);
+
+//收到signo信号时请求导出(信号处理函数只设置标志),由dump_if_requested在普通线程中完成写文件
+void install_signal_handler(int signo);
+
+//有导出请求时写入 prefix_时间.json,返回是否导出
+bool dump_if_requested(const std::string& prefix);
+
+//作用域片段
+class Span
+{
+    public:
+    explicit Span(const char* name)
+    : my_name(name),
+      my_begin(is_enabled() ? now_ns() : 0)
+    {
+    }
+
+    ~Span()
+    {
+        if(my_begin != 0)
+        {
+            record(my_name,my_begin,now_ns());
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    private:
+    const char* my_name;
+    int64_t my_begin;
+};
+
+}
+
+#define FRAME_TRACE_CONCAT_IMPL(a, b) a##b
+#define FRAME_TRACE_CONCAT(a, b) FRAME_TRACE_CONCAT_IMPL(a, b)
+
+//在当前作用域内记录一个片段(关闭时只有一次原子读)
+#define FRAME_TRACE_SPAN(name) ::FrameTrace::Span FRAME_TRACE_CONCAT(frame_trace_span_, __LINE__)(name)
+
+#endif
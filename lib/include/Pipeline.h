@@ -0,0 +1,403 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+#include"SpscQueue.h"
+#include<array>
+#include<atomic>
+#include<chrono>
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<string>
+#include<thread>
+#include<vector>
+
+//多线程流水线: 每个阶段一个线程(可绑核),相邻阶段之间是有界无锁队列
+//帧对象T依次流过各阶段,阶段函数原地修改T
+//队列和信箱都交换对象而不销毁,固定数量的T在流水线中循环使用,稳态下不再构造新的T;
+//因此数据源拿到的T带着之前某一帧的内容,需要覆盖用到的全部字段(缓冲区按原尺寸复用)
+namespace Pipeline
+{
+
+//输入队列满或有积压时的处理方式
+enum DropPolicy
+{
+    block = 0,      //上游等待,不丢帧
+    drop_newest,    //队列满时上游丢弃新帧
+    keep_latest,    //下游只处理最新的一帧,其余丢弃(队列满时新帧放入单帧信箱,覆盖信箱中更旧的帧)
+};
+
+//阶段输入队列的配置
+struct QueueConfig
+{
+    size_t depth = 2;//队列深度
+    DropPolicy policy = block;//丢帧策略
+};
+
+//一个阶段的统计
+struct StageStats
+{
+    std::string name;//阶段名称
+    int cpu = -1;//绑定的cpu,-1为不绑定
+    uint64_t items = 0;//处理的帧数
+    uint64_t dropped = 0;//在输入队列被丢弃的帧数
+    double busy_s = 0.0;//处理耗时
+    double wait_s = 0.0;//等待输入的时间
+    double blocked_s = 0.0;//等待下游队列的时间
+    double wall_s = 0.0;//运行时间
+    size_t queue_size = 0;//当前输入队列长度
+    size_t queue_depth = 0;//输入队列深度
+
+    //占用率: 处理耗时/运行时间
+    double occupancy() const { return wall_s > 0 ? busy_s / wall_s : 0.0; }
+};
+
+//把当前线程绑定到cpu上并命名,失败返回false
+bool pin_current_thread(int cpu,const std::string& name);
+
+//输出统计表格
+void print_stats(const std::vector<StageStats>& stats);
+
+//等待时的退避: 先让出时间片,多次之后短暂睡眠
+class Backoff
+{
+    public:
+    void pause();
+    void reset() { my_count = 0; }
+
+    private:
+    int my_count = 0;
+};
+
+template<typename T>
+class Pipeline
+{
+    public:
+    //阶段函数: 返回false表示丢弃该帧,不再交给下游
+    using StageFunc = std::function<bool(T&)>;
+    //数据源函数: 填充一帧(T可能是复用的旧帧),返回false表示数据源结束
+    using SourceFunc = std::function<bool(T&)>;
+    //线程启动函数: 各阶段线程绑核之后、处理第一帧之前调用,参数为阶段名称(用于设置调度策略等)
+    using ThreadInit = std::function<void(const std::string&)>;
+
+    Pipeline() = default;
+    ~Pipeline() { stop(); }
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    //设置数据源(第一个阶段)
+    void set_source(const std::string& name,SourceFunc func,int cpu = -1)
+    {
+        my_source = make_stage(name,cpu);
+        my_source->source = std::move(func);
+    }
+
+    //追加一个阶段,input为它的输入队列配置
+    void add_stage(const std::string& name,StageFunc func,QueueConfig input = QueueConfig(),int cpu = -1)
+    {
+        std::unique_ptr<Stage> stage = make_stage(name,cpu);
+        stage->func = std::move(func);
+        stage->config = input;
+        stage->input = std::make_unique<SpscQueue<T>>(input.depth);
+        my_stages.push_back(std::move(stage));
+    }
+
+    //设置线程启动函数,需在start之前调用
+    void set_thread_init(ThreadInit init)
+    {
+        my_thread_init = std::move(init);
+    }
+
+    //启动全部线程
+    void start()
+    {
+        my_running.store(true);
+        my_start_time = std::chrono::steady_clock::now();
+        for(size_t i = 0;i < my_stages.size();i++)
+        {
+            Stage* upstream = i > 0 ? my_stages[i - 1].get() : my_source.get();
+            Stage* output = i + 1 < my_stages.size() ? my_stages[i + 1].get() : nullptr;
+            my_stages[i]->thread = std::thread(&Pipeline::run_stage,this,my_stages[i].get(),upstream,output);
+        }
+        Stage* first = my_stages.empty() ? nullptr : my_stages[0].get();
+        my_source->thread = std::thread(&Pipeline::run_source,this,my_source.get(),first);
+    }
+
+    //请求立即停止,队列中的帧不再处理(任意线程包括阶段函数内都可调用)
+    void request_stop()
+    {
+        my_running.store(false);
+    }
+
+    bool is_running() const
+    {
+        return my_running.load();
+    }
+
+    //请求停止并等待全部线程退出
+    void stop()
+    {
+        request_stop();
+        wait();
+    }
+
+    //等待全部线程退出(数据源结束且各队列处理完,或request_stop之后)
+    void wait()
+    {
+        if(my_source && my_source->thread.joinable())
+        {
+            my_source->thread.join();
+        }
+        for(auto& stage : my_stages)
+        {
+            if(stage->thread.joinable())
+            {
+                stage->thread.join();
+            }
+        }
+    }
+
+    //各阶段的统计,数据源在第一个
+    std::vector<StageStats> get_stats() const
+    {
+        const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - my_start_time).count();
+        std::vector<StageStats> stats;
+        if(my_source)
+        {
+            stats.push_back(my_source->snapshot(wall_s));
+        }
+        for(const auto& stage : my_stages)
+        {
+            stats.push_back(stage->snapshot(wall_s));
+        }
+        return stats;
+    }
+
+    private:
+    struct Stage
+    {
+        std::string name;
+        int cpu = -1;
+        SourceFunc source;
+        StageFunc func;
+        QueueConfig config;
+        std::unique_ptr<SpscQueue<T>> input;
+        std::thread thread;
+        std::atomic<bool> finished{false};//线程已退出,下游取完队列后即可退出
+        std::atomic<uint64_t> items{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> wait_ns{0};
+        std::atomic<uint64_t> blocked_ns{0};
+        //keep_latest的单帧信箱: 输入队列满后上游把新帧放在这里,信箱非空时新帧都放进信箱,所以信箱中总是最新的一帧
+        //三缓冲无锁交接: 上游写latest_back槽位,下游读latest_front槽位,两边各用一次原子交换与中间槽位互换
+        //latest_middle低2位为中间槽位的下标,latest_fresh位表示中间槽位是上游放入后还没被取走的帧
+        std::array<T,3> latest_slots;
+        std::atomic<unsigned> latest_middle{1};
+        unsigned latest_back = 0;//只由上游线程访问
+        unsigned latest_front = 2;//只由本阶段线程访问
+
+        StageStats snapshot(double wall_s) const
+        {
+            StageStats stats;
+            stats.name = name;
+            stats.cpu = cpu;
+            stats.items = items.load(std::memory_order_relaxed);
+            stats.dropped = dropped.load(std::memory_order_relaxed);
+            stats.busy_s = busy_ns.load(std::memory_order_relaxed) * 1e-9;
+            stats.wait_s = wait_ns.load(std::memory_order_relaxed) * 1e-9;
+            stats.blocked_s = blocked_ns.load(std::memory_order_relaxed) * 1e-9;
+            stats.wall_s = wall_s;
+            stats.queue_size = input ? input->size() : 0;
+            stats.queue_depth = input ? input->capacity() : 0;
+            return stats;
+        }
+    };
+
+    static constexpr unsigned latest_fresh = 4;
+
+    std::unique_ptr<Stage> my_source;
+    std::vector<std::unique_ptr<Stage>> my_stages;
+    std::atomic<bool> my_running{false};
+    std::chrono::steady_clock::time_point my_start_time;
+    ThreadInit my_thread_init;
+
+    static std::unique_ptr<Stage> make_stage(const std::string& name,int cpu)
+    {
+        std::unique_ptr<Stage> stage = std::make_unique<Stage>();
+        stage->name = name;
+        stage->cpu = cpu;
+        return stage;
+    }
+
+    void init_thread(Stage* self)
+    {
+        pin_current_thread(self->cpu,self->name);
+        if(my_thread_init)
+        {
+            my_thread_init(self->name);
+        }
+    }
+
+    static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    //把一帧交给下游,按下游的丢帧策略处理队列满
+    void forward(Stage* self,Stage* output,T& item)
+    {
+        if(output == nullptr)
+        {
+            return;
+        }
+        if(output->config.policy == keep_latest)
+        {
+            //信箱非空时不再放入队列,否则队列中会有比信箱更新的帧
+            if((output->latest_middle.load(std::memory_order_acquire) & latest_fresh) || !output->input->try_push(item))
+            {
+                put_latest(output,item);
+            }
+            return;
+        }
+        if(output->input->try_push(item))
+        {
+            return;
+        }
+        if(output->config.policy == drop_newest)
+        {
+            output->dropped.fetch_add(1,std::memory_order_relaxed);
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Backoff backoff;
+        while(my_running.load(std::memory_order_relaxed) && !output->input->try_push(item))
+        {
+            backoff.pause();
+        }
+        self->blocked_ns.fetch_add(elapsed_ns(start),std::memory_order_relaxed);
+    }
+
+    //上游把新帧放入下游的信箱,覆盖的旧帧计为丢弃; item换回槽位中之前的对象,缓冲区可以复用
+    void put_latest(Stage* output,T& item)
+    {
+        std::swap(output->latest_slots[output->latest_back],item);
+        const unsigned previous = output->latest_middle.exchange(output->latest_back | latest_fresh,std::memory_order_acq_rel);
+        if(previous & latest_fresh)
+        {
+            output->dropped.fetch_add(1,std::memory_order_relaxed);
+        }
+        output->latest_back = previous & 3;
+    }
+
+    //下游取出信箱中的帧,信箱为空返回false; 只有下游会清除latest_fresh,看到它之后交换一定能取到新帧
+    bool take_latest(Stage* self,T& item)
+    {
+        if(!(self->latest_middle.load(std::memory_order_acquire) & latest_fresh))
+        {
+            return false;
+        }
+        const unsigned previous = self->latest_middle.exchange(self->latest_front,std::memory_order_acq_rel);
+        self->latest_front = previous & 3;
+        std::swap(item,self->latest_slots[self->latest_front]);
+        return true;
+    }
+
+    void run_source(Stage* self,Stage* output)
+    {
+        init_thread(self);
+        T item;//交给下游后换回的是下游用过的旧帧,下一帧复用它
+        while(my_running.load(std::memory_order_relaxed))
+        {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = self->source(item);
+            self->busy_ns.fetch_add(elapsed_ns(start),std::memory_order_relaxed);
+            if(!ok)
+            {
+                //数据源结束,下游处理完队列中的帧后依次退出
+                break;
+            }
+            self->items.fetch_add(1,std::memory_order_relaxed);
+            forward(self,output,item);
+        }
+        finish(self,output);
+    }
+
+    //线程退出时标记完成,最后一个阶段退出时整条流水线停止
+    void finish(Stage* self,Stage* output)
+    {
+        self->finished.store(true,std::memory_order_release);
+        if(output == nullptr)
+        {
+            request_stop();
+        }
+    }
+
+    //等待一帧输入,上游已结束且队列为空或被要求停止时返回false
+    bool wait_input(Stage* self,Stage* upstream,T& item)
+    {
+        Backoff backoff;
+        while(!self->input->try_pop(item))
+        {
+            if(take_latest(self,item))
+            {
+                return true;
+            }
+            if(!my_running.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+            //上游结束后再取一次,避免漏掉它退出前刚放入的帧
+            if(upstream->finished.load(std::memory_order_acquire))
+            {
+                return self->input->try_pop(item) || take_latest(self,item);
+            }
+            backoff.pause();
+        }
+        return true;
+    }
+
+    void run_stage(Stage* self,Stage* upstream,Stage* output)
+    {
+        init_thread(self);
+        T item;
+        while(my_running.load(std::memory_order_relaxed))
+        {
+            //等待输入
+            auto wait_start = std::chrono::steady_clock::now();
+            if(!wait_input(self,upstream,item))
+            {
+                break;
+            }
+
+            //只保留最新的一帧: 先取完队列,信箱中的帧比队列中的都新
+            if(self->config.policy == keep_latest)
+            {
+                while(self->input->try_pop(item))
+                {
+                    self->dropped.fetch_add(1,std::memory_order_relaxed);
+                }
+                if(take_latest(self,item))
+                {
+                    self->dropped.fetch_add(1,std::memory_order_relaxed);
+                }
+            }
+            self->wait_ns.fetch_add(elapsed_ns(wait_start),std::memory_order_relaxed);
+
+            auto start = std::chrono::steady_clock::now();
+            bool ok = self->func(item);
+            self->busy_ns.fetch_add(elapsed_ns(start),std::memory_order_relaxed);
+            self->items.fetch_add(1,std::memory_order_relaxed);
+            if(ok)
+            {
+                forward(self,output,item);
+            }
+        }
+        finish(self,output);
+    }
+};
+
+} // namespace Pipeline
+
+#endif
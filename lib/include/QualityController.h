@@ -0,0 +1,59 @@
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+//自适应质量控制: 按每帧的延迟(采集到结果)与预算比较,逐级降低处理质量,余量恢复后逐级回升
+//等级0为完整质量,等级越高降级越多; 每一级具体做什么由调用者决定,这里只决定当前的等级
+//判断使用最近window帧延迟的分位数,变更等级后清空窗口,窗口重新填满之前不再变更(新等级需要时间体现在延迟上)
+namespace QualityControl
+{
+
+struct QualityConfig
+{
+    double budget_ms = 8.0;//延迟预算
+    int levels = 1;//等级数(含等级0)
+    int window = 30;//判断使用的帧数
+    double quantile = 0.9;//窗口内延迟的分位数超过预算时降一级
+    double recover_ratio = 0.7;//分位数低于预算的该比例时开始计数
+    int recover_frames = 150;//连续这么多帧有余量时升一级(比降级慢,避免在两级之间来回切换)
+};
+
+class QualityController
+{
+    public:
+    explicit QualityController(const QualityConfig& config);
+
+    //记录一帧的延迟,必要时调整等级,返回调整后的等级; 只能由一个线程调用
+    int observe(double latency_ms);
+
+    //当前等级,任意线程可读
+    int level() const { return my_level.load(std::memory_order_relaxed); }
+
+    const QualityConfig& get_config() const { return my_config; }
+
+    //输出各等级的帧数、超出预算的帧数和等级变更次数
+    void print_stats() const;
+
+    private:
+    QualityConfig my_config;
+    std::atomic<int> my_level{0};
+    std::vector<double> my_window;//最近的延迟(环形)
+    size_t my_next = 0;//下一个写入位置
+    size_t my_filled = 0;//窗口中的有效帧数
+    std::vector<double> my_scratch;//求分位数用
+    int my_calm_frames = 0;//连续有余量的帧数
+    std::vector<uint64_t> my_level_frames;//各等级处理的帧数
+    uint64_t my_over_budget = 0;//延迟超出预算的帧数
+    uint64_t my_degrades = 0;
+    uint64_t my_recovers = 0;
+
+    double window_quantile();
+    void change_level(int level);
+};
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef RESULT_LINK_H
+#define RESULT_LINK_H
+#include<cstddef>
+#include<cstdint>
+#include<memory>
+#include<string>
+
+//检测和位姿结果的输出通道: 每帧一条固定布局的二进制消息,发给云台控制等下游进程
+//消息按本机字节序(小端)直接发送,发送路径上不分配内存
+//传输方式由Transport决定,目前有UDP和Unix数据报,串口等只需再实现一个Transport
+namespace ResultLink
+{
+
+const uint32_t MESSAGE_MAGIC = 0x4B4E4C52;//"RLNK"
+const uint16_t MESSAGE_VERSION = 2;//2: 消息头增加quality_level
+const int MAX_ARMORS = 16;//一条消息最多的装甲板数,多出的丢弃
+
+//一块装甲板
+struct ArmorRecord
+{
+    int16_t class_id = -1;      //类别
+    int16_t track_id = -1;      //跟踪编号,-1为未关联
+    uint8_t pose_valid = 0;     //位姿解算是否成功
+    uint8_t armor_type = 0;     //0小装甲板,1大装甲板
+    uint16_t reserved = 0;
+    float confidence = 0.0f;    //置信度
+    float keypoints[8] = {};    //四个角点的像素坐标(x0,y0,...,x3,y3),顺序同检测结果
+    float rvec[3] = {};         //旋转向量
+    float tvec[3] = {};         //平移向量(m)
+    float distance = 0.0f;      //距离(m)
+    float yaw = 0.0f;           //偏航角(deg)
+    float pitch = 0.0f;         //俯仰角(deg)
+    float roll = 0.0f;          //横滚角(deg)
+    float reprojection_error = 0.0f;//重投影误差(像素)
+};
+
+//消息头
+struct MessageHeader
+{
+    uint32_t magic = MESSAGE_MAGIC;
+    uint16_t version = MESSAGE_VERSION;
+    uint16_t count = 0;         //装甲板数
+    uint64_t frame_id = 0;      //帧序号
+    int64_t capture_ns = 0;     //采集时刻(steady_clock)
+    int64_t publish_ns = 0;     //发送时刻(steady_clock)
+    uint16_t quality_level = 0; //自适应质量等级,0为完整质量
+    uint16_t reserved[3] = {};
+};
+
+//一条完整的消息,实际只发送头和前count块装甲板
+struct Message
+{
+    MessageHeader header;
+    ArmorRecord armors[MAX_ARMORS];
+};
+
+//布局固定,接收端(包括其他语言)按这些大小解析
+static_assert(sizeof(ArmorRecord) == 88,"ArmorRecord布局改变时要修改MESSAGE_VERSION");
+static_assert(sizeof(MessageHeader) == 40,"MessageHeader布局改变时要修改MESSAGE_VERSION");
+
+//count块装甲板的消息字节数
+inline size_t message_bytes(int count)
+{
+    return sizeof(MessageHeader) + count * sizeof(ArmorRecord);
+}
+
+//steady_clock当前时刻(ns),与FrameBus的时间戳相同,本机各进程可直接比较
+int64_t now_ns();
+
+//传输方式
+class Transport
+{
+    public:
+    virtual ~Transport() = default;
+
+    //发送一条消息,不阻塞; 发送缓冲区满或对端不存在时返回false
+    virtual bool send(const void* data,size_t bytes) = 0;
+};
+
+//按地址打开发送端: udp://host:port 或 unix:///path/to/socket,失败返回nullptr
+std::unique_ptr<Transport> open_transport(const std::string& uri);
+
+//组装并发送消息,消息缓冲区是成员,每帧复用
+class Publisher
+{
+    public:
+    explicit Publisher(std::unique_ptr<Transport> transport);
+
+    //开始一帧,清空装甲板; quality_level为处理这一帧时的自适应质量等级
+    void begin(uint64_t frame_id,int64_t capture_ns,uint16_t quality_level = 0);
+
+    //追加一块装甲板,超过MAX_ARMORS时返回nullptr
+    ArmorRecord* add();
+
+    //写入发送时刻并发送
+    bool send();
+
+    uint64_t get_sent() const { return my_sent; }
+    uint64_t get_dropped() const { return my_dropped; }
+
+    private:
+    std::unique_ptr<Transport> my_transport;
+    Message my_message;
+    uint64_t my_sent = 0;
+    uint64_t my_dropped = 0;
+};
+
+//接收端,用于调试工具和下游进程
+class Receiver
+{
+    public:
+    //绑定地址: udp://host:port 或 unix:///path/to/socket(已存在的socket文件先删除),失败返回nullptr
+    static std::unique_ptr<Receiver> bind(const std::string& uri);
+    ~Receiver();
+
+    Receiver(const Receiver&) = delete;
+    Receiver& operator=(const Receiver&) = delete;
+
+    //等待一条消息,超时返回false; 格式不对的消息丢弃并计数
+    bool receive(Message& message,int timeout_ms);
+
+    uint64_t get_invalid() const { return my_invalid; }
+
+    private:
+    Receiver() = default;
+
+    int my_fd = -1;
+    std::string my_unix_path;
+    uint64_t my_invalid = 0;
+};
+
+} // namespace ResultLink
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+#include<cstddef>
+#include<cstdint>
+
+//后处理热点循环的SIMD内核
+//每个内核有scalar/SSE4.2/AVX2/AVX-512几种实现,启动时按CPUID选择一次,同一个程序可以部署到不同cpu的机器上
+//环境变量SIMD_KERNELS_ISA(scalar/sse4.2/avx2/avx512)可以强制使用较低的指令集,便于对比
+namespace Simd
+{
+
+//指令集
+enum Isa
+{
+    scalar = 0,
+    sse42,
+    avx2,
+    avx512,
+    isa_count,
+};
+
+//NMS用的框,按结构体数组存放(x1,y1,x2,y2为左上、右下角,area为面积)
+struct BoxesSoA
+{
+    const float* x1 = nullptr;
+    const float* y1 = nullptr;
+    const float* x2 = nullptr;
+    const float* y2 = nullptr;
+    const float* area = nullptr;
+};
+
+//一套内核的函数指针
+struct Kernels
+{
+    //按行扫描: 第row行(起始于data + row*stride)的第0个元素 >= thresh 时记下row,返回记下的行数
+    //indices至少能放rows个
+    int (*scan_strided)(const float* data,int rows,int stride,float thresh,int* indices);
+
+    //按列扫描: 对每一列求rows行(相邻两行相距row_stride)中的最大值和所在行,最大值 >= thresh 时记下该列
+    //indices/max_values/argmax至少能放cols个,只写入前"返回值"个
+    int (*scan_column_max)(const float* data,int rows,int cols,int row_stride,float thresh,
+                           int* indices,float* max_values,int* argmax);
+
+    //NMS: 第k个框与[begin,end)中每个框的IoU > iou_thresh 时令suppressed[i] = 1
+    void (*suppress_overlaps)(const BoxesSoA& boxes,int k,int begin,int end,float iou_thresh,uint8_t* suppressed);
+
+    //把pixels个3通道像素填成(c0,c1,c2)
+    void (*fill_u8c3)(uint8_t* dst,size_t pixels,uint8_t c0,uint8_t c1,uint8_t c2);
+
+    //颜色阈值(灯条): 像素的primary通道p >= min_value 且 饱和差max(p - s,0) >= min_diff(s为secondary通道)时mask为255,否则为0
+    //src为pixels个3通道像素,mask至少能放pixels个
+    void (*color_mask_u8c3)(const uint8_t* src,size_t pixels,int primary,int secondary,uint8_t min_value,uint8_t min_diff,uint8_t* mask);
+};
+
+//指令集名称
+const char* isa_name(Isa isa);
+
+//本程序编译进了该指令集的实现,且cpu支持
+bool isa_supported(Isa isa);
+
+//当前使用的指令集(第一次调用时按CPUID和环境变量选择)
+Isa get_isa();
+
+//手动选择指令集,不支持时退回到支持的最高一级
+void set_isa(Isa isa);
+
+//当前指令集的内核
+const Kernels& kernels();
+
+//指定指令集的内核(用于对比和自检),不支持时返回nullptr
+const Kernels* kernels_for(Isa isa);
+
+//用随机数据把每个支持的指令集与scalar对比,全部一致返回true
+bool self_check(bool verbose = true);
+
+} // namespace Simd
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+#include<atomic>
+#include<cstddef>
+#include<utility>
+#include<vector>
+
+//单生产者单消费者的有界无锁队列
+//生产者只写my_tail,消费者只写my_head,两者分开在不同缓存行上
+//放入和取出都与槽位交换对象而不销毁: 槽位中的旧对象换回给调用者,对象内的缓冲区可以循环复用
+template<typename T>
+class SpscQueue
+{
+    public:
+    explicit SpscQueue(size_t capacity)
+    : my_slots(capacity > 0 ? capacity : 1)
+    {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    //生产者调用,队列满时返回false且item不变; 成功时item换成槽位中消费者之前留下的对象
+    bool try_push(T& item)
+    {
+        const size_t tail = my_tail.load(std::memory_order_relaxed);
+        if(tail - my_head.load(std::memory_order_acquire) >= my_slots.size())
+        {
+            return false;
+        }
+        using std::swap;
+        swap(my_slots[tail % my_slots.size()],item);
+        my_tail.store(tail + 1,std::memory_order_release);
+        return true;
+    }
+
+    //消费者调用,队列空时返回false; 成功时item原来的对象留在槽位中,供生产者下次放入时换回
+    bool try_pop(T& item)
+    {
+        const size_t head = my_head.load(std::memory_order_relaxed);
+        if(head == my_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        using std::swap;
+        swap(item,my_slots[head % my_slots.size()]);
+        my_head.store(head + 1,std::memory_order_release);
+        return true;
+    }
+
+    //当前元素个数(近似值,任意线程可调用)
+    size_t size() const
+    {
+        return my_tail.load(std::memory_order_acquire) - my_head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+        return my_slots.size();
+    }
+
+    private:
+    //元素槽位
+    std::vector<T> my_slots;
+    //消费者位置
+    alignas(64) std::atomic<size_t> my_head{0};
+    //生产者位置
+    alignas(64) std::atomic<size_t> my_tail{0};
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef STAGE_PROFILER_H
+#define STAGE_PROFILER_H
+#include"FrameTrace.h"
+#include<array>
+#include<atomic>
+#include<chrono>
+#include<cstdint>
+#include<string>
+#include<thread>
+
+//各阶段耗时统计
+//每个线程写自己的直方图(无锁),报告线程汇总后输出p50/p90/p99/max和吞吐
+//编译时未定义STAGE_PROFILER_ENABLED则STAGE_TIMER不生成任何代码
+//FrameTrace打开时STAGE_TIMER同时记录逐帧片段(两者各自有运行时开关)
+namespace StageProfiler
+{
+
+//检测流程的各个阶段
+enum Stage
+{
+    grab = 0,   //取图
+    demosaic,   //拜尔转换
+    proposal,   //灯条候选区域
+    roi_crop,   //roi截取
+    letterbox,  //缩放+填充
+    infer,      //推理
+    decode,     //解码
+    nms,        //非极大值抑制
+    refine,     //级联第二级(裁剪区域精检)
+    pnp,        //位姿解算
+    draw,       //可视化
+    stage_count
+};
+
+//阶段名称
+const char* stage_name(Stage stage);
+
+//HDR式对数-线性分桶: 每个2的幂区间再分16份, 相对误差约6%, 最大约1100秒
+struct Histogram
+{
+    static constexpr int sub_bits = 4;
+    static constexpr int sub_count = 1 << sub_bits;
+    static constexpr int bucket_count = 37 * sub_count;
+
+    //纳秒值对应的桶
+    static int bucket_of(uint64_t ns);
+    //桶的代表值(区间中点,纳秒)
+    static uint64_t value_of(int bucket);
+};
+
+//运行时开关(默认关闭,也可以用环境变量STAGE_PROFILER=1打开)
+void set_enabled(bool enabled);
+bool is_enabled();
+
+//记录一次耗时(纳秒)
+void record(Stage stage, uint64_t ns);
+
+//开始周期性输出报告到控制台,csv_path非空时同时追加到csv文件
+void start_report(std::chrono::milliseconds period, const std::string& csv_path = "");
+
+//停止周期性报告
+void stop_report();
+
+//立即输出一次自上次报告以来的统计
+void report_now();
+
+//作用域计时器
+class ScopedTimer
+{
+    public:
+    explicit ScopedTimer(Stage stage)
+    : my_stage(stage),
+      my_profile(is_enabled()),
+      my_trace(FrameTrace::is_enabled()),
+      my_active(my_profile || my_trace)
+    {
+        if(my_active)
+        {
+            my_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        stop();
+    }
+
+    //提前结束计时(只记录一次)
+    void stop()
+    {
+        if(my_active)
+        {
+            auto end = std::chrono::steady_clock::now();
+            if(my_profile)
+            {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - my_start).count();
+                record(my_stage, static_cast<uint64_t>(ns));
+            }
+            if(my_trace)
+            {
+                FrameTrace::record(stage_name(my_stage),
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(my_start.time_since_epoch()).count(),
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end.time_since_epoch()).count());
+            }
+            my_active = false;
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+    Stage my_stage;
+    bool my_profile;
+    bool my_trace;
+    bool my_active;
+    std::chrono::steady_clock::time_point my_start;
+};
+
+}
+
+#define STAGE_PROFILER_CONCAT_IMPL(a, b) a##b
+#define STAGE_PROFILER_CONCAT(a, b) STAGE_PROFILER_CONCAT_IMPL(a, b)
+
+//在当前作用域内统计某阶段的耗时
+//STAGE_TIMER_NAMED/STAGE_TIMER_STOP用于在作用域结束前停止计时
+#ifdef STAGE_PROFILER_ENABLED
+#define STAGE_TIMER(stage) ::StageProfiler::ScopedTimer STAGE_PROFILER_CONCAT(stage_timer_, __LINE__)(::StageProfiler::stage)
+#define STAGE_TIMER_NAMED(name, stage) ::StageProfiler::ScopedTimer name(::StageProfiler::stage)
+#define STAGE_TIMER_STOP(name) name.stop()
+#else
+#define STAGE_TIMER(stage) ((void)0)
+#define STAGE_TIMER_NAMED(name, stage) ((void)0)
+#define STAGE_TIMER_STOP(name) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+#include<map>
+#include<string>
+#include<vector>
+
+//实时线程布局: 每个线程的cpu集合、SCHED_FIFO优先级,以及进程内存锁定
+//配置字符串: 名称=cpu列表[:优先级],多个线程用逗号分隔
+//  cpu列表: 单个cpu或范围,用+连接,如 0  2-3  1+4-5
+//  优先级: 1~99为SCHED_FIFO,省略或0为普通调度(只限定cpu)
+//  例: capture=0:80,preprocess=1:70,infer=2:70,postprocess=3:60,main=4,ov=5-7
+//约定的名称: 流水线阶段名(capture/preprocess/infer/postprocess), main为主线程, ov为OpenVINO工作线程
+namespace ThreadPlacement
+{
+
+//一个线程的布局
+struct ThreadSpec
+{
+    std::vector<int> cpus;//允许运行的cpu,为空时不限定
+    int priority = 0;//SCHED_FIFO优先级,0为普通调度
+
+    bool is_realtime() const { return priority > 0; }
+};
+
+//全部线程的布局
+class Config
+{
+    public:
+    //解析配置字符串,格式错误时返回false并输出原因
+    static bool parse(const std::string& text,Config& config);
+
+    //没有配置该名称时返回nullptr
+    const ThreadSpec* find(const std::string& name) const;
+    void set(const std::string& name,const ThreadSpec& spec) { my_specs[name] = spec; }
+    bool empty() const { return my_specs.empty(); }
+
+    //逐行输出布局
+    void print() const;
+
+    private:
+    std::map<std::string,ThreadSpec> my_specs;
+};
+
+//解析cpu列表(0  2-3  1+4-5)
+bool parse_cpu_list(const std::string& text,std::vector<int>& cpus);
+
+//cpu列表的文字形式,与parse_cpu_list的格式相同
+std::string format_cpu_list(const std::vector<int>& cpus);
+
+//当前线程命名,并按spec设置cpu集合和调度策略
+//失败时输出原因并返回false(没有CAP_SYS_NICE/RLIMIT_RTPRIO时无法使用SCHED_FIFO),线程按原来的方式继续运行
+bool apply_to_current_thread(const std::string& name,const ThreadSpec& spec);
+
+//锁定当前和以后分配的全部内存(mlockall),避免缺页带来的延迟; 受RLIMIT_MEMLOCK限制
+bool lock_memory();
+
+//作用域内把当前线程的cpu集合改为cpus,析构时恢复
+//新线程继承创建者的cpu集合,用于把第三方库(OpenVINO/相机SDK)在作用域内创建的线程限定在cpus上
+class ScopedAffinity
+{
+    public:
+    explicit ScopedAffinity(const std::vector<int>& cpus);
+    ~ScopedAffinity();
+
+    ScopedAffinity(const ScopedAffinity&) = delete;
+    ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+    private:
+    std::vector<int> my_saved;//原来的cpu集合
+    bool my_active = false;
+};
+
+} // namespace ThreadPlacement
+
+#endif
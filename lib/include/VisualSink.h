@@ -0,0 +1,222 @@
+#ifndef VISUAL_SINK_H
+#define VISUAL_SINK_H
+#include<opencv2/opencv.hpp>
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<condition_variable>
+#include<functional>
+#include<mutex>
+#include<string>
+#include<thread>
+
+//可视化: 无界面开关 + 独立线程的显示端
+//检测线程只做一次不阻塞的交接(只保留最新一帧),缩放、绘制、imshow、waitKey都在显示线程里按限定帧率进行
+namespace Visual
+{
+
+//无界面模式: 默认在没有DISPLAY/WAYLAND_DISPLAY时打开,也可以手动设置
+void set_headless(bool headless);
+bool is_headless();
+
+//显示端配置
+struct SinkConfig
+{
+    std::string window_name = "Detections";//窗口名称
+    cv::Size window_size = cv::Size(1200,900);//窗口尺寸
+    double max_fps = 15.0;//最高显示帧率
+    double scale = 0.5;//绘制前先缩小图像
+};
+
+template<typename Payload>
+class VisualSink
+{
+    public:
+    //在缩小后的图像上绘制,scale为相对原图的缩放比例
+    using DrawFunc = std::function<void(cv::Mat& img,const Payload& payload,double scale)>;
+    //窗口创建后在显示线程中调用一次(例如创建滑动条)
+    using SetupFunc = std::function<void(const std::string& window_name)>;
+
+    VisualSink(DrawFunc draw,const SinkConfig& config = SinkConfig(),SetupFunc setup = nullptr)
+    : my_draw(std::move(draw)),
+      my_setup(std::move(setup)),
+      my_config(config)
+    {
+    }
+
+    ~VisualSink()
+    {
+        stop();
+    }
+
+    VisualSink(const VisualSink&) = delete;
+    VisualSink& operator=(const VisualSink&) = delete;
+
+    //启动显示线程
+    void start()
+    {
+        my_running = true;
+        my_thread = std::thread(&VisualSink::run,this);
+    }
+
+    //停止显示线程并关闭窗口
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(my_mutex);
+            my_running = false;
+        }
+        my_cv.notify_one();
+        if(my_thread.joinable())
+        {
+            my_thread.join();
+        }
+    }
+
+    //距上次显示已超过1/max_fps,生产者据此决定是否准备这一帧的数据
+    bool wants_frame() const
+    {
+        return std::chrono::steady_clock::now() >= my_next_due.load(std::memory_order_relaxed);
+    }
+
+    //交给显示线程,覆盖尚未显示的旧帧;显示线程正持有锁时直接放弃这一帧,从不阻塞调用者
+    //frame只增加引用计数,调用者之后不能再修改它
+    void submit(const cv::Mat& frame,Payload&& payload)
+    {
+        std::unique_lock<std::mutex> lock(my_mutex,std::try_to_lock);
+        if(!lock.owns_lock())
+        {
+            my_dropped.fetch_add(1,std::memory_order_relaxed);
+            return;
+        }
+        if(my_has_frame)
+        {
+            my_dropped.fetch_add(1,std::memory_order_relaxed);
+        }
+        my_frame = frame;
+        my_payload = std::move(payload);
+        my_has_frame = true;
+        lock.unlock();
+        my_cv.notify_one();
+    }
+
+    //同submit,但与交接槽位交换frame和payload而不是共享/移走: 调用者换回槽位中的旧对象(未显示的旧帧或显示线程用过的缓冲区),
+    //可以直接复用其中的缓冲区; 没有交接成功时frame和payload不变
+    void submit_swap(cv::Mat& frame,Payload& payload)
+    {
+        std::unique_lock<std::mutex> lock(my_mutex,std::try_to_lock);
+        if(!lock.owns_lock())
+        {
+            my_dropped.fetch_add(1,std::memory_order_relaxed);
+            return;
+        }
+        if(my_has_frame)
+        {
+            my_dropped.fetch_add(1,std::memory_order_relaxed);
+        }
+        std::swap(my_frame,frame);
+        std::swap(my_payload,payload);
+        my_has_frame = true;
+        lock.unlock();
+        my_cv.notify_one();
+    }
+
+    //窗口中按下了ESC或q
+    bool quit_requested() const
+    {
+        return my_quit.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_shown() const { return my_shown.load(std::memory_order_relaxed); }
+    uint64_t get_dropped() const { return my_dropped.load(std::memory_order_relaxed); }
+
+    private:
+    DrawFunc my_draw;
+    SetupFunc my_setup;
+    SinkConfig my_config;
+    std::thread my_thread;
+    //交接槽位
+    std::mutex my_mutex;
+    std::condition_variable my_cv;
+    bool my_running = false;
+    bool my_has_frame = false;
+    cv::Mat my_frame;
+    Payload my_payload;
+    //下一次允许显示的时刻
+    std::atomic<std::chrono::steady_clock::time_point> my_next_due{std::chrono::steady_clock::time_point()};
+    std::atomic<bool> my_quit{false};
+    std::atomic<uint64_t> my_shown{0};
+    std::atomic<uint64_t> my_dropped{0};
+
+    void run()
+    {
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / std::max(1.0,my_config.max_fps)));
+
+        cv::namedWindow(my_config.window_name,cv::WINDOW_NORMAL);
+        cv::resizeWindow(my_config.window_name,my_config.window_size.width,my_config.window_size.height);
+        if(my_setup)
+        {
+            my_setup(my_config.window_name);
+        }
+
+        cv::Mat frame,canvas;
+        Payload payload;
+        while(true)
+        {
+            bool show = false;
+            {
+                //没有新帧时仍然定期waitKey,保持窗口响应
+                std::unique_lock<std::mutex> lock(my_mutex);
+                my_cv.wait_for(lock,period,[this]{ return my_has_frame || !my_running; });
+                if(!my_running)
+                {
+                    break;
+                }
+                if(my_has_frame)
+                {
+                    //交换: 上一帧用过的对象留在槽位中,submit_swap的调用者可以换回复用
+                    std::swap(frame,my_frame);
+                    std::swap(payload,my_payload);
+                    my_has_frame = false;
+                    show = !frame.empty();
+                }
+            }
+
+            const auto shown_at = std::chrono::steady_clock::now();
+            if(show)
+            {
+                //先缩小再绘制
+                if(my_config.scale > 0.0 && my_config.scale < 1.0)
+                {
+                    cv::resize(frame,canvas,cv::Size(),my_config.scale,my_config.scale,cv::INTER_AREA);
+                }
+                else
+                {
+                    canvas = frame.clone();
+                }
+                my_draw(canvas,payload,my_config.scale > 0.0 && my_config.scale < 1.0 ? my_config.scale : 1.0);
+                cv::imshow(my_config.window_name,canvas);
+                my_shown.fetch_add(1,std::memory_order_relaxed);
+                my_next_due.store(shown_at + period,std::memory_order_relaxed);
+            }
+
+            int key = cv::waitKey(1);
+            if(key == 27 || key == 'q')
+            {
+                my_quit.store(true,std::memory_order_relaxed);
+            }
+
+            //限制显示帧率
+            if(show)
+            {
+                std::this_thread::sleep_until(shown_at + period);
+            }
+        }
+        cv::destroyWindow(my_config.window_name);
+    }
+};
+
+} // namespace Visual
+
+#endif
@@ -1,4 +1,6 @@
 #include "Camera.h"
+#include "StageProfiler.h"
+#include "VisualSink.h"
 
 //初始化相机编号
 int Camera::camera_num = 0;
@@ -103,7 +105,7 @@ void Camera::camera_init()
 }
 
 //采集一帧图像(已转换为Mat格式)
-Mat Camera::camera_grab()
+void Camera::camera_grab(Mat& img)
 {
    lock_guard<mutex> lock(my_mtu);
    {
@@ -115,12 +117,23 @@ Mat Camera::camera_grab()
      }
 
      //获取一帧图像
+     STAGE_TIMER(grab);
      this->my_nRet = MV_CC_GetImageBuffer(my_handle,&(this->my_img),1000); 
    }
     
 
    check_camera(this->my_nRet);
 
+   //逐帧追踪: 帧到达主机(SDK的主机时间戳,毫秒精度)到被取走,这段时间帧在SDK缓存中排队
+   //曝光和USB传输在到达之前,相机时钟与主机时钟没有对齐,只记录相机帧号用于与相机侧对照
+   if(this->my_nRet == MV_OK && FrameTrace::is_enabled() && this->my_img.stFrameInfo.nHostTimeStamp > 0)
+   {
+       const int64_t now = FrameTrace::now_ns();
+       const int64_t system_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+       const int64_t queued_ns = (system_ms - this->my_img.stFrameInfo.nHostTimeStamp) * 1000000;
+       FrameTrace::record("sdk_queue",now - std::max<int64_t>(0,queued_ns),now,"camera_frame",this->my_img.stFrameInfo.nFrameNum);
+   }
+
    //打印这一帧图像的数据
    if(this->my_nRet!=MV_OK)
    {
@@ -132,14 +145,9 @@ Mat Camera::camera_grab()
     //设置插值方法(拜尔转换质量)为均衡模式
     this->my_nRet = MV_CC_SetBayerCvtQuality(this->my_handle, 1);
     check_camera(this->my_nRet);
-    //存储转换后的图像数据的指针
-    unsigned char *convert_data = NULL;
-    //记录需要分配的内存大小
-    unsigned int convert_size = 0;
-    //拜尔格式（单通道）转换成RGB格式（三通道）所以要多乘3
-    convert_size = this->my_img.stFrameInfo.nWidth * this->my_img.stFrameInfo.nHeight* 3;
-    convert_data = new unsigned char[convert_size];
 
+    //拜尔格式（单通道）转换成RGB格式（三通道）,直接写入img的缓冲区,尺寸不变时不重新分配
+    img.create(this->my_img.stFrameInfo.nHeight,this->my_img.stFrameInfo.nWidth,CV_8UC3);
 
     //像素格式转换结构体
     MV_CC_PIXEL_CONVERT_PARAM_EX convert_img = {0};
@@ -149,24 +157,24 @@ Mat Camera::camera_grab()
     convert_img.nSrcDataLen = this->my_img.stFrameInfo.nFrameLenEx;
     convert_img.enSrcPixelType = this->my_img.stFrameInfo.enPixelType;
     convert_img.enDstPixelType = PixelType_Gvsp_BGR8_Packed;
-    convert_img.pDstBuffer = convert_data;
-    convert_img.nDstBufferSize = convert_size;
+    convert_img.pDstBuffer = img.data;
+    convert_img.nDstBufferSize = static_cast<unsigned int>(img.total() * img.elemSize());
 
+    {
+        STAGE_TIMER(demosaic);
 
-    //转换像素格式成PixelType_Gvsp_BGR8_Packed
-    this->my_nRet = MV_CC_ConvertPixelTypeEx(this->my_handle,&convert_img);
-    check_camera(this->my_nRet);
+        //转换像素格式成PixelType_Gvsp_BGR8_Packed
+        this->my_nRet = MV_CC_ConvertPixelTypeEx(this->my_handle,&convert_img);
+        check_camera(this->my_nRet);
+    }
+}
 
+Mat Camera::camera_grab()
+{
+    //每次返回新分配的图像,调用者可以一直持有
     Mat src_img;
-    //深拷贝（让Mat自己管理内存,不然会出现段错误）
-    src_img = Mat(convert_img.nHeight,convert_img.nWidth,CV_8UC3,convert_data).clone();
-
-
-    //现在可以安全释放数据，因为Mat已经拷贝了数据
-    delete[] convert_data;
-
+    camera_grab(src_img);
     return src_img;
-
 }
 
 //停止采集
@@ -200,62 +208,72 @@ void Camera::brightness_callback(int pos,void* userdata)
 }
 
 //显示图像
+//取图在调用线程,亮度调节和显示在显示线程中按限定帧率进行,无界面模式下只提示并返回
 void Camera::camera_display()
 {
-    Mat src_img,dst_img;
-
-    cv::namedWindow("fuck",cv::WINDOW_NORMAL);
-    cv::resizeWindow("fuck",720,720);
-
-    //创建一个空窗口
-    namedWindow("亮度调节",(640,200));
-    cv::createTrackbar(
-        "亮度",       //滑动条名称
-        "亮度调节",   //所属窗口
-        NULL,       //原&brightness用法已弃用
-        100,          //滑动条最大值
-        brightness_callback, //回调函数
-        this        //userdata,传递当前Camera实例
-    );
-  
-    
-    float gain = brightness / 50.0f;
+    if(Visual::is_headless())
+    {
+        cout<<"无界面模式(或没有显示环境),camera_display不显示图像"<<endl;
+        return;
+    }
+
+    Visual::SinkConfig config;
+    config.window_name = "fuck";
+    config.window_size = Size(720,720);
+    config.max_fps = 30;
+
+    Visual::VisualSink<float> sink(
+        //将滑动条值（0-100）映射为亮度增益（0.0-2.0）
+        //亮度 = 原始像素值 * 增益,在缩小后的图像上做
+        [](Mat& img,const float& gain,double)
+        {
+            //-1表示输出图像类型与输入一致
+            img.convertTo(img,-1,gain,0);
+        },
+        config,
+        //窗口在显示线程中创建,滑动条也要在那里创建
+        [this](const std::string&)
+        {
+            //创建一个空窗口
+            namedWindow("亮度调节",WINDOW_NORMAL);
+            cv::createTrackbar(
+                "亮度",       //滑动条名称
+                "亮度调节",   //所属窗口
+                NULL,       //原&brightness用法已弃用
+                100,          //滑动条最大值
+                brightness_callback, //回调函数
+                this        //userdata,传递当前Camera实例
+            );
+            setTrackbarPos("亮度","亮度调节",brightness);
+        });
+    sink.start();
 
-    setTrackbarPos("亮度","亮度调节",brightness);
-    
     while (this->is_running)
     {
-        
-       //8 9 10 11
-       //读取一帧图像
-        
-        src_img = Camera::camera_grab();
+        //8 9 10 11
+        //读取一帧图像
+        Mat src_img = Camera::camera_grab();
 
-         //读取失败则跳过
+        //读取失败则跳过
         if(Camera::get_nRet()!=MV_OK)
-         {
-         continue;
-         }
-        
-        //将滑动条值（0-100）映射为亮度增益（0.0-2.0）
-        //亮度 = 原始像素值 * 增益
-        gain = brightness / 50.0f;
-        //-1表示输出图像类型与输入一致
-        src_img.convertTo(dst_img,-1,gain,0);
+        {
+            continue;
+        }
 
-         //显示图像
-        imshow("fuck",dst_img);
-        char key = waitKey(1);
+        if(sink.wants_frame())
+        {
+            sink.submit(src_img,brightness / 50.0f);
+        }
 
         //按ESC退出
-        if(key==27)
+        if(sink.quit_requested())
         {
             this->is_running = false;
             break;
         }
     }
+    sink.stop();
     destroyAllWindows();
-    
 }
 
 //调整曝光时间(微秒)
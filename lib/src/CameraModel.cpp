@@ -0,0 +1,175 @@
+#include "CameraModel.h"
+#include<algorithm>
+#include<iostream>
+
+//传入内参矩阵、畸变参数、图像分辨率,grid_step为查找表网格间距(像素)
+CameraModel::CameraModel(const cv::Mat& camera_matrix,const cv::Mat& dist_coeffs,cv::Size image_size,int grid_step)
+{
+    camera_matrix.convertTo(this->my_camera_matrix,CV_64F);
+    dist_coeffs.reshape(1,1).convertTo(this->my_dist_coeffs,CV_64F);
+    this->my_image_size = image_size;
+    this->my_grid_step = std::max(1,grid_step);
+
+    //与OpenCV一致,只使用fx fy cx cy(忽略斜切项)
+    this->my_fx = this->my_camera_matrix.at<double>(0,0);
+    this->my_fy = this->my_camera_matrix.at<double>(1,1);
+    this->my_cx = this->my_camera_matrix.at<double>(0,2);
+    this->my_cy = this->my_camera_matrix.at<double>(1,2);
+
+    const double* d = this->my_dist_coeffs.ptr<double>();
+    int n = this->my_dist_coeffs.cols;
+    this->my_k1 = n > 0 ? d[0] : 0;
+    this->my_k2 = n > 1 ? d[1] : 0;
+    this->my_p1 = n > 2 ? d[2] : 0;
+    this->my_p2 = n > 3 ? d[3] : 0;
+    this->my_k3 = n > 4 ? d[4] : 0;
+    for(int i = 5;i < n;i++)
+    {
+        if(d[i] != 0)
+        {
+            this->my_simple_distortion = false;
+        }
+    }
+
+    build_grid();
+}
+
+//从标定文件读取,失败返回nullptr
+std::shared_ptr<CameraModel> CameraModel::load(const std::string& yaml_path,int grid_step)
+{
+    cv::FileStorage fs(yaml_path,cv::FileStorage::READ);
+    if(!fs.isOpened())
+    {
+        std::cout<<"无法打开相机标定文件："<<yaml_path<<std::endl;
+        return nullptr;
+    }
+
+    cv::Mat camera_matrix,dist_coeffs;
+    int width = 0,height = 0;
+    fs["camera_matrix"]>>camera_matrix;
+    fs["dist_coeffs"]>>dist_coeffs;
+    fs["image_width"]>>width;
+    fs["image_height"]>>height;
+    if(camera_matrix.size() != cv::Size(3,3) || dist_coeffs.empty() || width <= 0 || height <= 0)
+    {
+        std::cout<<"相机标定文件缺少camera_matrix/dist_coeffs/image_width/image_height："<<yaml_path<<std::endl;
+        return nullptr;
+    }
+    return std::make_shared<CameraModel>(camera_matrix,dist_coeffs,cv::Size(width,height),grid_step);
+}
+
+//预计算查找表
+void CameraModel::build_grid()
+{
+    //网格覆盖到图像最后一行/列之外一格,保证图像内任意点都能插值
+    this->my_grid_cols = (this->my_image_size.width - 1) / this->my_grid_step + 2;
+    this->my_grid_rows = (this->my_image_size.height - 1) / this->my_grid_step + 2;
+
+    std::vector<cv::Point2f> pixels;
+    pixels.reserve(this->my_grid_cols * this->my_grid_rows);
+    for(int r = 0;r < this->my_grid_rows;r++)
+    {
+        for(int c = 0;c < this->my_grid_cols;c++)
+        {
+            pixels.emplace_back(c * this->my_grid_step,r * this->my_grid_step);
+        }
+    }
+
+    //只在启动时做一次,迭代次数给足
+    cv::undistortPoints(pixels,this->my_grid,this->my_camera_matrix,this->my_dist_coeffs,cv::noArray(),cv::noArray(),
+                        cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS,50,1e-12));
+}
+
+//查找表之外的点用OpenCV迭代求逆畸变
+cv::Point2f CameraModel::undistort_slow(const cv::Point2f& pixel) const
+{
+    std::vector<cv::Point2f> src(1,pixel),dst;
+    cv::undistortPoints(src,dst,this->my_camera_matrix,this->my_dist_coeffs);
+    return dst[0];
+}
+
+//一批像素坐标→归一化去畸变坐标
+void CameraModel::undistort_points(const cv::Point2f* pixels,cv::Point2f* normalized,size_t count) const
+{
+    const float inv_step = 1.0f / this->my_grid_step;
+    const int cols = this->my_grid_cols;
+    for(size_t i = 0;i < count;i++)
+    {
+        const cv::Point2f p = pixels[i];
+        const float gx = p.x * inv_step;
+        const float gy = p.y * inv_step;
+        const int c = static_cast<int>(gx);
+        const int r = static_cast<int>(gy);
+        if(p.x < 0 || p.y < 0 || c >= cols - 1 || r >= this->my_grid_rows - 1)
+        {
+            normalized[i] = undistort_slow(p);
+            continue;
+        }
+
+        //双线性插值
+        const float ax = gx - c;
+        const float ay = gy - r;
+        const cv::Point2f* row0 = &this->my_grid[r * cols + c];
+        const cv::Point2f* row1 = row0 + cols;
+        normalized[i] = (row0[0] * (1 - ax) + row0[1] * ax) * (1 - ay) + (row1[0] * (1 - ax) + row1[1] * ax) * ay;
+    }
+}
+
+void CameraModel::undistort_points(const std::vector<cv::Point2f>& pixels,std::vector<cv::Point2f>& normalized) const
+{
+    normalized.resize(pixels.size());
+    undistort_points(pixels.data(),normalized.data(),pixels.size());
+}
+
+//归一化坐标→带畸变的像素坐标
+cv::Point2f CameraModel::distort_point(const cv::Point2f& normalized) const
+{
+    const double x = normalized.x;
+    const double y = normalized.y;
+    const double r2 = x * x + y * y;
+    const double radial = 1 + r2 * (this->my_k1 + r2 * (this->my_k2 + r2 * this->my_k3));
+    const double xd = x * radial + 2 * this->my_p1 * x * y + this->my_p2 * (r2 + 2 * x * x);
+    const double yd = y * radial + this->my_p1 * (r2 + 2 * y * y) + 2 * this->my_p2 * x * y;
+    return cv::Point2f(this->my_fx * xd + this->my_cx,this->my_fy * yd + this->my_cy);
+}
+
+//3D点投影到带畸变的图像上
+void CameraModel::project_points(const std::vector<cv::Point3f>& object_points,const cv::Vec3d& rvec,const cv::Vec3d& tvec,std::vector<cv::Point2f>& pixels) const
+{
+    if(!this->my_simple_distortion)
+    {
+        cv::projectPoints(object_points,rvec,tvec,this->my_camera_matrix,this->my_dist_coeffs,pixels);
+        return;
+    }
+
+    cv::Matx33d R;
+    cv::Rodrigues(rvec,R);
+    pixels.resize(object_points.size());
+    for(size_t i = 0;i < object_points.size();i++)
+    {
+        const cv::Vec3d p = R * cv::Vec3d(object_points[i].x,object_points[i].y,object_points[i].z) + tvec;
+        const double inv_z = p[2] != 0 ? 1.0 / p[2] : 1.0;
+        pixels[i] = distort_point(cv::Point2f(p[0] * inv_z,p[1] * inv_z));
+    }
+}
+
+//平均焦距
+double CameraModel::get_focal() const
+{
+    return 0.5 * (this->my_fx + this->my_fy);
+}
+
+const cv::Mat& CameraModel::get_camera_matrix() const
+{
+    return this->my_camera_matrix;
+}
+
+const cv::Mat& CameraModel::get_dist_coeffs() const
+{
+    return this->my_dist_coeffs;
+}
+
+cv::Size CameraModel::get_image_size() const
+{
+    return this->my_image_size;
+}
@@ -0,0 +1,389 @@
+#include"FrameBus.h"
+#include<atomic>
+#include<chrono>
+#include<climits>
+#include<cstring>
+#include<iostream>
+#include<new>
+#include<fcntl.h>
+#include<linux/futex.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+
+namespace FrameBus
+{
+
+namespace
+{
+
+const uint32_t BUS_MAGIC = 0x53554246;//"FBUS"
+const uint32_t BUS_VERSION = 1;
+const size_t PAGE_BYTES = 4096;
+
+//共享内存开头的总线信息,由写者初始化,magic最后写入
+struct alignas(64) BusHeader
+{
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint64_t slot_bytes;//每个槽位数据区的字节数
+    uint64_t data_offset;//第一个槽位数据区的偏移
+    std::atomic<uint64_t> latest;//最新一帧的序号,0为还没有帧
+    std::atomic<uint32_t> notify;//futex字,每发布一帧加1
+    std::atomic<uint32_t> closed;//写者已关闭
+};
+
+//每个槽位的seqlock和元数据,数据区在data_offset之后
+struct alignas(64) SlotHeader
+{
+    std::atomic<uint64_t> version;//奇数表示正在写
+    FrameMeta meta;
+};
+
+//跨进程使用的原子量必须是无锁的
+static_assert(std::atomic<uint64_t>::is_always_lock_free,"FrameBus需要无锁的64位原子量");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,"FrameBus需要无锁的32位原子量");
+
+size_t round_up(size_t value,size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+//共享内存名必须以/开头
+std::string shm_name(const std::string& name)
+{
+    return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+BusHeader* header_of(void* base)
+{
+    return static_cast<BusHeader*>(base);
+}
+
+SlotHeader* slot_of(void* base,int slot)
+{
+    return reinterpret_cast<SlotHeader*>(static_cast<char*>(base) + sizeof(BusHeader)) + slot;
+}
+
+uint8_t* data_of(void* base,int slot)
+{
+    const BusHeader* header = header_of(base);
+    return static_cast<uint8_t*>(base) + header->data_offset + slot * header->slot_bytes;
+}
+
+void futex_wake_all(std::atomic<uint32_t>* word)
+{
+    syscall(SYS_futex,reinterpret_cast<uint32_t*>(word),FUTEX_WAKE,INT_MAX,nullptr,nullptr,0);
+}
+
+void futex_wait(const std::atomic<uint32_t>* word,uint32_t expected,int64_t timeout_ns)
+{
+    timespec timeout;
+    timeout.tv_sec = timeout_ns / 1000000000;
+    timeout.tv_nsec = timeout_ns % 1000000000;
+    syscall(SYS_futex,reinterpret_cast<const uint32_t*>(word),FUTEX_WAIT,expected,&timeout,nullptr,0);
+}
+
+} // namespace
+
+//-----------------写者--------------------
+
+std::unique_ptr<Writer> Writer::create(const std::string& name,size_t max_frame_bytes,int slot_count)
+{
+    if(slot_count < 2 || max_frame_bytes == 0)
+    {
+        std::cout<<"[FrameBus] 槽位数至少为2,帧大小不能为0"<<std::endl;
+        return nullptr;
+    }
+
+    const std::string path = shm_name(name);
+    const size_t data_offset = round_up(sizeof(BusHeader) + slot_count * sizeof(SlotHeader),PAGE_BYTES);
+    const size_t slot_bytes = round_up(max_frame_bytes,PAGE_BYTES);
+    const size_t size = data_offset + slot_count * slot_bytes;
+
+    //旧的总线(上次异常退出留下的)先删除,已经映射它的读者不受影响
+    shm_unlink(path.c_str());
+    int fd = shm_open(path.c_str(),O_CREAT | O_EXCL | O_RDWR,0644);
+    if(fd < 0)
+    {
+        std::cout<<"[FrameBus] 无法创建共享内存"<<path<<": "<<std::strerror(errno)<<std::endl;
+        return nullptr;
+    }
+    if(ftruncate(fd,size) != 0)
+    {
+        std::cout<<"[FrameBus] 无法设置共享内存大小: "<<std::strerror(errno)<<std::endl;
+        close(fd);
+        shm_unlink(path.c_str());
+        return nullptr;
+    }
+    void* base = mmap(nullptr,size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+    close(fd);
+    if(base == MAP_FAILED)
+    {
+        std::cout<<"[FrameBus] 无法映射共享内存: "<<std::strerror(errno)<<std::endl;
+        shm_unlink(path.c_str());
+        return nullptr;
+    }
+
+    BusHeader* header = new(base) BusHeader();
+    header->version = BUS_VERSION;
+    header->slot_count = slot_count;
+    header->slot_bytes = slot_bytes;
+    header->data_offset = data_offset;
+    header->latest.store(0,std::memory_order_relaxed);
+    header->notify.store(0,std::memory_order_relaxed);
+    header->closed.store(0,std::memory_order_relaxed);
+    for(int i = 0;i < slot_count;i++)
+    {
+        new(slot_of(base,i)) SlotHeader();
+        slot_of(base,i)->version.store(0,std::memory_order_relaxed);
+    }
+    //读者看到magic之后其余字段都已写好
+    header->magic.store(BUS_MAGIC,std::memory_order_release);
+
+    std::unique_ptr<Writer> writer(new Writer());
+    writer->my_name = path;
+    writer->my_base = base;
+    writer->my_size = size;
+    std::cout<<"[FrameBus] 已创建"<<path<<": "<<slot_count<<"个槽位,每帧最大"<<max_frame_bytes<<"字节"<<std::endl;
+    return writer;
+}
+
+Writer::~Writer()
+{
+    if(this->my_base == nullptr)
+    {
+        return;
+    }
+    BusHeader* header = header_of(this->my_base);
+    header->closed.store(1,std::memory_order_release);
+    header->notify.fetch_add(1,std::memory_order_release);
+    futex_wake_all(&header->notify);
+    munmap(this->my_base,this->my_size);
+    shm_unlink(this->my_name.c_str());
+}
+
+cv::Mat Writer::begin_write(int rows,int cols,int type)
+{
+    BusHeader* header = header_of(this->my_base);
+    const size_t step = static_cast<size_t>(cols) * CV_ELEM_SIZE(type);
+    const size_t bytes = step * rows;
+    if(bytes == 0 || bytes > header->slot_bytes)
+    {
+        return cv::Mat();
+    }
+
+    //下一帧(序号my_sequence+1)的槽位,version置为奇数后再写数据
+    const int slot = static_cast<int>(this->my_sequence % header->slot_count);
+    SlotHeader* slot_header = slot_of(this->my_base,slot);
+    uint64_t version = slot_header->version.load(std::memory_order_relaxed);
+    if(version % 2 == 0)
+    {
+        slot_header->version.store(version + 1,std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    this->my_writing_slot = slot;
+    this->my_pending = FrameMeta();
+    this->my_pending.width = cols;
+    this->my_pending.height = rows;
+    this->my_pending.type = type;
+    this->my_pending.step = static_cast<int32_t>(step);
+    this->my_pending.bytes = static_cast<uint32_t>(bytes);
+    return cv::Mat(rows,cols,type,data_of(this->my_base,slot),step);
+}
+
+void Writer::commit(int64_t timestamp_ns,uint32_t user)
+{
+    if(this->my_writing_slot < 0)
+    {
+        return;
+    }
+    BusHeader* header = header_of(this->my_base);
+    SlotHeader* slot_header = slot_of(this->my_base,this->my_writing_slot);
+
+    this->my_pending.sequence = this->my_sequence + 1;
+    this->my_pending.timestamp_ns = timestamp_ns;
+    this->my_pending.user = user;
+    slot_header->meta = this->my_pending;
+
+    //version回到偶数,数据和元数据对读者可见
+    slot_header->version.store(slot_header->version.load(std::memory_order_relaxed) + 1,std::memory_order_release);
+    this->my_sequence++;
+    this->my_writing_slot = -1;
+    header->latest.store(this->my_sequence,std::memory_order_release);
+
+    //唤醒等待的读者,没有读者等待时只是一次很快的系统调用
+    header->notify.fetch_add(1,std::memory_order_release);
+    futex_wake_all(&header->notify);
+}
+
+bool Writer::publish(const cv::Mat& frame,int64_t timestamp_ns,uint32_t user)
+{
+    cv::Mat slot = begin_write(frame.rows,frame.cols,frame.type());
+    if(slot.empty())
+    {
+        return false;
+    }
+    frame.copyTo(slot);
+    commit(timestamp_ns,user);
+    return true;
+}
+
+//-----------------读者--------------------
+
+std::unique_ptr<Reader> Reader::open(const std::string& name)
+{
+    const std::string path = shm_name(name);
+    int fd = shm_open(path.c_str(),O_RDONLY,0);
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat info;
+    if(fstat(fd,&info) != 0 || static_cast<size_t>(info.st_size) < sizeof(BusHeader))
+    {
+        close(fd);
+        return nullptr;
+    }
+    const size_t size = info.st_size;
+    //只读映射: 读者的错误不会破坏写者和其他读者
+    void* base = mmap(nullptr,size,PROT_READ,MAP_SHARED,fd,0);
+    close(fd);
+    if(base == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    const BusHeader* header = header_of(base);
+    if(header->magic.load(std::memory_order_acquire) != BUS_MAGIC || header->version != BUS_VERSION ||
+       header->data_offset + header->slot_count * header->slot_bytes > size)
+    {
+        std::cout<<"[FrameBus] "<<path<<"格式不符或尚未初始化"<<std::endl;
+        munmap(base,size);
+        return nullptr;
+    }
+
+    std::unique_ptr<Reader> reader(new Reader());
+    reader->my_base = base;
+    reader->my_size = size;
+    return reader;
+}
+
+Reader::~Reader()
+{
+    if(this->my_base != nullptr)
+    {
+        munmap(this->my_base,this->my_size);
+    }
+}
+
+bool Reader::latest(FrameView& view,uint64_t after) const
+{
+    const BusHeader* header = header_of(this->my_base);
+    //写者恰好在覆盖时重试,槽位数>=2时很少发生
+    for(int attempt = 0;attempt < 4;attempt++)
+    {
+        const uint64_t sequence = header->latest.load(std::memory_order_acquire);
+        if(sequence == 0 || sequence <= after)
+        {
+            return false;
+        }
+        const int slot = static_cast<int>((sequence - 1) % header->slot_count);
+        const SlotHeader* slot_header = slot_of(this->my_base,slot);
+        const uint64_t version = slot_header->version.load(std::memory_order_acquire);
+        if(version % 2 != 0)
+        {
+            continue;
+        }
+        const FrameMeta meta = slot_header->meta;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot_header->version.load(std::memory_order_relaxed) != version || meta.sequence != sequence)
+        {
+            continue;
+        }
+
+        view.meta = meta;
+        view.slot = slot;
+        view.slot_version = version;
+        //映射是只读的,写入image会触发段错误
+        view.image = cv::Mat(meta.height,meta.width,meta.type,data_of(this->my_base,slot),meta.step);
+        return true;
+    }
+    return false;
+}
+
+bool Reader::still_valid(const FrameView& view) const
+{
+    if(view.slot < 0)
+    {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot_of(this->my_base,view.slot)->version.load(std::memory_order_relaxed) == view.slot_version;
+}
+
+bool Reader::read_copy(cv::Mat& image,FrameMeta& meta,uint64_t after) const
+{
+    FrameView view;
+    for(int attempt = 0;attempt < 4;attempt++)
+    {
+        if(!latest(view,after))
+        {
+            return false;
+        }
+        view.image.copyTo(image);
+        //拷贝期间被覆盖则重新取最新的一帧
+        if(still_valid(view))
+        {
+            meta = view.meta;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Reader::wait(uint64_t after,int timeout_ms) const
+{
+    const BusHeader* header = header_of(this->my_base);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while(true)
+    {
+        //先读futex字再检查条件,避免在两者之间发布的帧被错过
+        const uint32_t notify = header->notify.load(std::memory_order_acquire);
+        if(header->latest.load(std::memory_order_acquire) > after)
+        {
+            return true;
+        }
+        if(header->closed.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        const int64_t remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if(remaining <= 0)
+        {
+            return false;
+        }
+        futex_wait(&header->notify,notify,remaining);
+    }
+}
+
+uint64_t Reader::get_latest_sequence() const
+{
+    return header_of(this->my_base)->latest.load(std::memory_order_acquire);
+}
+
+bool Reader::writer_closed() const
+{
+    return header_of(this->my_base)->closed.load(std::memory_order_acquire) != 0;
+}
+
+int Reader::get_slot_count() const
+{
+    return static_cast<int>(header_of(this->my_base)->slot_count);
+}
+
+} // namespace FrameBus
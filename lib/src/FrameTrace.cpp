@@ -0,0 +1,278 @@
+#include "FrameTrace.h"
+#include<algorithm>
+#include<array>
+#include<atomic>
+#include<cerrno>
+#include<csignal>
+#include<cstdio>
+#include<cstdlib>
+#include<iostream>
+#include<memory>
+#include<mutex>
+#include<pthread.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#include<vector>
+
+namespace FrameTrace
+{
+
+namespace
+{
+
+//每个线程保留的片段数(每条56字节,每个线程约1.8MB),200帧/s、每帧十几个片段时可保留10秒以上
+constexpr uint64_t ring_size = 1 << 15;
+
+//一条片段,由seq判断读到的内容是否完整(写入中为奇数)
+struct Slot
+{
+    std::atomic<uint64_t> seq{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<const char*> arg_name{nullptr};
+    std::atomic<int64_t> begin_ns{0};
+    std::atomic<int64_t> end_ns{0};
+    std::atomic<int64_t> arg_value{0};
+    std::atomic<uint64_t> frame{0};
+};
+static_assert(sizeof(Slot) == 56,"修改Slot后同步更新ring_size处的内存估算");
+
+//单个线程的环形缓冲区,只由所属线程写入
+struct ThreadBuffer
+{
+    std::array<Slot,ring_size> slots;
+    std::atomic<uint64_t> head{0};//已写入的总条数
+    long tid = 0;
+    std::string name;
+};
+
+//导出时的一条片段
+struct Event
+{
+    const ThreadBuffer* thread;
+    const char* name;
+    const char* arg_name;
+    int64_t begin_ns;
+    int64_t end_ns;
+    int64_t arg_value;
+    uint64_t frame;
+};
+
+bool env_enabled()
+{
+    const char* env = std::getenv("FRAME_TRACE");
+    return env != nullptr && env[0] != '\0' && env[0] != '0';
+}
+
+std::atomic<bool> g_enabled{env_enabled()};
+std::atomic<bool> g_dump_requested{false};
+thread_local uint64_t t_frame = 0;
+
+//线程注册表,只在线程第一次记录和导出时加锁; 线程退出后缓冲区保留,仍可导出
+std::mutex g_threads_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> g_threads;
+
+ThreadBuffer& local_buffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> local = []()
+    {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->tid = syscall(SYS_gettid);
+        char name[16] = {0};
+        pthread_getname_np(pthread_self(),name,sizeof(name));
+        buffer->name = name;
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        g_threads.push_back(buffer);
+        return buffer;
+    }();
+    return *local;
+}
+
+//读出一个线程缓冲区中完整的片段,正在被覆盖的跳过
+void collect(const ThreadBuffer& buffer,std::vector<Event>& events)
+{
+    const uint64_t head = buffer.head.load(std::memory_order_acquire);
+    const uint64_t first = head > ring_size ? head - ring_size : 0;
+    for(uint64_t n = first;n < head;n++)
+    {
+        const Slot& slot = buffer.slots[n & (ring_size - 1)];
+        const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if(seq != 2 * n + 2)
+        {
+            continue;
+        }
+        Event event;
+        event.thread = &buffer;
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.arg_name = slot.arg_name.load(std::memory_order_relaxed);
+        event.begin_ns = slot.begin_ns.load(std::memory_order_relaxed);
+        event.end_ns = slot.end_ns.load(std::memory_order_relaxed);
+        event.arg_value = slot.arg_value.load(std::memory_order_relaxed);
+        event.frame = slot.frame.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.seq.load(std::memory_order_relaxed) == seq)
+        {
+            events.push_back(event);
+        }
+    }
+}
+
+//json字符串转义(线程名可能含任意字符)
+std::string escape(const std::string& text)
+{
+    std::string out;
+    for(char c : text)
+    {
+        if(c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if(static_cast<unsigned char>(c) < 0x20)
+        {
+            out += ' ';
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void handle_signal(int)
+{
+    g_dump_requested.store(true,std::memory_order_relaxed);
+}
+
+}
+
+void set_enabled(bool enabled)
+{
+    g_enabled.store(enabled,std::memory_order_relaxed);
+}
+
+bool is_enabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void set_frame(uint64_t frame_id)
+{
+    t_frame = frame_id;
+}
+
+uint64_t current_frame()
+{
+    return t_frame;
+}
+
+void record(const char* name,int64_t begin_ns,int64_t end_ns,const char* arg_name,int64_t arg_value)
+{
+    ThreadBuffer& buffer = local_buffer();
+
+    //单写者: 先把seq置为奇数,写完内容后置为偶数,读者据此丢弃写了一半的记录
+    const uint64_t n = buffer.head.load(std::memory_order_relaxed);
+    Slot& slot = buffer.slots[n & (ring_size - 1)];
+    slot.seq.store(2 * n + 1,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name,std::memory_order_relaxed);
+    slot.arg_name.store(arg_name,std::memory_order_relaxed);
+    slot.begin_ns.store(begin_ns,std::memory_order_relaxed);
+    slot.end_ns.store(end_ns,std::memory_order_relaxed);
+    slot.arg_value.store(arg_value,std::memory_order_relaxed);
+    slot.frame.store(t_frame,std::memory_order_relaxed);
+    slot.seq.store(2 * n + 2,std::memory_order_release);
+    buffer.head.store(n + 1,std::memory_order_release);
+}
+
+long dump(const std::string& path)
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> threads;
+    {
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        threads = g_threads;
+    }
+    std::vector<Event> events;
+    for(const auto& thread : threads)
+    {
+        collect(*thread,events);
+    }
+
+    FILE* file = std::fopen(path.c_str(),"w");
+    if(file == nullptr)
+    {
+        std::cout<<"[FrameTrace] 无法写入"<<path<<std::endl;
+        return -1;
+    }
+    const int pid = static_cast<int>(getpid());
+    std::fprintf(file,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(file,"{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"%s\"}}",
+                 pid,escape(program_invocation_short_name).c_str());
+    for(size_t i = 0;i < threads.size();i++)
+    {
+        std::fprintf(file,",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+                     pid,threads[i]->tid,escape(threads[i]->name).c_str());
+        std::fprintf(file,",\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":%d,\"tid\":%ld,\"args\":{\"sort_index\":%zu}}",
+                     pid,threads[i]->tid,i);
+    }
+
+    //片段: 时间单位为微秒
+    for(const Event& event : events)
+    {
+        std::fprintf(file,",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":%d,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu",
+                     event.name,pid,event.thread->tid,event.begin_ns * 1e-3,(event.end_ns - event.begin_ns) * 1e-3,
+                     static_cast<unsigned long long>(event.frame));
+        if(event.arg_name != nullptr)
+        {
+            std::fprintf(file,",\"%s\":%lld",event.arg_name,static_cast<long long>(event.arg_value));
+        }
+        std::fprintf(file,"}}");
+    }
+
+    //同一帧跨线程的相邻片段用flow箭头连起来,在Perfetto中点一个片段即可沿箭头看完整帧
+    std::sort(events.begin(),events.end(),[](const Event& a,const Event& b)
+    {
+        return a.frame != b.frame ? a.frame < b.frame : a.begin_ns < b.begin_ns;
+    });
+    uint64_t flow_id = 0;
+    for(size_t i = 1;i < events.size();i++)
+    {
+        const Event& prev = events[i - 1];
+        const Event& next = events[i];
+        if(next.frame == 0 || next.frame != prev.frame || next.thread == prev.thread)
+        {
+            continue;
+        }
+        flow_id++;
+        std::fprintf(file,",\n{\"ph\":\"s\",\"name\":\"frame\",\"cat\":\"frame\",\"id\":%llu,\"pid\":%d,\"tid\":%ld,\"ts\":%.3f}",
+                     static_cast<unsigned long long>(flow_id),pid,prev.thread->tid,prev.begin_ns * 1e-3);
+        std::fprintf(file,",\n{\"ph\":\"f\",\"bp\":\"e\",\"name\":\"frame\",\"cat\":\"frame\",\"id\":%llu,\"pid\":%d,\"tid\":%ld,\"ts\":%.3f}",
+                     static_cast<unsigned long long>(flow_id),pid,next.thread->tid,next.begin_ns * 1e-3);
+    }
+    std::fprintf(file,"\n]}\n");
+    std::fclose(file);
+    return static_cast<long>(events.size());
+}
+
+void install_signal_handler(int signo)
+{
+    std::signal(signo,handle_signal);
+}
+
+bool dump_if_requested(const std::string& prefix)
+{
+    if(!g_dump_requested.exchange(false,std::memory_order_relaxed))
+    {
+        return false;
+    }
+    const long long unix_time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::string path = prefix + "_" + std::to_string(unix_time) + ".json";
+    const long count = dump(path);
+    if(count >= 0)
+    {
+        std::cout<<"[FrameTrace] 已导出 "<<count<<" 个片段到 "<<path<<std::endl;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,65 @@
+#include "Pipeline.h"
+#include<cstdio>
+#include<iostream>
+#include<pthread.h>
+#include<sched.h>
+
+namespace Pipeline
+{
+
+//把当前线程绑定到cpu上并命名
+bool pin_current_thread(int cpu,const std::string& name)
+{
+    //线程名最多15个字符
+    pthread_setname_np(pthread_self(),name.substr(0,15).c_str());
+    if(cpu < 0)
+    {
+        return true;
+    }
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu,&cpu_set);
+    int ret = pthread_setaffinity_np(pthread_self(),sizeof(cpu_set),&cpu_set);
+    if(ret != 0)
+    {
+        std::cout<<"线程 "<<name<<" 绑定cpu "<<cpu<<" 失败,错误码："<<ret<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+//等待时的退避
+void Backoff::pause()
+{
+    if(my_count < 64)
+    {
+        my_count++;
+        std::this_thread::yield();
+    }
+    else
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+//输出统计表格
+void print_stats(const std::vector<StageStats>& stats)
+{
+    std::printf("========== 流水线统计 ==========\n");
+    std::printf("%-12s %4s %8s %8s %8s %10s %10s %10s %7s\n",
+                "stage","cpu","items","dropped","occupy%","busy(us)","wait(us)","block(us)","queue");
+    for(const StageStats& s : stats)
+    {
+        //每帧平均耗时
+        const double per_item = s.items > 0 ? 1e6 / s.items : 0.0;
+        std::printf("%-12s %4d %8llu %8llu %8.1f %10.1f %10.1f %10.1f %3zu/%-3zu\n",
+                    s.name.c_str(),s.cpu,
+                    static_cast<unsigned long long>(s.items),static_cast<unsigned long long>(s.dropped),
+                    s.occupancy() * 100.0,s.busy_s * per_item,s.wait_s * per_item,s.blocked_s * per_item,
+                    s.queue_size,s.queue_depth);
+    }
+    std::fflush(stdout);
+}
+
+} // namespace Pipeline
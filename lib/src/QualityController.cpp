@@ -0,0 +1,95 @@
+#include "QualityController.h"
+#include<algorithm>
+#include<cstdio>
+
+namespace QualityControl
+{
+
+QualityController::QualityController(const QualityConfig& config)
+: my_config(config)
+{
+    this->my_config.levels = std::max(1,this->my_config.levels);
+    this->my_config.window = std::max(1,this->my_config.window);
+    this->my_window.resize(this->my_config.window);
+    this->my_scratch.reserve(this->my_config.window);
+    this->my_level_frames.resize(this->my_config.levels,0);
+}
+
+double QualityController::window_quantile()
+{
+    this->my_scratch.assign(this->my_window.begin(),this->my_window.begin() + this->my_filled);
+    const size_t index = std::min(this->my_filled - 1,static_cast<size_t>(this->my_config.quantile * this->my_filled));
+    std::nth_element(this->my_scratch.begin(),this->my_scratch.begin() + index,this->my_scratch.end());
+    return this->my_scratch[index];
+}
+
+void QualityController::change_level(int level)
+{
+    this->my_level.store(level,std::memory_order_relaxed);
+    this->my_filled = 0;
+    this->my_next = 0;
+    this->my_calm_frames = 0;
+}
+
+int QualityController::observe(double latency_ms)
+{
+    const int level = this->my_level.load(std::memory_order_relaxed);
+    this->my_level_frames[level]++;
+    if(latency_ms > this->my_config.budget_ms)
+    {
+        this->my_over_budget++;
+    }
+
+    this->my_window[this->my_next] = latency_ms;
+    this->my_next = (this->my_next + 1) % this->my_window.size();
+    this->my_filled = std::min(this->my_filled + 1,this->my_window.size());
+    if(this->my_filled < this->my_window.size())
+    {
+        return level;
+    }
+
+    const double quantile = this->window_quantile();
+    if(quantile > this->my_config.budget_ms)
+    {
+        this->my_calm_frames = 0;
+        if(level + 1 < this->my_config.levels)
+        {
+            this->my_degrades++;
+            this->change_level(level + 1);
+        }
+    }
+    else if(quantile < this->my_config.budget_ms * this->my_config.recover_ratio && level > 0)
+    {
+        if(++this->my_calm_frames >= this->my_config.recover_frames)
+        {
+            this->my_recovers++;
+            this->change_level(level - 1);
+        }
+    }
+    else
+    {
+        this->my_calm_frames = 0;
+    }
+    return this->my_level.load(std::memory_order_relaxed);
+}
+
+void QualityController::print_stats() const
+{
+    uint64_t frames = 0;
+    for(uint64_t count : this->my_level_frames)
+    {
+        frames += count;
+    }
+    std::printf("========== 自适应质量 ==========\n");
+    std::printf("预算 %.2f ms, 帧数 %llu, 超出预算 %llu (%.1f%%), 降级 %llu 次, 恢复 %llu 次\n",this->my_config.budget_ms,
+                static_cast<unsigned long long>(frames),static_cast<unsigned long long>(this->my_over_budget),
+                frames > 0 ? 100.0 * this->my_over_budget / frames : 0.0,
+                static_cast<unsigned long long>(this->my_degrades),static_cast<unsigned long long>(this->my_recovers));
+    for(size_t level = 0;level < this->my_level_frames.size();level++)
+    {
+        std::printf("  等级 %zu: %llu 帧\n",level,static_cast<unsigned long long>(this->my_level_frames[level]));
+    }
+    std::printf("================================\n");
+}
+
+}
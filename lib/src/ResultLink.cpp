@@ -0,0 +1,234 @@
+#include"ResultLink.h"
+#include<algorithm>
+#include<chrono>
+#include<cerrno>
+#include<cstring>
+#include<iostream>
+#include<netdb.h>
+#include<poll.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<unistd.h>
+
+namespace ResultLink
+{
+
+namespace
+{
+
+//解析后的地址
+struct Endpoint
+{
+    sockaddr_storage address;
+    socklen_t length = 0;
+    int family = AF_UNSPEC;
+    std::string unix_path;
+};
+
+bool starts_with(const std::string& text,const std::string& prefix)
+{
+    return text.compare(0,prefix.size(),prefix) == 0;
+}
+
+//udp://host:port 或 unix:///path
+bool parse_uri(const std::string& uri,Endpoint& endpoint)
+{
+    std::memset(&endpoint.address,0,sizeof(endpoint.address));
+    if(starts_with(uri,"unix://"))
+    {
+        endpoint.unix_path = uri.substr(7);
+        sockaddr_un* address = reinterpret_cast<sockaddr_un*>(&endpoint.address);
+        if(endpoint.unix_path.empty() || endpoint.unix_path.size() >= sizeof(address->sun_path))
+        {
+            return false;
+        }
+        address->sun_family = AF_UNIX;
+        std::memcpy(address->sun_path,endpoint.unix_path.c_str(),endpoint.unix_path.size() + 1);
+        endpoint.length = sizeof(sockaddr_un);
+        endpoint.family = AF_UNIX;
+        return true;
+    }
+    if(starts_with(uri,"udp://"))
+    {
+        const std::string host_port = uri.substr(6);
+        const size_t colon = host_port.rfind(':');
+        if(colon == std::string::npos)
+        {
+            return false;
+        }
+        const std::string host = host_port.substr(0,colon);
+        const std::string port = host_port.substr(colon + 1);
+
+        addrinfo hints;
+        std::memset(&hints,0,sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* result = nullptr;
+        if(getaddrinfo(host.empty() ? nullptr : host.c_str(),port.c_str(),&hints,&result) != 0 || result == nullptr)
+        {
+            return false;
+        }
+        std::memcpy(&endpoint.address,result->ai_addr,result->ai_addrlen);
+        endpoint.length = result->ai_addrlen;
+        endpoint.family = AF_INET;
+        freeaddrinfo(result);
+        return true;
+    }
+    return false;
+}
+
+//UDP和Unix数据报共用: 每条消息一次非阻塞sendto
+class DatagramTransport : public Transport
+{
+    public:
+    DatagramTransport(int fd,const Endpoint& endpoint):my_fd(fd),my_endpoint(endpoint) {}
+    ~DatagramTransport() override { close(this->my_fd); }
+
+    bool send(const void* data,size_t bytes) override
+    {
+        ssize_t sent = sendto(this->my_fd,data,bytes,MSG_DONTWAIT | MSG_NOSIGNAL,
+                              reinterpret_cast<const sockaddr*>(&this->my_endpoint.address),this->my_endpoint.length);
+        return sent == static_cast<ssize_t>(bytes);
+    }
+
+    private:
+    int my_fd;
+    Endpoint my_endpoint;
+};
+
+} // namespace
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::unique_ptr<Transport> open_transport(const std::string& uri)
+{
+    Endpoint endpoint;
+    if(!parse_uri(uri,endpoint))
+    {
+        std::cout<<"[ResultLink] 无法解析地址"<<uri<<", 应为udp://host:port或unix:///path"<<std::endl;
+        return nullptr;
+    }
+    int fd = socket(endpoint.family,SOCK_DGRAM | SOCK_CLOEXEC,0);
+    if(fd < 0)
+    {
+        std::cout<<"[ResultLink] 无法创建socket: "<<std::strerror(errno)<<std::endl;
+        return nullptr;
+    }
+    return std::unique_ptr<Transport>(new DatagramTransport(fd,endpoint));
+}
+
+//-----------------发送端--------------------
+
+Publisher::Publisher(std::unique_ptr<Transport> transport):my_transport(std::move(transport))
+{
+}
+
+void Publisher::begin(uint64_t frame_id,int64_t capture_ns,uint16_t quality_level)
+{
+    this->my_message.header.count = 0;
+    this->my_message.header.frame_id = frame_id;
+    this->my_message.header.capture_ns = capture_ns;
+    this->my_message.header.quality_level = quality_level;
+}
+
+ArmorRecord* Publisher::add()
+{
+    if(this->my_message.header.count >= MAX_ARMORS)
+    {
+        return nullptr;
+    }
+    ArmorRecord* record = &this->my_message.armors[this->my_message.header.count++];
+    *record = ArmorRecord();
+    return record;
+}
+
+bool Publisher::send()
+{
+    this->my_message.header.publish_ns = now_ns();
+    //下游没有启动或处理不过来时直接丢弃,不影响检测
+    if(this->my_transport && this->my_transport->send(&this->my_message,message_bytes(this->my_message.header.count)))
+    {
+        this->my_sent++;
+        return true;
+    }
+    this->my_dropped++;
+    return false;
+}
+
+//-----------------接收端--------------------
+
+std::unique_ptr<Receiver> Receiver::bind(const std::string& uri)
+{
+    Endpoint endpoint;
+    if(!parse_uri(uri,endpoint))
+    {
+        std::cout<<"[ResultLink] 无法解析地址"<<uri<<std::endl;
+        return nullptr;
+    }
+    int fd = socket(endpoint.family,SOCK_DGRAM | SOCK_CLOEXEC,0);
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+    if(endpoint.family == AF_UNIX)
+    {
+        unlink(endpoint.unix_path.c_str());
+    }
+    if(::bind(fd,reinterpret_cast<const sockaddr*>(&endpoint.address),endpoint.length) != 0)
+    {
+        std::cout<<"[ResultLink] 无法绑定"<<uri<<": "<<std::strerror(errno)<<std::endl;
+        close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<Receiver> receiver(new Receiver());
+    receiver->my_fd = fd;
+    receiver->my_unix_path = endpoint.unix_path;
+    return receiver;
+}
+
+Receiver::~Receiver()
+{
+    if(this->my_fd >= 0)
+    {
+        close(this->my_fd);
+    }
+    if(!this->my_unix_path.empty())
+    {
+        unlink(this->my_unix_path.c_str());
+    }
+}
+
+bool Receiver::receive(Message& message,int timeout_ms)
+{
+    pollfd request = {this->my_fd,POLLIN,0};
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms,0));
+    while(poll(&request,1,timeout_ms) > 0)
+    {
+        ssize_t bytes = recv(this->my_fd,&message,sizeof(Message),MSG_DONTWAIT);
+        if(bytes < 0)
+        {
+            return false;
+        }
+        const MessageHeader& header = message.header;
+        if(static_cast<size_t>(bytes) >= sizeof(MessageHeader) && header.magic == MESSAGE_MAGIC &&
+           header.version == MESSAGE_VERSION && header.count <= MAX_ARMORS &&
+           static_cast<size_t>(bytes) == message_bytes(header.count))
+        {
+            return true;
+        }
+        //格式不对的消息丢弃,继续等待(不重新计时,只等剩余的时间; 负数为一直等待)
+        this->my_invalid++;
+        if(timeout_ms > 0)
+        {
+            const auto remain = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            timeout_ms = static_cast<int>(std::max<long long>(remain,0));
+        }
+    }
+    return false;
+}
+
+} // namespace ResultLink
@@ -0,0 +1,325 @@
+#include"SimdKernelsImpl.h"
+#include<atomic>
+#include<cstdlib>
+#include<cstring>
+#include<iostream>
+#include<random>
+#include<string>
+#include<vector>
+
+namespace Simd
+{
+
+//-----------------scalar参考实现--------------------
+namespace
+{
+
+int scan_strided_scalar(const float* data,int rows,int stride,float thresh,int* indices)
+{
+    return detail::scan_strided_tail(data,0,rows,stride,thresh,indices,0);
+}
+
+int scan_column_max_scalar(const float* data,int rows,int cols,int row_stride,float thresh,
+                           int* indices,float* max_values,int* argmax)
+{
+    return detail::scan_column_max_tail(data,rows,0,cols,row_stride,thresh,indices,max_values,argmax,0);
+}
+
+void suppress_overlaps_scalar(const BoxesSoA& boxes,int k,int begin,int end,float iou_thresh,uint8_t* suppressed)
+{
+    detail::suppress_overlaps_tail(boxes,k,begin,end,iou_thresh,suppressed);
+}
+
+void fill_u8c3_scalar(uint8_t* dst,size_t pixels,uint8_t c0,uint8_t c1,uint8_t c2)
+{
+    //三个通道相同(灰色填充)时就是memset
+    if(c0 == c1 && c1 == c2)
+    {
+        std::memset(dst,c0,pixels * 3);
+        return;
+    }
+    detail::fill_u8c3_tail(dst,pixels,c0,c1,c2);
+}
+
+void color_mask_u8c3_scalar(const uint8_t* src,size_t pixels,int primary,int secondary,uint8_t min_value,uint8_t min_diff,uint8_t* mask)
+{
+    detail::color_mask_u8c3_tail(src,0,pixels,primary,secondary,min_value,min_diff,mask);
+}
+
+} // namespace
+
+const Kernels scalar_kernels = {
+    scan_strided_scalar,
+    scan_column_max_scalar,
+    suppress_overlaps_scalar,
+    fill_u8c3_scalar,
+    color_mask_u8c3_scalar,
+};
+
+//-----------------调度--------------------
+namespace
+{
+
+const Kernels* compiled_kernels(Isa isa)
+{
+    switch(isa)
+    {
+        case scalar: return &scalar_kernels;
+#ifdef SIMD_KERNELS_X86
+        case sse42: return &sse42_kernels;
+        case avx2: return &avx2_kernels;
+        case avx512: return &avx512_kernels;
+#endif
+        default: return nullptr;
+    }
+}
+
+//cpu是否支持(CPUID + 操作系统是否保存了对应的寄存器状态,由__builtin_cpu_supports检查)
+bool cpu_supports(Isa isa)
+{
+#ifdef SIMD_KERNELS_X86
+    __builtin_cpu_init();
+    switch(isa)
+    {
+        case scalar: return true;
+        case sse42: return __builtin_cpu_supports("sse4.2");
+        case avx2: return __builtin_cpu_supports("avx2");
+        case avx512: return __builtin_cpu_supports("avx512f");
+        default: return false;
+    }
+#else
+    return isa == scalar;
+#endif
+}
+
+//支持的最高一级
+Isa best_isa(Isa limit)
+{
+    for(int isa = limit;isa > scalar;isa--)
+    {
+        if(isa_supported(static_cast<Isa>(isa)))
+        {
+            return static_cast<Isa>(isa);
+        }
+    }
+    return scalar;
+}
+
+Isa isa_from_env()
+{
+    const char* env = std::getenv("SIMD_KERNELS_ISA");
+    if(env == nullptr)
+    {
+        return avx512;
+    }
+    for(int isa = scalar;isa < isa_count;isa++)
+    {
+        if(std::string(env) == isa_name(static_cast<Isa>(isa)))
+        {
+            return static_cast<Isa>(isa);
+        }
+    }
+    std::cout<<"SIMD_KERNELS_ISA无法识别: "<<env<<std::endl;
+    return avx512;
+}
+
+std::atomic<int> current_isa{-1};
+
+} // namespace
+
+const char* isa_name(Isa isa)
+{
+    switch(isa)
+    {
+        case scalar: return "scalar";
+        case sse42: return "sse4.2";
+        case avx2: return "avx2";
+        case avx512: return "avx512";
+        default: return "unknown";
+    }
+}
+
+bool isa_supported(Isa isa)
+{
+    return compiled_kernels(isa) != nullptr && cpu_supports(isa);
+}
+
+Isa get_isa()
+{
+    int isa = current_isa.load(std::memory_order_acquire);
+    if(isa < 0)
+    {
+        //第一次调用,多个线程同时进入时选择的结果相同
+        isa = best_isa(isa_from_env());
+        current_isa.store(isa,std::memory_order_release);
+    }
+    return static_cast<Isa>(isa);
+}
+
+void set_isa(Isa isa)
+{
+    current_isa.store(best_isa(isa),std::memory_order_release);
+}
+
+const Kernels& kernels()
+{
+    return *compiled_kernels(get_isa());
+}
+
+const Kernels* kernels_for(Isa isa)
+{
+    return isa_supported(isa) ? compiled_kernels(isa) : nullptr;
+}
+
+//-----------------自检--------------------
+namespace
+{
+
+//与scalar对比一种指令集,不一致时输出第一处差异
+bool check_isa(const Kernels& k,Isa isa,std::mt19937& rng,bool verbose)
+{
+    const Kernels& ref = scalar_kernels;
+    std::uniform_real_distribution<float> value(-6.0f,6.0f);
+    auto report = [&](const char* kernel,int size)
+    {
+        if(verbose)
+        {
+            std::cout<<"[SimdKernels] "<<isa_name(isa)<<" "<<kernel<<" 与scalar不一致, size="<<size<<std::endl;
+        }
+        return false;
+    };
+
+    //尺寸覆盖各向量宽度的整数倍和尾部
+    for(int rows : {0,1,3,7,8,15,16,17,31,64,100,1023,2100})
+    {
+        //scan_strided: stride为22(v5)和1
+        for(int stride : {1,22})
+        {
+            std::vector<float> data(static_cast<size_t>(rows) * stride + 1);
+            for(float& v : data)
+            {
+                v = value(rng);
+            }
+            std::vector<int> a(rows + 1),b(rows + 1);
+            int na = ref.scan_strided(data.data(),rows,stride,0.6f,a.data());
+            int nb = k.scan_strided(data.data(),rows,stride,0.6f,b.data());
+            if(na != nb || !std::equal(a.begin(),a.begin() + na,b.begin()))
+            {
+                return report("scan_strided",rows);
+            }
+        }
+
+        //scan_column_max: 10行(v8的类别),含相等的值以检查取靠前的行
+        {
+            const int class_rows = 10;
+            const int row_stride = rows + 5;
+            std::vector<float> data(static_cast<size_t>(class_rows) * row_stride);
+            std::uniform_int_distribution<int> level(0,8);
+            for(float& v : data)
+            {
+                v = level(rng) * 0.125f;
+            }
+            std::vector<int> ia(rows + 1),ib(rows + 1),ga(rows + 1),gb(rows + 1);
+            std::vector<float> ma(rows + 1),mb(rows + 1);
+            int na = ref.scan_column_max(data.data(),class_rows,rows,row_stride,0.5f,ia.data(),ma.data(),ga.data());
+            int nb = k.scan_column_max(data.data(),class_rows,rows,row_stride,0.5f,ib.data(),mb.data(),gb.data());
+            if(na != nb || !std::equal(ia.begin(),ia.begin() + na,ib.begin()) ||
+               !std::equal(ma.begin(),ma.begin() + na,mb.begin()) || !std::equal(ga.begin(),ga.begin() + na,gb.begin()))
+            {
+                return report("scan_column_max",rows);
+            }
+        }
+
+        //suppress_overlaps: 整数坐标的框,从不同的k和begin开始
+        {
+            const int n = rows + 2;
+            std::vector<float> x1(n),y1(n),x2(n),y2(n),area(n);
+            std::uniform_int_distribution<int> pos(0,200),size(1,80);
+            for(int i = 0;i < n;i++)
+            {
+                x1[i] = static_cast<float>(pos(rng));
+                y1[i] = static_cast<float>(pos(rng));
+                x2[i] = x1[i] + size(rng);
+                y2[i] = y1[i] + size(rng);
+                area[i] = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+            }
+            BoxesSoA boxes{x1.data(),y1.data(),x2.data(),y2.data(),area.data()};
+            for(int start : {0,1,5})
+            {
+                if(start >= n)
+                {
+                    continue;
+                }
+                std::vector<uint8_t> a(n,0),b(n,0);
+                ref.suppress_overlaps(boxes,start,start + 1,n,0.1f,a.data());
+                k.suppress_overlaps(boxes,start,start + 1,n,0.1f,b.data());
+                if(a != b)
+                {
+                    return report("suppress_overlaps",n);
+                }
+            }
+        }
+
+        //fill_u8c3: 前后各留一段检查越界写
+        for(int offset : {0,1,2})
+        {
+            std::vector<uint8_t> a(offset + rows * 3 + 64,7),b(a);
+            ref.fill_u8c3(a.data() + offset,rows,124,10,250);
+            k.fill_u8c3(b.data() + offset,rows,124,10,250);
+            if(a != b)
+            {
+                return report("fill_u8c3",rows);
+            }
+        }
+
+        //color_mask_u8c3: 红(2,0)和蓝(0,2),像素值集中在阈值附近
+        {
+            std::vector<uint8_t> src(static_cast<size_t>(rows) * 3 + 1);
+            std::uniform_int_distribution<int> pixel(0,255);
+            for(uint8_t& v : src)
+            {
+                v = static_cast<uint8_t>(pixel(rng));
+            }
+            for(int channel : {0,2})
+            {
+                std::vector<uint8_t> a(rows + 16,7),b(a);
+                ref.color_mask_u8c3(src.data(),rows,channel,2 - channel,160,64,a.data());
+                k.color_mask_u8c3(src.data(),rows,channel,2 - channel,160,64,b.data());
+                if(a != b)
+                {
+                    return report("color_mask_u8c3",rows);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool self_check(bool verbose)
+{
+    std::mt19937 rng(12345);
+    bool ok = true;
+    for(int isa = sse42;isa < isa_count;isa++)
+    {
+        const Kernels* k = kernels_for(static_cast<Isa>(isa));
+        if(k == nullptr)
+        {
+            if(verbose)
+            {
+                std::cout<<"[SimdKernels] "<<isa_name(static_cast<Isa>(isa))<<": 不支持,跳过"<<std::endl;
+            }
+            continue;
+        }
+        bool isa_ok = check_isa(*k,static_cast<Isa>(isa),rng,verbose);
+        if(verbose && isa_ok)
+        {
+            std::cout<<"[SimdKernels] "<<isa_name(static_cast<Isa>(isa))<<": 与scalar一致"<<std::endl;
+        }
+        ok = ok && isa_ok;
+    }
+    return ok;
+}
+
+} // namespace Simd
@@ -0,0 +1,133 @@
+#ifndef SIMD_KERNELS_IMPL_H
+#define SIMD_KERNELS_IMPL_H
+#include"SimdKernels.h"
+
+//各指令集实现之间共用的声明,只在lib/src中使用
+namespace Simd
+{
+
+//各指令集的内核表,对应的源文件单独以-msse4.2/-mavx2/-mavx512f编译
+//没有编译进来的指令集在SimdKernels.cpp中为nullptr
+extern const Kernels scalar_kernels;
+#ifdef SIMD_KERNELS_X86
+extern const Kernels sse42_kernels;
+extern const Kernels avx2_kernels;
+extern const Kernels avx512_kernels;
+
+//AVX-512F没有字节运算(需要AVX-512BW),avx512的内核表中使用AVX2的实现
+void color_mask_u8c3_avx2(const uint8_t* src,size_t pixels,int primary,int secondary,uint8_t min_value,uint8_t min_diff,uint8_t* mask);
+#endif
+
+//向量化部分处理不完的尾部与scalar实现共用,保证结果逐位一致
+//各源文件的编译选项不同,这里的函数都是static,不用std::min/max等模板,
+//避免链接时合并成某一个指令集的版本,在不支持的cpu上被scalar路径调用
+namespace detail
+{
+
+static inline float min_f(float a,float b) { return b < a ? b : a; }
+static inline float max_f(float a,float b) { return a < b ? b : a; }
+
+static inline int scan_strided_tail(const float* data,int begin,int rows,int stride,float thresh,int* indices,int count)
+{
+    for(int row = begin;row < rows;row++)
+    {
+        if(data[static_cast<size_t>(row) * stride] >= thresh)
+        {
+            indices[count++] = row;
+        }
+    }
+    return count;
+}
+
+static inline int scan_column_max_tail(const float* data,int rows,int begin,int cols,int row_stride,float thresh,
+                                int* indices,float* max_values,int* argmax,int count)
+{
+    for(int col = begin;col < cols;col++)
+    {
+        //相等时保留靠前的行,与cv::minMaxLoc一致
+        float best = data[col];
+        int best_row = 0;
+        for(int row = 1;row < rows;row++)
+        {
+            float value = data[static_cast<size_t>(row) * row_stride + col];
+            if(value > best)
+            {
+                best = value;
+                best_row = row;
+            }
+        }
+        if(best >= thresh)
+        {
+            indices[count] = col;
+            max_values[count] = best;
+            argmax[count] = best_row;
+            count++;
+        }
+    }
+    return count;
+}
+
+//IoU > thresh 写成 inter > thresh * union,各实现的运算顺序相同
+static inline void suppress_overlaps_tail(const BoxesSoA& boxes,int k,int begin,int end,float iou_thresh,uint8_t* suppressed)
+{
+    const float kx1 = boxes.x1[k],ky1 = boxes.y1[k],kx2 = boxes.x2[k],ky2 = boxes.y2[k],karea = boxes.area[k];
+    for(int i = begin;i < end;i++)
+    {
+        float w = max_f(0.0f,min_f(kx2,boxes.x2[i]) - max_f(kx1,boxes.x1[i]));
+        float h = max_f(0.0f,min_f(ky2,boxes.y2[i]) - max_f(ky1,boxes.y1[i]));
+        float inter = w * h;
+        float uni = (karea + boxes.area[i]) - inter;
+        if(inter > iou_thresh * uni)
+        {
+            suppressed[i] = 1;
+        }
+    }
+}
+
+static inline void fill_u8c3_tail(uint8_t* dst,size_t pixels,uint8_t c0,uint8_t c1,uint8_t c2)
+{
+    for(size_t i = 0;i < pixels;i++)
+    {
+        dst[3 * i + 0] = c0;
+        dst[3 * i + 1] = c1;
+        dst[3 * i + 2] = c2;
+    }
+}
+
+static inline void color_mask_u8c3_tail(const uint8_t* src,size_t begin,size_t pixels,int primary,int secondary,
+                                        uint8_t min_value,uint8_t min_diff,uint8_t* mask)
+{
+    for(size_t i = begin;i < pixels;i++)
+    {
+        const uint8_t p = src[3 * i + primary];
+        const uint8_t s = src[3 * i + secondary];
+        const uint8_t diff = p > s ? static_cast<uint8_t>(p - s) : 0;
+        mask[i] = (p >= min_value && diff >= min_diff) ? 255 : 0;
+    }
+}
+
+//16个3通道像素(48字节,3个128位寄存器)中取出某一通道的pshufb掩码: shuffle[16*r + j]为第r个寄存器中
+//第j个像素该通道所在的字节,不在这个寄存器中时为0x80(结果为0),三个寄存器的结果按位或即得到该通道的16个值
+static inline void make_channel_shuffle(uint8_t* shuffle,int channel)
+{
+    for(int r = 0;r < 3;r++)
+    {
+        for(int j = 0;j < 16;j++)
+        {
+            const int byte = 3 * j + channel - 16 * r;
+            shuffle[16 * r + j] = (byte >= 0 && byte < 16) ? static_cast<uint8_t>(byte) : 0x80;
+        }
+    }
+}
+
+//把(c0,c1,c2)重复写满bytes个字节(bytes为3的倍数),用于构造向量寄存器的填充模式
+static inline void make_fill_pattern(uint8_t* pattern,size_t bytes,uint8_t c0,uint8_t c1,uint8_t c2)
+{
+    fill_u8c3_tail(pattern,bytes / 3,c0,c1,c2);
+}
+
+} // namespace detail
+
+} // namespace Simd
+
+#endif
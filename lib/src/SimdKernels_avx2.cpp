@@ -0,0 +1,166 @@
+//本文件以-mavx2编译,只在cpu支持时通过内核表调用
+#include"SimdKernelsImpl.h"
+#include<immintrin.h>
+
+namespace Simd
+{
+
+namespace
+{
+
+inline int emit_indices(int mask,int base,int* indices,int count)
+{
+    while(mask)
+    {
+        int lane = __builtin_ctz(mask);
+        indices[count++] = base + lane;
+        mask &= mask - 1;
+    }
+    return count;
+}
+
+int scan_strided_avx2(const float* data,int rows,int stride,float thresh,int* indices)
+{
+    const __m256 t = _mm256_set1_ps(thresh);
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0,1,2,3,4,5,6,7),_mm256_set1_epi32(stride));
+    int count = 0;
+    int row = 0;
+    for(;row + 8 <= rows;row += 8)
+    {
+        const float* p = data + static_cast<size_t>(row) * stride;
+        __m256 v = stride == 1 ? _mm256_loadu_ps(p) : _mm256_i32gather_ps(p,offsets,4);
+        count = emit_indices(_mm256_movemask_ps(_mm256_cmp_ps(v,t,_CMP_GE_OQ)),row,indices,count);
+    }
+    return detail::scan_strided_tail(data,row,rows,stride,thresh,indices,count);
+}
+
+int scan_column_max_avx2(const float* data,int rows,int cols,int row_stride,float thresh,
+                         int* indices,float* max_values,int* argmax)
+{
+    const __m256 t = _mm256_set1_ps(thresh);
+    int count = 0;
+    int col = 0;
+    alignas(32) float best_lanes[8];
+    alignas(32) int row_lanes[8];
+    for(;col + 8 <= cols;col += 8)
+    {
+        __m256 best = _mm256_loadu_ps(data + col);
+        __m256i best_row = _mm256_setzero_si256();
+        for(int row = 1;row < rows;row++)
+        {
+            __m256 v = _mm256_loadu_ps(data + static_cast<size_t>(row) * row_stride + col);
+            __m256 gt = _mm256_cmp_ps(v,best,_CMP_GT_OQ);
+            best = _mm256_blendv_ps(best,v,gt);
+            best_row = _mm256_blendv_epi8(best_row,_mm256_set1_epi32(row),_mm256_castps_si256(gt));
+        }
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(best,t,_CMP_GE_OQ));
+        if(mask)
+        {
+            _mm256_store_ps(best_lanes,best);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(row_lanes),best_row);
+            while(mask)
+            {
+                int lane = __builtin_ctz(mask);
+                indices[count] = col + lane;
+                max_values[count] = best_lanes[lane];
+                argmax[count] = row_lanes[lane];
+                count++;
+                mask &= mask - 1;
+            }
+        }
+    }
+    return detail::scan_column_max_tail(data,rows,col,cols,row_stride,thresh,indices,max_values,argmax,count);
+}
+
+void suppress_overlaps_avx2(const BoxesSoA& boxes,int k,int begin,int end,float iou_thresh,uint8_t* suppressed)
+{
+    const __m256 kx1 = _mm256_set1_ps(boxes.x1[k]),ky1 = _mm256_set1_ps(boxes.y1[k]);
+    const __m256 kx2 = _mm256_set1_ps(boxes.x2[k]),ky2 = _mm256_set1_ps(boxes.y2[k]);
+    const __m256 karea = _mm256_set1_ps(boxes.area[k]);
+    const __m256 t = _mm256_set1_ps(iou_thresh);
+    const __m256 zero = _mm256_setzero_ps();
+    int i = begin;
+    for(;i + 8 <= end;i += 8)
+    {
+        __m256 w = _mm256_max_ps(zero,_mm256_sub_ps(_mm256_min_ps(kx2,_mm256_loadu_ps(boxes.x2 + i)),_mm256_max_ps(kx1,_mm256_loadu_ps(boxes.x1 + i))));
+        __m256 h = _mm256_max_ps(zero,_mm256_sub_ps(_mm256_min_ps(ky2,_mm256_loadu_ps(boxes.y2 + i)),_mm256_max_ps(ky1,_mm256_loadu_ps(boxes.y1 + i))));
+        __m256 inter = _mm256_mul_ps(w,h);
+        __m256 uni = _mm256_sub_ps(_mm256_add_ps(karea,_mm256_loadu_ps(boxes.area + i)),inter);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(inter,_mm256_mul_ps(t,uni),_CMP_GT_OQ));
+        while(mask)
+        {
+            suppressed[i + __builtin_ctz(mask)] = 1;
+            mask &= mask - 1;
+        }
+    }
+    detail::suppress_overlaps_tail(boxes,k,i,end,iou_thresh,suppressed);
+}
+
+void fill_u8c3_avx2(uint8_t* dst,size_t pixels,uint8_t c0,uint8_t c1,uint8_t c2)
+{
+    //32个像素 = 96字节 = 3个寄存器
+    alignas(32) uint8_t pattern[96];
+    detail::make_fill_pattern(pattern,sizeof(pattern),c0,c1,c2);
+    const __m256i p0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern));
+    const __m256i p1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern + 32));
+    const __m256i p2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern + 64));
+    size_t i = 0;
+    for(;i + 32 <= pixels;i += 32)
+    {
+        __m256i* out = reinterpret_cast<__m256i*>(dst + 3 * i);
+        _mm256_storeu_si256(out,p0);
+        _mm256_storeu_si256(out + 1,p1);
+        _mm256_storeu_si256(out + 2,p2);
+    }
+    detail::fill_u8c3_tail(dst + 3 * i,pixels - i,c0,c1,c2);
+}
+
+} // namespace
+
+void color_mask_u8c3_avx2(const uint8_t* src,size_t pixels,int primary,int secondary,uint8_t min_value,uint8_t min_diff,uint8_t* mask)
+{
+    //vpshufb只在128位通道内取字节: 低128位处理前16个像素(字节0~47),高128位处理后16个像素(字节48~95),
+    //两个通道使用相同的pshufb掩码,结果按顺序就是32个像素的掩码
+    alignas(16) uint8_t primary_shuffle[48];
+    alignas(16) uint8_t secondary_shuffle[48];
+    detail::make_channel_shuffle(primary_shuffle,primary);
+    detail::make_channel_shuffle(secondary_shuffle,secondary);
+    auto broadcast = [](const uint8_t* p)
+    {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(p)));
+    };
+    const __m256i p0 = broadcast(primary_shuffle),p1 = broadcast(primary_shuffle + 16),p2 = broadcast(primary_shuffle + 32);
+    const __m256i s0 = broadcast(secondary_shuffle),s1 = broadcast(secondary_shuffle + 16),s2 = broadcast(secondary_shuffle + 32);
+    const __m256i value_thresh = _mm256_set1_epi8(static_cast<char>(min_value));
+    const __m256i diff_thresh = _mm256_set1_epi8(static_cast<char>(min_diff));
+    auto load_pair = [](const uint8_t* low,const uint8_t* high)
+    {
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low))),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(high)),1);
+    };
+    size_t i = 0;
+    for(;i + 32 <= pixels;i += 32)
+    {
+        const uint8_t* in = src + 3 * i;
+        const __m256i a = load_pair(in,in + 48);
+        const __m256i b = load_pair(in + 16,in + 64);
+        const __m256i c = load_pair(in + 32,in + 80);
+        const __m256i p = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a,p0),_mm256_shuffle_epi8(b,p1)),_mm256_shuffle_epi8(c,p2));
+        const __m256i s = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a,s0),_mm256_shuffle_epi8(b,s1)),_mm256_shuffle_epi8(c,s2));
+        const __m256i diff = _mm256_subs_epu8(p,s);
+        const __m256i bright = _mm256_cmpeq_epi8(_mm256_max_epu8(p,value_thresh),p);
+        const __m256i colored = _mm256_cmpeq_epi8(_mm256_max_epu8(diff,diff_thresh),diff);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mask + i),_mm256_and_si256(bright,colored));
+    }
+    detail::color_mask_u8c3_tail(src,i,pixels,primary,secondary,min_value,min_diff,mask);
+}
+
+const Kernels avx2_kernels = {
+    scan_strided_avx2,
+    scan_column_max_avx2,
+    suppress_overlaps_avx2,
+    fill_u8c3_avx2,
+    color_mask_u8c3_avx2,
+};
+
+} // namespace Simd
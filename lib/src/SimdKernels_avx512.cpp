@@ -0,0 +1,111 @@
+//本文件以-mavx512f编译,只在cpu支持时通过内核表调用
+#include"SimdKernelsImpl.h"
+#include<immintrin.h>
+
+namespace Simd
+{
+
+namespace
+{
+
+int scan_strided_avx512(const float* data,int rows,int stride,float thresh,int* indices)
+{
+    const __m512 t = _mm512_set1_ps(thresh);
+    const __m512i lanes = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    const __m512i offsets = _mm512_mullo_epi32(lanes,_mm512_set1_epi32(stride));
+    int count = 0;
+    int row = 0;
+    for(;row + 16 <= rows;row += 16)
+    {
+        const float* p = data + static_cast<size_t>(row) * stride;
+        __m512 v = stride == 1 ? _mm512_loadu_ps(p) : _mm512_i32gather_ps(offsets,p,4);
+        __mmask16 mask = _mm512_cmp_ps_mask(v,t,_CMP_GE_OQ);
+        //把命中的行号紧凑地写出
+        _mm512_mask_compressstoreu_epi32(indices + count,mask,_mm512_add_epi32(lanes,_mm512_set1_epi32(row)));
+        count += __builtin_popcount(mask);
+    }
+    return detail::scan_strided_tail(data,row,rows,stride,thresh,indices,count);
+}
+
+int scan_column_max_avx512(const float* data,int rows,int cols,int row_stride,float thresh,
+                           int* indices,float* max_values,int* argmax)
+{
+    const __m512 t = _mm512_set1_ps(thresh);
+    const __m512i lanes = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    int count = 0;
+    int col = 0;
+    for(;col + 16 <= cols;col += 16)
+    {
+        __m512 best = _mm512_loadu_ps(data + col);
+        __m512i best_row = _mm512_setzero_si512();
+        for(int row = 1;row < rows;row++)
+        {
+            __m512 v = _mm512_loadu_ps(data + static_cast<size_t>(row) * row_stride + col);
+            __mmask16 gt = _mm512_cmp_ps_mask(v,best,_CMP_GT_OQ);
+            best = _mm512_mask_blend_ps(gt,best,v);
+            best_row = _mm512_mask_blend_epi32(gt,best_row,_mm512_set1_epi32(row));
+        }
+        __mmask16 mask = _mm512_cmp_ps_mask(best,t,_CMP_GE_OQ);
+        if(mask)
+        {
+            _mm512_mask_compressstoreu_epi32(indices + count,mask,_mm512_add_epi32(lanes,_mm512_set1_epi32(col)));
+            _mm512_mask_compressstoreu_ps(max_values + count,mask,best);
+            _mm512_mask_compressstoreu_epi32(argmax + count,mask,best_row);
+            count += __builtin_popcount(mask);
+        }
+    }
+    return detail::scan_column_max_tail(data,rows,col,cols,row_stride,thresh,indices,max_values,argmax,count);
+}
+
+void suppress_overlaps_avx512(const BoxesSoA& boxes,int k,int begin,int end,float iou_thresh,uint8_t* suppressed)
+{
+    const __m512 kx1 = _mm512_set1_ps(boxes.x1[k]),ky1 = _mm512_set1_ps(boxes.y1[k]);
+    const __m512 kx2 = _mm512_set1_ps(boxes.x2[k]),ky2 = _mm512_set1_ps(boxes.y2[k]);
+    const __m512 karea = _mm512_set1_ps(boxes.area[k]);
+    const __m512 t = _mm512_set1_ps(iou_thresh);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512i one = _mm512_set1_epi32(1);
+    int i = begin;
+    for(;i + 16 <= end;i += 16)
+    {
+        __m512 w = _mm512_max_ps(zero,_mm512_sub_ps(_mm512_min_ps(kx2,_mm512_loadu_ps(boxes.x2 + i)),_mm512_max_ps(kx1,_mm512_loadu_ps(boxes.x1 + i))));
+        __m512 h = _mm512_max_ps(zero,_mm512_sub_ps(_mm512_min_ps(ky2,_mm512_loadu_ps(boxes.y2 + i)),_mm512_max_ps(ky1,_mm512_loadu_ps(boxes.y1 + i))));
+        __m512 inter = _mm512_mul_ps(w,h);
+        __m512 uni = _mm512_sub_ps(_mm512_add_ps(karea,_mm512_loadu_ps(boxes.area + i)),inter);
+        __mmask16 mask = _mm512_cmp_ps_mask(inter,_mm512_mul_ps(t,uni),_CMP_GT_OQ);
+        //只写被抑制的位置
+        _mm512_mask_cvtepi32_storeu_epi8(suppressed + i,mask,one);
+    }
+    detail::suppress_overlaps_tail(boxes,k,i,end,iou_thresh,suppressed);
+}
+
+void fill_u8c3_avx512(uint8_t* dst,size_t pixels,uint8_t c0,uint8_t c1,uint8_t c2)
+{
+    //64个像素 = 192字节 = 3个寄存器
+    alignas(64) uint8_t pattern[192];
+    detail::make_fill_pattern(pattern,sizeof(pattern),c0,c1,c2);
+    const __m512i p0 = _mm512_load_si512(pattern);
+    const __m512i p1 = _mm512_load_si512(pattern + 64);
+    const __m512i p2 = _mm512_load_si512(pattern + 128);
+    size_t i = 0;
+    for(;i + 64 <= pixels;i += 64)
+    {
+        uint8_t* out = dst + 3 * i;
+        _mm512_storeu_si512(out,p0);
+        _mm512_storeu_si512(out + 64,p1);
+        _mm512_storeu_si512(out + 128,p2);
+    }
+    detail::fill_u8c3_tail(dst + 3 * i,pixels - i,c0,c1,c2);
+}
+
+} // namespace
+
+const Kernels avx512_kernels = {
+    scan_strided_avx512,
+    scan_column_max_avx512,
+    suppress_overlaps_avx512,
+    fill_u8c3_avx512,
+    color_mask_u8c3_avx2,
+};
+
+} // namespace Simd
@@ -0,0 +1,161 @@
+//本文件以-msse4.2编译,只在cpu支持时通过内核表调用
+#include"SimdKernelsImpl.h"
+#include<immintrin.h>
+
+namespace Simd
+{
+
+namespace
+{
+
+//把掩码中置位的通道对应的行号依次写入indices
+inline int emit_indices(int mask,int base,int* indices,int count)
+{
+    while(mask)
+    {
+        int lane = __builtin_ctz(mask);
+        indices[count++] = base + lane;
+        mask &= mask - 1;
+    }
+    return count;
+}
+
+int scan_strided_sse42(const float* data,int rows,int stride,float thresh,int* indices)
+{
+    const __m128 t = _mm_set1_ps(thresh);
+    int count = 0;
+    int row = 0;
+    for(;row + 4 <= rows;row += 4)
+    {
+        const float* p = data + static_cast<size_t>(row) * stride;
+        __m128 v = stride == 1 ? _mm_loadu_ps(p) : _mm_setr_ps(p[0],p[stride],p[2 * stride],p[3 * stride]);
+        count = emit_indices(_mm_movemask_ps(_mm_cmpge_ps(v,t)),row,indices,count);
+    }
+    return detail::scan_strided_tail(data,row,rows,stride,thresh,indices,count);
+}
+
+int scan_column_max_sse42(const float* data,int rows,int cols,int row_stride,float thresh,
+                          int* indices,float* max_values,int* argmax)
+{
+    const __m128 t = _mm_set1_ps(thresh);
+    int count = 0;
+    int col = 0;
+    alignas(16) float best_lanes[4];
+    alignas(16) int row_lanes[4];
+    for(;col + 4 <= cols;col += 4)
+    {
+        __m128 best = _mm_loadu_ps(data + col);
+        __m128i best_row = _mm_setzero_si128();
+        for(int row = 1;row < rows;row++)
+        {
+            __m128 v = _mm_loadu_ps(data + static_cast<size_t>(row) * row_stride + col);
+            __m128 gt = _mm_cmpgt_ps(v,best);
+            best = _mm_blendv_ps(best,v,gt);
+            best_row = _mm_blendv_epi8(best_row,_mm_set1_epi32(row),_mm_castps_si128(gt));
+        }
+        int mask = _mm_movemask_ps(_mm_cmpge_ps(best,t));
+        if(mask)
+        {
+            _mm_store_ps(best_lanes,best);
+            _mm_store_si128(reinterpret_cast<__m128i*>(row_lanes),best_row);
+            while(mask)
+            {
+                int lane = __builtin_ctz(mask);
+                indices[count] = col + lane;
+                max_values[count] = best_lanes[lane];
+                argmax[count] = row_lanes[lane];
+                count++;
+                mask &= mask - 1;
+            }
+        }
+    }
+    return detail::scan_column_max_tail(data,rows,col,cols,row_stride,thresh,indices,max_values,argmax,count);
+}
+
+void suppress_overlaps_sse42(const BoxesSoA& boxes,int k,int begin,int end,float iou_thresh,uint8_t* suppressed)
+{
+    const __m128 kx1 = _mm_set1_ps(boxes.x1[k]),ky1 = _mm_set1_ps(boxes.y1[k]);
+    const __m128 kx2 = _mm_set1_ps(boxes.x2[k]),ky2 = _mm_set1_ps(boxes.y2[k]);
+    const __m128 karea = _mm_set1_ps(boxes.area[k]);
+    const __m128 t = _mm_set1_ps(iou_thresh);
+    const __m128 zero = _mm_setzero_ps();
+    int i = begin;
+    for(;i + 4 <= end;i += 4)
+    {
+        __m128 w = _mm_max_ps(zero,_mm_sub_ps(_mm_min_ps(kx2,_mm_loadu_ps(boxes.x2 + i)),_mm_max_ps(kx1,_mm_loadu_ps(boxes.x1 + i))));
+        __m128 h = _mm_max_ps(zero,_mm_sub_ps(_mm_min_ps(ky2,_mm_loadu_ps(boxes.y2 + i)),_mm_max_ps(ky1,_mm_loadu_ps(boxes.y1 + i))));
+        __m128 inter = _mm_mul_ps(w,h);
+        __m128 uni = _mm_sub_ps(_mm_add_ps(karea,_mm_loadu_ps(boxes.area + i)),inter);
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(inter,_mm_mul_ps(t,uni)));
+        while(mask)
+        {
+            suppressed[i + __builtin_ctz(mask)] = 1;
+            mask &= mask - 1;
+        }
+    }
+    detail::suppress_overlaps_tail(boxes,k,i,end,iou_thresh,suppressed);
+}
+
+void fill_u8c3_sse42(uint8_t* dst,size_t pixels,uint8_t c0,uint8_t c1,uint8_t c2)
+{
+    //16个像素 = 48字节 = 3个寄存器
+    alignas(16) uint8_t pattern[48];
+    detail::make_fill_pattern(pattern,sizeof(pattern),c0,c1,c2);
+    const __m128i p0 = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern));
+    const __m128i p1 = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern + 16));
+    const __m128i p2 = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern + 32));
+    size_t i = 0;
+    for(;i + 16 <= pixels;i += 16)
+    {
+        __m128i* out = reinterpret_cast<__m128i*>(dst + 3 * i);
+        _mm_storeu_si128(out,p0);
+        _mm_storeu_si128(out + 1,p1);
+        _mm_storeu_si128(out + 2,p2);
+    }
+    detail::fill_u8c3_tail(dst + 3 * i,pixels - i,c0,c1,c2);
+}
+
+void color_mask_u8c3_sse42(const uint8_t* src,size_t pixels,int primary,int secondary,uint8_t min_value,uint8_t min_diff,uint8_t* mask)
+{
+    //16个像素 = 48字节 = 3个寄存器,pshufb取出两个通道后做饱和减法和无符号比较
+    alignas(16) uint8_t primary_shuffle[48];
+    alignas(16) uint8_t secondary_shuffle[48];
+    detail::make_channel_shuffle(primary_shuffle,primary);
+    detail::make_channel_shuffle(secondary_shuffle,secondary);
+    const __m128i p0 = _mm_load_si128(reinterpret_cast<const __m128i*>(primary_shuffle));
+    const __m128i p1 = _mm_load_si128(reinterpret_cast<const __m128i*>(primary_shuffle + 16));
+    const __m128i p2 = _mm_load_si128(reinterpret_cast<const __m128i*>(primary_shuffle + 32));
+    const __m128i s0 = _mm_load_si128(reinterpret_cast<const __m128i*>(secondary_shuffle));
+    const __m128i s1 = _mm_load_si128(reinterpret_cast<const __m128i*>(secondary_shuffle + 16));
+    const __m128i s2 = _mm_load_si128(reinterpret_cast<const __m128i*>(secondary_shuffle + 32));
+    const __m128i value_thresh = _mm_set1_epi8(static_cast<char>(min_value));
+    const __m128i diff_thresh = _mm_set1_epi8(static_cast<char>(min_diff));
+    size_t i = 0;
+    for(;i + 16 <= pixels;i += 16)
+    {
+        const __m128i* in = reinterpret_cast<const __m128i*>(src + 3 * i);
+        const __m128i a = _mm_loadu_si128(in);
+        const __m128i b = _mm_loadu_si128(in + 1);
+        const __m128i c = _mm_loadu_si128(in + 2);
+        const __m128i p = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a,p0),_mm_shuffle_epi8(b,p1)),_mm_shuffle_epi8(c,p2));
+        const __m128i s = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a,s0),_mm_shuffle_epi8(b,s1)),_mm_shuffle_epi8(c,s2));
+        const __m128i diff = _mm_subs_epu8(p,s);
+        //x >= t 即 max(x,t) == x
+        const __m128i bright = _mm_cmpeq_epi8(_mm_max_epu8(p,value_thresh),p);
+        const __m128i colored = _mm_cmpeq_epi8(_mm_max_epu8(diff,diff_thresh),diff);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mask + i),_mm_and_si128(bright,colored));
+    }
+    detail::color_mask_u8c3_tail(src,i,pixels,primary,secondary,min_value,min_diff,mask);
+}
+
+} // namespace
+
+const Kernels sse42_kernels = {
+    scan_strided_sse42,
+    scan_column_max_sse42,
+    suppress_overlaps_sse42,
+    fill_u8c3_sse42,
+    color_mask_u8c3_sse42,
+};
+
+} // namespace Simd
@@ -0,0 +1,267 @@
+#include "StageProfiler.h"
+#include<cstdio>
+#include<cstdlib>
+#include<fstream>
+#include<iostream>
+#include<memory>
+#include<mutex>
+#include<vector>
+#include<condition_variable>
+#include<algorithm>
+
+namespace StageProfiler
+{
+
+namespace
+{
+
+//单个线程的全部直方图,只由所属线程写入
+struct ThreadHistograms
+{
+    std::array<std::array<std::atomic<uint64_t>, Histogram::bucket_count>, stage_count> counts{};
+    std::array<std::atomic<uint64_t>, stage_count> max_ns{};
+};
+
+//汇总后的某一阶段统计
+struct StageSnapshot
+{
+    std::array<uint64_t, Histogram::bucket_count> counts{};
+    uint64_t total = 0;
+    uint64_t max_ns = 0;
+};
+
+bool env_enabled()
+{
+    const char* env = std::getenv("STAGE_PROFILER");
+    return env != nullptr && env[0] != '\0' && env[0] != '0';
+}
+
+std::atomic<bool> g_enabled{env_enabled()};
+
+//线程注册表,只在线程第一次记录和汇总时加锁
+std::mutex g_threads_mutex;
+std::vector<std::shared_ptr<ThreadHistograms>> g_threads;
+
+//上一次报告时的累计值,用于求时间窗内的增量
+std::mutex g_report_mutex;
+std::array<std::array<uint64_t, Histogram::bucket_count>, stage_count> g_last_counts{};
+std::chrono::steady_clock::time_point g_last_report = std::chrono::steady_clock::now();
+std::string g_csv_path;
+
+//周期报告线程
+std::thread g_report_thread;
+std::mutex g_report_thread_mutex;
+std::condition_variable g_report_cv;
+bool g_report_running = false;
+
+ThreadHistograms& local_histograms()
+{
+    thread_local std::shared_ptr<ThreadHistograms> local = []()
+    {
+        auto histograms = std::make_shared<ThreadHistograms>();
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        g_threads.push_back(histograms);
+        return histograms;
+    }();
+    return *local;
+}
+
+uint64_t percentile(const StageSnapshot& snapshot, double q)
+{
+    if(snapshot.total == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * (snapshot.total - 1)) + 1;
+    uint64_t seen = 0;
+    for(int i = 0; i < Histogram::bucket_count; i++)
+    {
+        seen += snapshot.counts[i];
+        if(seen >= rank)
+        {
+            return Histogram::value_of(i);
+        }
+    }
+    return snapshot.max_ns;
+}
+
+}
+
+const char* stage_name(Stage stage)
+{
+    static const char* names[stage_count] =
+    {
+        "grab", "demosaic", "proposal", "roi_crop", "letterbox", "infer", "decode", "nms", "refine", "pnp", "draw"
+    };
+    return (stage >= 0 && stage < stage_count) ? names[stage] : "unknown";
+}
+
+int Histogram::bucket_of(uint64_t ns)
+{
+    if(ns < static_cast<uint64_t>(sub_count))
+    {
+        return static_cast<int>(ns);
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - sub_bits;
+    int bucket = (shift + 1) * sub_count + static_cast<int>((ns >> shift) & (sub_count - 1));
+    return bucket < bucket_count ? bucket : bucket_count - 1;
+}
+
+uint64_t Histogram::value_of(int bucket)
+{
+    if(bucket < sub_count)
+    {
+        return static_cast<uint64_t>(bucket);
+    }
+    int shift = bucket / sub_count - 1;
+    uint64_t lower = static_cast<uint64_t>(sub_count + bucket % sub_count) << shift;
+    return lower + ((1ull << shift) >> 1);
+}
+
+void set_enabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool is_enabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void record(Stage stage, uint64_t ns)
+{
+    ThreadHistograms& local = local_histograms();
+
+    //单写者,不需要原子读改写
+    std::atomic<uint64_t>& count = local.counts[stage][Histogram::bucket_of(ns)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    std::atomic<uint64_t>& max_ns = local.max_ns[stage];
+    if(ns > max_ns.load(std::memory_order_relaxed))
+    {
+        max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void report_now()
+{
+    std::vector<std::shared_ptr<ThreadHistograms>> threads;
+    {
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        threads = g_threads;
+    }
+
+    std::lock_guard<std::mutex> lock(g_report_mutex);
+
+    //汇总所有线程,减去上次报告的累计值得到时间窗内的分布
+    std::array<StageSnapshot, stage_count> snapshots;
+    for(int stage = 0; stage < stage_count; stage++)
+    {
+        StageSnapshot& snapshot = snapshots[stage];
+        for(const auto& thread : threads)
+        {
+            for(int i = 0; i < Histogram::bucket_count; i++)
+            {
+                snapshot.counts[i] += thread->counts[stage][i].load(std::memory_order_relaxed);
+            }
+            snapshot.max_ns = std::max(snapshot.max_ns, thread->max_ns[stage].exchange(0, std::memory_order_relaxed));
+        }
+        for(int i = 0; i < Histogram::bucket_count; i++)
+        {
+            uint64_t cumulative = snapshot.counts[i];
+            snapshot.counts[i] = cumulative - g_last_counts[stage][i];
+            g_last_counts[stage][i] = cumulative;
+            snapshot.total += snapshot.counts[i];
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double window_s = std::chrono::duration<double>(now - g_last_report).count();
+    g_last_report = now;
+
+    //控制台表格
+    std::printf("---------------- stage latency (%.1fs) ----------------\n", window_s);
+    std::printf("%-10s %8s %9s %9s %9s %9s %9s\n", "stage", "count", "per_s", "p50_us", "p90_us", "p99_us", "max_us");
+    for(int stage = 0; stage < stage_count; stage++)
+    {
+        const StageSnapshot& snapshot = snapshots[stage];
+        if(snapshot.total == 0)
+        {
+            continue;
+        }
+        std::printf("%-10s %8llu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+            stage_name(static_cast<Stage>(stage)),
+            static_cast<unsigned long long>(snapshot.total),
+            window_s > 0 ? snapshot.total / window_s : 0.0,
+            percentile(snapshot, 0.50) / 1e3,
+            percentile(snapshot, 0.90) / 1e3,
+            percentile(snapshot, 0.99) / 1e3,
+            snapshot.max_ns / 1e3);
+    }
+    std::fflush(stdout);
+
+    //csv追加
+    if(!g_csv_path.empty())
+    {
+        std::ofstream csv(g_csv_path, std::ios::app);
+        if(csv.tellp() == 0)
+        {
+            csv << "unix_time_s,window_s,stage,count,per_s,p50_us,p90_us,p99_us,max_us\n";
+        }
+        double unix_time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+        for(int stage = 0; stage < stage_count; stage++)
+        {
+            const StageSnapshot& snapshot = snapshots[stage];
+            if(snapshot.total == 0)
+            {
+                continue;
+            }
+            csv << std::fixed << unix_time << ',' << window_s << ','
+                << stage_name(static_cast<Stage>(stage)) << ','
+                << snapshot.total << ','
+                << (window_s > 0 ? snapshot.total / window_s : 0.0) << ','
+                << percentile(snapshot, 0.50) / 1e3 << ','
+                << percentile(snapshot, 0.90) / 1e3 << ','
+                << percentile(snapshot, 0.99) / 1e3 << ','
+                << snapshot.max_ns / 1e3 << '\n';
+        }
+    }
+}
+
+void start_report(std::chrono::milliseconds period, const std::string& csv_path)
+{
+    stop_report();
+    {
+        std::lock_guard<std::mutex> lock(g_report_mutex);
+        g_csv_path = csv_path;
+    }
+
+    std::lock_guard<std::mutex> lock(g_report_thread_mutex);
+    g_report_running = true;
+    g_report_thread = std::thread([period]()
+    {
+        std::unique_lock<std::mutex> lock(g_report_thread_mutex);
+        while(!g_report_cv.wait_for(lock, period, []() { return !g_report_running; }))
+        {
+            lock.unlock();
+            report_now();
+            lock.lock();
+        }
+    });
+}
+
+void stop_report()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_report_thread_mutex);
+        g_report_running = false;
+    }
+    g_report_cv.notify_all();
+    if(g_report_thread.joinable())
+    {
+        g_report_thread.join();
+    }
+}
+
+}
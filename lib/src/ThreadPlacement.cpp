@@ -0,0 +1,252 @@
+#include"ThreadPlacement.h"
+#include<algorithm>
+#include<cerrno>
+#include<cstdio>
+#include<cstring>
+#include<iostream>
+#include<pthread.h>
+#include<sched.h>
+#include<sys/mman.h>
+
+namespace ThreadPlacement
+{
+
+namespace
+{
+
+bool parse_int(const std::string& text,int& value)
+{
+    if(text.empty() || text.find_first_not_of("0123456789") != std::string::npos || text.size() > 4)
+    {
+        return false;
+    }
+    value = std::stoi(text);
+    return true;
+}
+
+bool set_affinity(const std::vector<int>& cpus)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for(int cpu : cpus)
+    {
+        CPU_SET(cpu,&cpu_set);
+    }
+    return pthread_setaffinity_np(pthread_self(),sizeof(cpu_set),&cpu_set) == 0;
+}
+
+bool get_affinity(std::vector<int>& cpus)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if(pthread_getaffinity_np(pthread_self(),sizeof(cpu_set),&cpu_set) != 0)
+    {
+        return false;
+    }
+    cpus.clear();
+    for(int cpu = 0;cpu < CPU_SETSIZE;cpu++)
+    {
+        if(CPU_ISSET(cpu,&cpu_set))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool parse_cpu_list(const std::string& text,std::vector<int>& cpus)
+{
+    cpus.clear();
+    size_t begin = 0;
+    while(begin <= text.size())
+    {
+        size_t end = text.find('+',begin);
+        if(end == std::string::npos)
+        {
+            end = text.size();
+        }
+        const std::string item = text.substr(begin,end - begin);
+        const size_t dash = item.find('-');
+        int first = 0,last = 0;
+        if(dash == std::string::npos)
+        {
+            if(!parse_int(item,first))
+            {
+                return false;
+            }
+            last = first;
+        }
+        else if(!parse_int(item.substr(0,dash),first) || !parse_int(item.substr(dash + 1),last) || last < first)
+        {
+            return false;
+        }
+        if(last >= CPU_SETSIZE)
+        {
+            return false;
+        }
+        for(int cpu = first;cpu <= last;cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+        begin = end + 1;
+    }
+    std::sort(cpus.begin(),cpus.end());
+    cpus.erase(std::unique(cpus.begin(),cpus.end()),cpus.end());
+    return !cpus.empty();
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus)
+{
+    std::string text;
+    for(size_t i = 0;i < cpus.size();)
+    {
+        //连续的cpu合并成范围
+        size_t j = i;
+        while(j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+        {
+            j++;
+        }
+        if(!text.empty())
+        {
+            text += '+';
+        }
+        text += std::to_string(cpus[i]);
+        if(j > i)
+        {
+            text += '-' + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return text;
+}
+
+bool Config::parse(const std::string& text,Config& config)
+{
+    config.my_specs.clear();
+    size_t begin = 0;
+    while(begin < text.size())
+    {
+        size_t end = text.find(',',begin);
+        if(end == std::string::npos)
+        {
+            end = text.size();
+        }
+        const std::string item = text.substr(begin,end - begin);
+        begin = end + 1;
+        if(item.empty())
+        {
+            continue;
+        }
+
+        //名称=cpu列表[:优先级]
+        const size_t equal = item.find('=');
+        if(equal == std::string::npos || equal == 0)
+        {
+            std::cout<<"[ThreadPlacement] 无法解析 "<<item<<", 应为 名称=cpu列表[:优先级]"<<std::endl;
+            return false;
+        }
+        const std::string name = item.substr(0,equal);
+        std::string cpus = item.substr(equal + 1);
+        ThreadSpec spec;
+        const size_t colon = cpus.find(':');
+        if(colon != std::string::npos)
+        {
+            const int max_priority = sched_get_priority_max(SCHED_FIFO);
+            if(!parse_int(cpus.substr(colon + 1),spec.priority) || spec.priority > max_priority)
+            {
+                std::cout<<"[ThreadPlacement] "<<name<<" 的优先级应为0~"<<max_priority<<std::endl;
+                return false;
+            }
+            cpus = cpus.substr(0,colon);
+        }
+        if(!cpus.empty() && !parse_cpu_list(cpus,spec.cpus))
+        {
+            std::cout<<"[ThreadPlacement] "<<name<<" 的cpu列表 "<<cpus<<" 格式错误, 例: 0  2-3  1+4-5"<<std::endl;
+            return false;
+        }
+        config.my_specs[name] = spec;
+    }
+    return true;
+}
+
+const ThreadSpec* Config::find(const std::string& name) const
+{
+    auto it = this->my_specs.find(name);
+    return it == this->my_specs.end() ? nullptr : &it->second;
+}
+
+void Config::print() const
+{
+    std::printf("========== 线程布局 ==========\n");
+    for(const auto& item : this->my_specs)
+    {
+        const ThreadSpec& spec = item.second;
+        std::printf("%-12s cpu %-10s %s\n",item.first.c_str(),
+                    spec.cpus.empty() ? "any" : format_cpu_list(spec.cpus).c_str(),
+                    spec.is_realtime() ? ("SCHED_FIFO " + std::to_string(spec.priority)).c_str() : "SCHED_OTHER");
+    }
+    std::fflush(stdout);
+}
+
+bool apply_to_current_thread(const std::string& name,const ThreadSpec& spec)
+{
+    //线程名最多15个字符
+    pthread_setname_np(pthread_self(),name.substr(0,15).c_str());
+    bool ok = true;
+    if(!spec.cpus.empty() && !set_affinity(spec.cpus))
+    {
+        //cpu不存在或不在cpuset cgroup允许的范围内
+        std::cout<<"[ThreadPlacement] 线程 "<<name<<" 绑定cpu "<<format_cpu_list(spec.cpus)<<" 失败"<<std::endl;
+        ok = false;
+    }
+    if(spec.is_realtime())
+    {
+        sched_param param;
+        std::memset(&param,0,sizeof(param));
+        param.sched_priority = spec.priority;
+        int ret = pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
+        if(ret != 0)
+        {
+            std::cout<<"[ThreadPlacement] 线程 "<<name<<" 设置SCHED_FIFO "<<spec.priority<<" 失败: "<<std::strerror(ret)
+                     <<(ret == EPERM ? " (需要CAP_SYS_NICE或ulimit -r)" : "")<<std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool lock_memory()
+{
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        std::cout<<"[ThreadPlacement] mlockall失败: "<<std::strerror(errno)
+                 <<(errno == ENOMEM || errno == EPERM ? " (需要CAP_IPC_LOCK或调大ulimit -l)" : "")<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+ScopedAffinity::ScopedAffinity(const std::vector<int>& cpus)
+{
+    if(cpus.empty() || !get_affinity(this->my_saved))
+    {
+        return;
+    }
+    this->my_active = set_affinity(cpus);
+    if(!this->my_active)
+    {
+        std::cout<<"[ThreadPlacement] 无法临时绑定cpu "<<format_cpu_list(cpus)<<std::endl;
+    }
+}
+
+ScopedAffinity::~ScopedAffinity()
+{
+    if(this->my_active)
+    {
+        set_affinity(this->my_saved);
+    }
+}
+
+} // namespace ThreadPlacement
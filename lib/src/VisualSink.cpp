@@ -0,0 +1,34 @@
+#include "VisualSink.h"
+#include<cstdlib>
+
+namespace Visual
+{
+
+namespace
+{
+    //-1未设置,0有界面,1无界面
+    std::atomic<int> headless_state{-1};
+}
+
+//无界面模式
+void set_headless(bool headless)
+{
+    headless_state.store(headless ? 1 : 0);
+}
+
+bool is_headless()
+{
+    int state = headless_state.load();
+    if(state < 0)
+    {
+        //没有显示服务时默认无界面,避免OpenCV窗口函数直接退出程序
+        const char* display = std::getenv("DISPLAY");
+        const char* wayland = std::getenv("WAYLAND_DISPLAY");
+        bool no_display = (display == nullptr || *display == '\0') && (wayland == nullptr || *wayland == '\0');
+        state = no_display ? 1 : 0;
+        headless_state.store(state);
+    }
+    return state == 1;
+}
+
+} // namespace Visual
@@ -0,0 +1,113 @@
+#include"Pipeline.h"
+#include<chrono>
+#include<cstdio>
+#include<thread>
+#include<vector>
+
+//keep_latest: 数据源远快于下游时,下游处理的帧号递增,且最后处理的一定是数据源最后放入的帧
+//drop_newest: 同样的负载下最后放入的帧被丢弃(对照)
+//帧对象循环使用: 数据源拿到没有缓冲区的新对象的次数不超过流水线中T的总数
+namespace
+{
+    struct Item
+    {
+        int id = -1;
+        std::vector<int> buffer;
+    };
+
+    //两级流水线跑count帧,返回数据源拿到新对象(缓冲区未分配)的次数
+    int run_fresh(Pipeline::DropPolicy policy,int count)
+    {
+        Pipeline::Pipeline<Item> pipeline;
+        int next = 0;
+        int fresh = 0;
+        pipeline.set_source("source",[&](Item& item)
+        {
+            if(next == count)
+            {
+                return false;
+            }
+            if(item.buffer.capacity() == 0)
+            {
+                fresh++;
+                item.buffer.reserve(64);
+            }
+            item.id = next++;
+            return true;
+        });
+        pipeline.add_stage("first",[&](Item& item)
+        {
+            return item.id >= 0;
+        },{2,policy});
+        pipeline.add_stage("second",[&](Item& item)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            return item.buffer.capacity() >= 64;
+        },{2,Pipeline::block});
+        pipeline.start();
+        pipeline.wait();
+        return fresh;
+    }
+
+    //返回下游依次处理的帧号
+    std::vector<int> run(Pipeline::DropPolicy policy,int count)
+    {
+        Pipeline::Pipeline<Item> pipeline;
+        std::vector<int> seen;
+        int next = 0;
+        pipeline.set_source("source",[&](Item& item)
+        {
+            if(next == count)
+            {
+                return false;
+            }
+            item.id = next++;
+            return true;
+        });
+        pipeline.add_stage("slow",[&](Item& item)
+        {
+            seen.push_back(item.id);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            return true;
+        },{2,policy});
+        pipeline.start();
+        pipeline.wait();
+        return seen;
+    }
+
+    bool check(bool ok,const char* what)
+    {
+        std::printf("[%s] %s\n",ok ? "PASS" : "FAIL",what);
+        return ok;
+    }
+}
+
+int main()
+{
+    const int count = 2000;
+    bool ok = true;
+
+    const std::vector<int> latest = run(Pipeline::keep_latest,count);
+    ok &= check(!latest.empty() && latest.back() == count - 1,"keep_latest: 最后处理的是最后放入的帧");
+    bool increasing = true;
+    for(size_t i = 1;i < latest.size();i++)
+    {
+        increasing = increasing && latest[i] > latest[i - 1];
+    }
+    ok &= check(increasing,"keep_latest: 帧号递增");
+    ok &= check(latest.size() < static_cast<size_t>(count),"keep_latest: 积压时丢弃旧帧");
+
+    const std::vector<int> newest = run(Pipeline::drop_newest,count);
+    ok &= check(!newest.empty() && newest.back() < count - 1,"drop_newest: 队列满时丢弃新帧");
+
+    //数据源1个 + 每个阶段(队列2个 + 处理中1个 + 信箱3个)
+    const int pool = 1 + 2 * (2 + 1 + 3);
+    for(Pipeline::DropPolicy policy : {Pipeline::block,Pipeline::drop_newest,Pipeline::keep_latest})
+    {
+        const int fresh = run_fresh(policy,count);
+        std::printf("policy %d: %d fresh items\n",static_cast<int>(policy),fresh);
+        ok &= check(fresh <= pool,"帧对象循环使用,稳态下不再构造新对象");
+    }
+
+    return ok ? 0 : 1;
+}
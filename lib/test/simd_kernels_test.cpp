@@ -0,0 +1,19 @@
+#include"SimdKernels.h"
+#include<iostream>
+
+//各指令集的内核与scalar逐位一致(self_check遍历本机支持的全部指令集,不支持的跳过)
+int main()
+{
+    for(int isa = Simd::scalar;isa < Simd::isa_count;isa++)
+    {
+        std::cout<<"[SimdKernels] "<<Simd::isa_name(static_cast<Simd::Isa>(isa))<<": "
+                 <<(Simd::isa_supported(static_cast<Simd::Isa>(isa)) ? "支持" : "不支持")<<std::endl;
+    }
+    if(!Simd::self_check(true))
+    {
+        std::cout<<"[FAIL] 内核结果与scalar不一致"<<std::endl;
+        return 1;
+    }
+    std::cout<<"[PASS] 默认选择 "<<Simd::isa_name(Simd::get_isa())<<std::endl;
+    return 0;
+}
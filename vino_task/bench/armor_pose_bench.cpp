@@ -0,0 +1,188 @@
+#include "armor_pose.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+
+// 单个装甲板位姿解算的耗时与精度对比: 原来的迭代法 / IPPE / 上一帧热启动(后两者在归一化平面上),以及一帧多个装甲板的批量解算
+// 用随机位姿投影出的角点(加0.5像素噪声)作为输入,counters中给出平均重投影误差和平移误差
+
+namespace
+{
+    const cv::Mat K = (cv::Mat_<double>(3, 3) << 2.3331e+03, -1.6808, 690.8069,
+                       0, 2.3271e+03, 554.0654,
+                       0, 0, 1);
+    const cv::Mat D = (cv::Mat_<double>(1, 5) << -0.1382, 0.5323, 0.0012, -0.0023, 0);
+
+    std::shared_ptr<const CameraModel> camera_model()
+    {
+        static const auto model = std::make_shared<const CameraModel>(K, D, cv::Size(1440, 1080));
+        return model;
+    }
+
+    struct Sample
+    {
+        std::vector<cv::Point2f> image_points;//带噪声的角点
+        ArmorPose::ArmorPoseData truth;//真实位姿
+        ArmorPose::ArmorPoseData previous;//模拟的上一帧位姿
+    };
+
+    const std::vector<Sample> &samples()
+    {
+        static const std::vector<Sample> data = []()
+        {
+            ArmorPose::ArmorPoseSolver solver(camera_model());
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<double> distance(1.0, 6.0);
+            std::uniform_real_distribution<double> yaw(-1.0, 1.0);//弧度
+            std::uniform_real_distribution<double> pitch(-0.25, 0.25);
+            std::uniform_real_distribution<double> offset(-0.3, 0.3);
+            std::normal_distribution<float> noise(0.0f, 0.5f);
+            std::normal_distribution<double> motion(0.0, 0.01);
+
+            std::vector<Sample> result;
+            while (result.size() < 256)
+            {
+                Sample sample;
+                cv::Vec3d tvec(offset(rng), offset(rng) * 0.5, distance(rng));
+                cv::Vec3d rvec(pitch(rng), yaw(rng), 0.0);
+                cv::projectPoints(solver.get_world_points(ArmorPose::ArmorType::small), rvec, tvec, K, D, sample.image_points);
+
+                // 只保留完全落在画面内的装甲板
+                bool inside = true;
+                for (cv::Point2f &point : sample.image_points)
+                {
+                    inside = inside && point.x >= 0 && point.y >= 0 && point.x < 1440 && point.y < 1080;
+                    point += cv::Point2f(noise(rng), noise(rng));
+                }
+                if (!inside)
+                {
+                    continue;
+                }
+
+                sample.truth.valid = true;
+                sample.truth.rvec = rvec;
+                sample.truth.tvec = tvec;
+                sample.previous = sample.truth;
+                sample.previous.rvec += cv::Vec3d(motion(rng), motion(rng), motion(rng));
+                sample.previous.tvec += cv::Vec3d(motion(rng), motion(rng), motion(rng));
+                result.push_back(sample);
+            }
+            return result;
+        }();
+        return data;
+    }
+
+    // 对全部样本逐个解算,solve(solver, sample)返回一个位姿
+    template <typename Solve>
+    void run_samples(benchmark::State &state, Solve solve)
+    {
+        ArmorPose::ArmorPoseSolver solver(camera_model());
+        double reprojection_sum = 0.0, translation_sum = 0.0;
+        int solved = 0, total = 0;
+        for (auto _ : state)
+        {
+            for (const Sample &sample : samples())
+            {
+                ArmorPose::ArmorPoseData pose = solve(solver, sample);
+                benchmark::DoNotOptimize(pose);
+                total++;
+                if (pose.valid)
+                {
+                    solved++;
+                    reprojection_sum += pose.reprojection_error;
+                    translation_sum += cv::norm(pose.tvec - sample.truth.tvec);
+                }
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * samples().size());
+        state.counters["reproj_px"] = solved ? reprojection_sum / solved : 0.0;
+        state.counters["trans_err_mm"] = solved ? 1000.0 * translation_sum / solved : 0.0;
+        state.counters["solved_ratio"] = total ? static_cast<double>(solved) / total : 0.0;
+    }
+} // namespace
+
+// 原来的解法: 不带初值的SOLVEPNP_ITERATIVE
+static void BM_ArmorPnP_Iterative(benchmark::State &state)
+{
+    run_samples(state, [](const ArmorPose::ArmorPoseSolver &solver, const Sample &sample)
+                { return solver.solve_iterative(sample.image_points, ArmorPose::ArmorType::small); });
+}
+
+// 平面闭式解
+static void BM_ArmorPnP_IPPE(benchmark::State &state)
+{
+    run_samples(state, [](const ArmorPose::ArmorPoseSolver &solver, const Sample &sample)
+                { return solver.solve_one(sample.image_points, ArmorPose::ArmorType::small, nullptr); });
+}
+
+// 从上一帧位姿热启动
+static void BM_ArmorPnP_WarmStart(benchmark::State &state)
+{
+    run_samples(state, [](const ArmorPose::ArmorPoseSolver &solver, const Sample &sample)
+                { return solver.solve_one(sample.image_points, ArmorPose::ArmorType::small, &sample.previous); });
+}
+
+// 一帧多个装甲板一次解算(带热启动): OpenCV线程池 vs 单线程
+static void BM_ArmorPnP_Batch(benchmark::State &state)
+{
+    const size_t armors = static_cast<size_t>(state.range(1));
+    std::vector<YoloVino::NNDetectData> detections(armors);
+    std::vector<const ArmorPose::ArmorPoseData *> warm_starts(armors);
+    for (size_t i = 0; i < armors; i++)
+    {
+        const Sample &sample = samples()[i % samples().size()];
+        detections[i].class_id = 0;
+        for (size_t k = 0; k < sample.image_points.size(); k++)
+        {
+            detections[i].keypoints[k] = cv::Point3f(sample.image_points[k].x, sample.image_points[k].y, 1.0f);
+        }
+        warm_starts[i] = &sample.previous;
+    }
+
+    const int threads = cv::getNumThreads();
+    if (state.range(0) == 1)
+    {
+        cv::setNumThreads(1);
+    }
+    ArmorPose::ArmorPoseSolver solver(camera_model());
+    std::vector<ArmorPose::ArmorPoseData> poses(armors);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(solver.solve(detections, poses, warm_starts).data());
+    }
+    cv::setNumThreads(threads);
+    state.SetItemsProcessed(state.iterations() * armors);
+}
+
+// 一帧角点批量去畸变: 查找表 vs cv::undistortPoints
+static void BM_Undistort(benchmark::State &state)
+{
+    std::vector<cv::Point2f> pixels;
+    for (const Sample &sample : samples())
+    {
+        pixels.insert(pixels.end(), sample.image_points.begin(), sample.image_points.end());
+    }
+    pixels.resize(4 * state.range(1));
+
+    std::vector<cv::Point2f> normalized;
+    for (auto _ : state)
+    {
+        if (state.range(0) == 0)
+        {
+            camera_model()->undistort_points(pixels, normalized);
+        }
+        else
+        {
+            cv::undistortPoints(pixels, normalized, K, D);
+        }
+        benchmark::DoNotOptimize(normalized.data());
+    }
+    state.SetItemsProcessed(state.iterations() * pixels.size());
+}
+
+BENCHMARK(BM_Undistort)->ArgsProduct({{0, 1}, {1, 8, 64}})->ArgNames({"opencv", "armors"});
+BENCHMARK(BM_ArmorPnP_Iterative)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ArmorPnP_IPPE)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ArmorPnP_WarmStart)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ArmorPnP_Batch)->ArgsProduct({{0, 1}, {2, 4, 8, 16}})->ArgNames({"serial", "armors"})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,169 @@
+#include "SimdKernels.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// 后处理和灯条颜色阈值SIMD内核在各指令集下的耗时,数据尺寸与实际模型一致
+// 启动时先做一次自检(各指令集与scalar逐位对比),不一致时直接退出
+
+namespace
+{
+    // v5fourpoint默认输出: 25200个锚框 x 22通道,第8列为先验框置信度(logit)
+    const std::vector<float> &v5_output()
+    {
+        static const std::vector<float> data = []()
+        {
+            std::mt19937 rng(1);
+            std::normal_distribution<float> logit(-6.0f, 2.0f);
+            std::vector<float> result(25200 * 22);
+            for (float &v : result)
+            {
+                v = logit(rng);
+            }
+            return result;
+        }();
+        return data;
+    }
+
+    // v8pose默认输出: 26通道 x 2100个锚框,第4-13行为类别置信度
+    const std::vector<float> &v8_output()
+    {
+        static const std::vector<float> data = []()
+        {
+            std::mt19937 rng(2);
+            std::uniform_real_distribution<float> conf(0.0f, 0.52f);
+            std::vector<float> result(26 * 2100);
+            for (float &v : result)
+            {
+                v = conf(rng);
+            }
+            return result;
+        }();
+        return data;
+    }
+
+    void BM_ScanStrided(benchmark::State &state, const Simd::Kernels *kernels)
+    {
+        const std::vector<float> &output = v5_output();
+        std::vector<int> indices(25200);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(kernels->scan_strided(output.data() + 8, 25200, 22, 0.619f, indices.data()));
+        }
+        state.SetItemsProcessed(state.iterations() * 25200);
+    }
+
+    void BM_ScanColumnMax(benchmark::State &state, const Simd::Kernels *kernels)
+    {
+        const std::vector<float> &output = v8_output();
+        std::vector<int> indices(2100), argmax(2100);
+        std::vector<float> values(2100);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(kernels->scan_column_max(output.data() + 4 * 2100, 10, 2100, 2100, 0.5f,
+                                                              indices.data(), values.data(), argmax.data()));
+        }
+        state.SetItemsProcessed(state.iterations() * 2100);
+    }
+
+    // 一次完整的贪心NMS,range(0)个候选框
+    void BM_Nms(benchmark::State &state, const Simd::Kernels *kernels)
+    {
+        const int count = static_cast<int>(state.range(0));
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<int> pos(0, 600), size(10, 60);
+        std::vector<float> x1(count), y1(count), x2(count), y2(count), area(count);
+        for (int i = 0; i < count; i++)
+        {
+            x1[i] = pos(rng);
+            y1[i] = pos(rng);
+            x2[i] = x1[i] + size(rng);
+            y2[i] = y1[i] + size(rng);
+            area[i] = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+        }
+        const Simd::BoxesSoA boxes{x1.data(), y1.data(), x2.data(), y2.data(), area.data()};
+        std::vector<uint8_t> suppressed(count);
+        for (auto _ : state)
+        {
+            std::fill(suppressed.begin(), suppressed.end(), 0);
+            for (int k = 0; k < count; k++)
+            {
+                if (!suppressed[k])
+                {
+                    kernels->suppress_overlaps(boxes, k, k + 1, count, 0.4f, suppressed.data());
+                }
+            }
+            benchmark::DoNotOptimize(suppressed.data());
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+
+    // letterbox填充: 640x640输入中填充上下各80行(4:3画面)
+    void BM_FillBorder(benchmark::State &state, const Simd::Kernels *kernels)
+    {
+        std::vector<uint8_t> image(640 * 640 * 3);
+        for (auto _ : state)
+        {
+            kernels->fill_u8c3(image.data(), 640 * 80, 114, 124, 134);
+            kernels->fill_u8c3(image.data() + 3 * 640 * 560, 640 * 80, 114, 124, 134);
+            benchmark::DoNotOptimize(image.data());
+        }
+        state.SetBytesProcessed(state.iterations() * 2 * 640 * 80 * 3);
+    }
+
+    // 灯条颜色阈值: 1440x1080的相机帧,暗背景上约1%的像素为红色灯条
+    void BM_ColorMask(benchmark::State &state, const Simd::Kernels *kernels)
+    {
+        const size_t pixels = 1440 * 1080;
+        std::mt19937 rng(4);
+        std::uniform_int_distribution<int> dark(0, 90), bar(0, 99);
+        std::vector<uint8_t> image(pixels * 3);
+        for (size_t i = 0; i < pixels; i++)
+        {
+            const bool lit = bar(rng) == 0;
+            image[3 * i] = static_cast<uint8_t>(dark(rng));
+            image[3 * i + 1] = static_cast<uint8_t>(dark(rng));
+            image[3 * i + 2] = static_cast<uint8_t>(lit ? 255 : dark(rng));
+        }
+        std::vector<uint8_t> mask(pixels);
+        for (auto _ : state)
+        {
+            kernels->color_mask_u8c3(image.data(), pixels, 2, 0, 150, 60, mask.data());
+            benchmark::DoNotOptimize(mask.data());
+        }
+        state.SetBytesProcessed(state.iterations() * pixels * 3);
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (!Simd::self_check(true))
+    {
+        return 1;
+    }
+    std::cout << "默认选择: " << Simd::isa_name(Simd::get_isa()) << std::endl;
+
+    // 每个cpu支持的指令集注册一组
+    for (int isa = Simd::scalar; isa < Simd::isa_count; isa++)
+    {
+        const Simd::Kernels *kernels = Simd::kernels_for(static_cast<Simd::Isa>(isa));
+        if (kernels == nullptr)
+        {
+            continue;
+        }
+        const std::string name = Simd::isa_name(static_cast<Simd::Isa>(isa));
+        benchmark::RegisterBenchmark(("BM_ScanStrided/" + name).c_str(), BM_ScanStrided, kernels);
+        benchmark::RegisterBenchmark(("BM_ScanColumnMax/" + name).c_str(), BM_ScanColumnMax, kernels);
+        benchmark::RegisterBenchmark(("BM_Nms/" + name).c_str(), BM_Nms, kernels)->Arg(16)->Arg(64)->Arg(256);
+        benchmark::RegisterBenchmark(("BM_FillBorder/" + name).c_str(), BM_FillBorder, kernels);
+        benchmark::RegisterBenchmark(("BM_ColorMask/" + name).c_str(), BM_ColorMask, kernels)->Unit(benchmark::kMicrosecond);
+    }
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,489 @@
+#include "yolo_vino.hpp"
+#include "light_bar_proposer.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// 基准测试: 完整safe_predict、各阶段单独耗时、图内/C++后处理的对比、单个装甲板的solvePnP以及拜尔转换
+// 结果对比: make yolovino_bench_json 或 ./yolovino_bench --benchmark_out=xx.json --benchmark_out_format=json
+
+namespace
+{
+    // operator new的调用次数,用于统计每帧的堆分配
+    // cv::Mat的数据由cv::fastMalloc分配,不经过这里,由下面的MatAllocator单独统计
+    std::atomic<uint64_t> allocation_count{0};
+
+    // cv::Mat数据缓冲区的分配次数: 包装OpenCV默认的分配器,只统计不由调用者提供数据的分配
+    class CountingMatAllocator : public cv::MatAllocator
+    {
+    public:
+        cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                               cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override
+        {
+            if (data == nullptr)
+            {
+                count.fetch_add(1, std::memory_order_relaxed);
+            }
+            // 分配出的UMatData记录的是默认分配器,释放时直接走默认分配器
+            return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+        }
+
+        bool allocate(cv::UMatData *data, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override
+        {
+            return cv::Mat::getStdAllocator()->allocate(data, flags, usage_flags);
+        }
+
+        void deallocate(cv::UMatData *data) const override
+        {
+            cv::Mat::getStdAllocator()->deallocate(data);
+        }
+
+        mutable std::atomic<uint64_t> count{0};
+    };
+
+    // 第一次调用时设为默认分配器,之后新建的Mat都经过它
+    CountingMatAllocator &mat_allocator()
+    {
+        static CountingMatAllocator *allocator = []()
+        {
+            auto *instance = new CountingMatAllocator();
+            cv::Mat::setDefaultAllocator(instance);
+            return instance;
+        }();
+        return *allocator;
+    }
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size > 0 ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+    // 相机内参矩阵和畸变参数(与main.cpp一致)
+    const cv::Mat K = (cv::Mat_<double>(3, 3) << 2.3331e+03, -1.6808, 690.8069,
+                       0, 2.3271e+03, 554.0654,
+                       0, 0, 1);
+    const cv::Mat D = (cv::Mat_<double>(1, 5) << -0.1382, 0.5323, 0.0012, -0.0023, 0);
+
+    // 装甲板角点(左上,左下,右下,右上)
+    const float armor_height = 0.055;
+    const float armor_width = 0.135;
+    const std::vector<cv::Point3f> world_points =
+        {
+            cv::Point3f(-armor_width / 2.0, -armor_height / 2.0, 0.0),
+            cv::Point3f(-armor_width / 2.0, armor_height / 2.0, 0.0),
+            cv::Point3f(armor_width / 2.0, armor_height / 2.0, 0.0),
+            cv::Point3f(armor_width / 2.0, -armor_height / 2.0, 0.0),
+    };
+
+    template <typename Detector>
+    const char *config_path();
+
+    template <>
+    const char *config_path<YoloVino::Yolov8poseVino>()
+    {
+        return YOLOVINO_CONFIG_DIR "/yolov8pose_vino_config.yaml";
+    }
+
+    template <>
+    const char *config_path<YoloVino::Yolov5fourpointVino>()
+    {
+        return YOLOVINO_CONFIG_DIR "/yolov5fourpoint_vino_config.yaml";
+    }
+
+    // 模型编译很慢,每种检测器只构建一次
+    template <typename Detector>
+    Detector &detector()
+    {
+        static Detector instance([]()
+                                 {
+            auto logger = std::make_unique<YoloVino::YoloVinoLogger>(config_path<Detector>());
+            logger->set_info_level(YoloVino::LoggerInfoLevel::warning_info);
+            return logger; }());
+        return instance;
+    }
+
+    // 同一模型打开图内NMS(阈值、TopK和NMS接在网络图末尾)的检测器
+    template <typename Detector>
+    Detector &graph_nms_detector()
+    {
+        static Detector instance([]()
+                                 {
+            auto logger = std::make_unique<YoloVino::YoloVinoLogger>(config_path<Detector>());
+            logger->set_info_level(YoloVino::LoggerInfoLevel::warning_info);
+            logger->set_graph_nms(true);
+            return logger; }());
+        return instance;
+    }
+
+    const cv::Mat &test_img()
+    {
+        static const cv::Mat img = cv::imread(YOLOVINO_TEST_IMG);
+        return img;
+    }
+
+    cv::Rect full_roi(const cv::Mat &img)
+    {
+        return cv::Rect(0, 0, img.cols, img.rows);
+    }
+
+    // 按RGGB排列从彩色图采样出拜尔原图
+    cv::Mat make_bayer_rg(const cv::Mat &bgr)
+    {
+        cv::Mat bayer(bgr.size(), CV_8UC1);
+        for (int y = 0; y < bgr.rows; y++)
+        {
+            const cv::Vec3b *src = bgr.ptr<cv::Vec3b>(y);
+            uchar *dst = bayer.ptr<uchar>(y);
+            for (int x = 0; x < bgr.cols; x++)
+            {
+                int channel = (y % 2 == 0) ? ((x % 2 == 0) ? 2 : 1) : ((x % 2 == 0) ? 1 : 0);
+                dst[x] = src[x][channel];
+            }
+        }
+        return bayer;
+    }
+
+    // 合成的1440x1080相机帧: 暗背景加噪声,放置若干红/蓝灯条对(装甲板),返回装甲板的外接框
+    cv::Mat make_light_bar_frame(std::vector<cv::Rect> &armors)
+    {
+        cv::Mat frame(1080, 1440, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(90));
+        cv::RNG rng(4);
+        armors.clear();
+        for (int i = 0; i < 6; i++)
+        {
+            const int bar_height = rng.uniform(8, 60);
+            const int bar_width = std::max(2, bar_height / 5);
+            const int gap = static_cast<int>(bar_height * rng.uniform(2.2f, 4.2f));
+            const int x = 100 + i * 220 + rng.uniform(0, 40);
+            const int y = rng.uniform(100, 900);
+            const cv::Scalar color = i % 2 == 0 ? cv::Scalar(60, 80, 250) : cv::Scalar(250, 120, 40);
+            cv::rectangle(frame, cv::Rect(x, y, bar_width, bar_height), color, cv::FILLED);
+            cv::rectangle(frame, cv::Rect(x + gap, y, bar_width, bar_height), color, cv::FILLED);
+            armors.emplace_back(x, y, gap + bar_width, bar_height);
+        }
+        return frame;
+    }
+} // namespace
+
+// 完整推理
+template <typename Detector>
+static void BM_SafePredict(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+    Detector &vino = detector<Detector>();
+
+    size_t detections = 0;
+    for (auto _ : state)
+    {
+        std::vector<YoloVino::NNDetectData> results = vino.safe_predict(img, full_roi(img));
+        detections = results.size();
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.counters["detections"] = detections;
+}
+
+// 完整推理,结果和中间数据复用调用者的缓冲区,统计稳态下每帧的堆分配次数
+// allocs_per_frame为operator new的次数,mat_allocs_per_frame为cv::Mat数据缓冲区的分配次数
+template <typename Detector>
+static void BM_SafePredictInto(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+    Detector &vino = detector<Detector>();
+
+    CountingMatAllocator &mat_counter = mat_allocator();
+    std::vector<YoloVino::NNDetectData> results;
+    YoloVino::DetectWorkspace workspace;
+    vino.safe_predict(img, full_roi(img), results, workspace); // 第一帧确定各缓冲区的容量
+
+    const uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+    const uint64_t mat_allocations_before = mat_counter.count.load(std::memory_order_relaxed);
+    for (auto _ : state)
+    {
+        vino.safe_predict(img, full_roi(img), results, workspace);
+        benchmark::DoNotOptimize(results.data());
+    }
+    const uint64_t allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+    const uint64_t mat_allocations = mat_counter.count.load(std::memory_order_relaxed) - mat_allocations_before;
+    state.counters["detections"] = results.size();
+    state.counters["allocs_per_frame"] = static_cast<double>(allocations) / state.iterations();
+    state.counters["mat_allocs_per_frame"] = static_cast<double>(mat_allocations) / state.iterations();
+}
+
+// 缩放+填充
+template <typename Detector>
+static void BM_Letterbox(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+    Detector &vino = detector<Detector>();
+
+    cv::Mat final_img;
+    YoloVino::LetterboxInfo info;
+    for (auto _ : state)
+    {
+        vino.letterbox(img, full_roi(img), final_img, info);
+        benchmark::DoNotOptimize(final_img.data);
+    }
+}
+
+// 只有推理
+template <typename Detector>
+static void BM_Infer(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+    Detector &vino = detector<Detector>();
+
+    cv::Mat final_img;
+    YoloVino::LetterboxInfo info;
+    vino.letterbox(img, full_roi(img), final_img, info);
+    for (auto _ : state)
+    {
+        cv::Mat output = vino.infer(final_img, info);
+        benchmark::DoNotOptimize(output.data);
+    }
+}
+
+// 从保存下来的输出张量解码
+template <typename Detector>
+static void BM_Decode(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+    Detector &vino = detector<Detector>();
+
+    cv::Mat final_img;
+    YoloVino::LetterboxInfo info;
+    vino.letterbox(img, full_roi(img), final_img, info);
+    const cv::Mat output = vino.infer(final_img, info);
+
+    YoloVino::DecodeCandidates candidates;
+    for (auto _ : state)
+    {
+        candidates.clear();
+        vino.decode(output, info, candidates);
+        benchmark::DoNotOptimize(candidates.rects.data());
+    }
+    state.counters["anchors"] = std::max(output.rows, output.cols);
+    state.counters["candidates"] = candidates.rects.size();
+}
+
+// 非极大值抑制
+template <typename Detector>
+static void BM_Nms(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+    Detector &vino = detector<Detector>();
+
+    cv::Mat final_img;
+    YoloVino::LetterboxInfo info;
+    vino.letterbox(img, full_roi(img), final_img, info);
+    YoloVino::DecodeCandidates candidates;
+    vino.decode(vino.infer(final_img, info), info, candidates);
+
+    std::vector<int> indices;
+    for (auto _ : state)
+    {
+        indices.clear();
+        vino.nms(candidates, indices);
+        benchmark::DoNotOptimize(indices.data());
+    }
+    state.counters["candidates"] = candidates.rects.size();
+}
+
+// 推理+后处理: 0为C++解码和NMS(输出整个张量), 1为图内阈值、TopK和NMS(只输出选中的锚框)
+// 计数器output_floats为每帧从推理请求拷出的浮点数
+template <typename Detector>
+static void BM_InferPostprocess(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+    Detector &vino = state.range(0) == 0 ? detector<Detector>() : graph_nms_detector<Detector>();
+    if (state.range(0) != 0 && !vino.is_graph_nms())
+    {
+        state.SkipWithError("图内NMS构建失败");
+        return;
+    }
+
+    YoloVino::DetectWorkspace workspace;
+    std::vector<YoloVino::NNDetectData> results;
+    vino.letterbox(img, full_roi(img), workspace.final_img, workspace.info);
+    for (auto _ : state)
+    {
+        vino.infer(workspace.final_img, workspace.info, workspace.output);
+        vino.postprocess(workspace.output, workspace.info, img.size(), results, workspace);
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.counters["output_floats"] = workspace.output.total();
+    state.counters["detections"] = results.size();
+}
+
+// 每个装甲板一次solvePnP(与main.cpp中的cool_pnp相同)
+static void BM_SolvePnP(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+
+    // 取测试图片的检测结果,没有检测到时用一个已知位姿的投影代替
+    std::vector<std::vector<cv::Point2f>> armors;
+    for (const auto &det : detector<YoloVino::Yolov5fourpointVino>().safe_predict(img, full_roi(img)))
+    {
+        std::vector<cv::Point2f> points;
+        for (const auto &keypoint : det.keypoints)
+        {
+            points.emplace_back(keypoint.x, keypoint.y);
+        }
+        armors.push_back(points);
+    }
+    if (armors.empty())
+    {
+        std::vector<cv::Point2f> points;
+        cv::projectPoints(world_points, cv::Vec3d(0.1, 0.3, 0.0), cv::Vec3d(0.05, -0.02, 2.0), K, D, points);
+        armors.push_back(points);
+    }
+
+    cv::Mat R, T;
+    for (auto _ : state)
+    {
+        for (const auto &points : armors)
+        {
+            cv::solvePnP(world_points, points, K, D, R, T, false, cv::SOLVEPNP_ITERATIVE);
+            benchmark::DoNotOptimize(T.data);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * armors.size());
+}
+
+// 拜尔转换: 0为双线性, 1为边缘感知(对应海康SDK的均衡/最优质量)
+static void BM_BayerToBGR(benchmark::State &state)
+{
+    const cv::Mat &img = test_img();
+    if (img.empty())
+    {
+        state.SkipWithError("无法读取测试图片");
+        return;
+    }
+    const cv::Mat bayer = make_bayer_rg(img);
+    const int code = state.range(0) == 0 ? cv::COLOR_BayerRG2BGR : cv::COLOR_BayerRG2BGR_EA;
+
+    cv::Mat bgr;
+    for (auto _ : state)
+    {
+        cv::cvtColor(bayer, bgr, code);
+        benchmark::DoNotOptimize(bgr.data);
+    }
+    state.SetBytesProcessed(state.iterations() * bayer.total());
+}
+
+// 灯条候选区域: 1440x1080帧上找灯条对,计数器为合成装甲板的召回率和候选区域占整帧的比例
+static void BM_LightBarPropose(benchmark::State &state)
+{
+    std::vector<cv::Rect> armors;
+    const cv::Mat frame = make_light_bar_frame(armors);
+    YoloVino::LightBarConfig config;
+    config.downscale = static_cast<int>(state.range(0));
+    YoloVino::LightBarProposer proposer(config);
+
+    std::vector<cv::Rect> rois;
+    for (auto _ : state)
+    {
+        proposer.propose(frame, rois);
+        benchmark::DoNotOptimize(rois.data());
+    }
+
+    int found = 0;
+    for (const cv::Rect &armor : armors)
+    {
+        for (const cv::Rect &roi : rois)
+        {
+            if ((roi & armor) == armor)
+            {
+                found++;
+                break;
+            }
+        }
+    }
+    double roi_pixels = 0.0;
+    for (const cv::Rect &roi : rois)
+    {
+        roi_pixels += roi.area();
+    }
+    state.counters["recall"] = static_cast<double>(found) / armors.size();
+    state.counters["roi_fraction"] = roi_pixels / frame.total();
+    state.SetItemsProcessed(state.iterations() * frame.total());
+}
+
+BENCHMARK_TEMPLATE(BM_SafePredict, YoloVino::Yolov8poseVino)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SafePredict, YoloVino::Yolov5fourpointVino)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SafePredictInto, YoloVino::Yolov8poseVino)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SafePredictInto, YoloVino::Yolov5fourpointVino)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Letterbox, YoloVino::Yolov8poseVino)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Letterbox, YoloVino::Yolov5fourpointVino)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Infer, YoloVino::Yolov8poseVino)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Infer, YoloVino::Yolov5fourpointVino)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Decode, YoloVino::Yolov8poseVino)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Decode, YoloVino::Yolov5fourpointVino)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Nms, YoloVino::Yolov8poseVino)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Nms, YoloVino::Yolov5fourpointVino)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_InferPostprocess, YoloVino::Yolov8poseVino)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_InferPostprocess, YoloVino::Yolov5fourpointVino)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SolvePnP)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BayerToBGR)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_LightBarPropose)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -1,15 +1,31 @@
 #include "yolo_vino.hpp"
+#include "yolo_cascade.hpp"
+#include "light_bar_proposer.hpp"
+#include "armor_pose.hpp"
+#include "armor_tracker.hpp"
 #include "Camera.h"
+#include "CameraModel.h"
+#include "StageProfiler.h"
+#include "Pipeline.h"
+#include "VisualSink.h"
+#include "SimdKernels.h"
+#include "FrameBus.h"
+#include "ResultLink.h"
+#include "ThreadPlacement.h"
+#include "FrameTrace.h"
+#include "QualityController.h"
+#include "offline_runner.hpp"
+#include <algorithm>
+#include <csignal>
 #include <chrono>
-using Clock = std::chrono::high_resolution_clock;
-using us = std::chrono::microseconds;
+#include <fstream>
+#include <future>
 
 using cv::Mat;
 using cv::Point2f;
 using cv::Point3f;
 using std::vector;
 
-cv::Mat frame;
 using cv::Mat;
 using cv::Point2f;
 using cv::Point3f;
@@ -64,30 +80,11 @@ MV_CC_DEVICE_INFO_LIST get_device_list()
 传入内参矩阵，畸变参数，3D世界点，2D世界点。返回旋转向量和平移向量
 */
 
-// 大装甲板的高和宽（单位m）
-float big_armor_height = 0.055;
-// float big_armor_width = 0.225;
-float big_armor_width = 0.135;
+// 装甲板四个角点的3D坐标和大小装甲板的尺寸在ArmorPoseSolver中(左上，左下，右下，右上)
 
 
-// 存储3D世界坐标系的装甲板的左上，左下，右下，右上点的坐标
-std::vector<cv::Point3f> world_points =
-    {
-        cv::Point3f(-big_armor_width / 2.0, -big_armor_height / 2.0, 0.0), // 左上
-        cv::Point3f(-big_armor_width / 2.0, big_armor_height / 2.0, 0.0),  // 左下
-        cv::Point3f(big_armor_width / 2.0, big_armor_height / 2.0, 0.0),   // 右下
-        cv::Point3f(big_armor_width / 2.0, -big_armor_height / 2.0, 0.0),  // 右上
-        cv::Point3f(-big_armor_width / 2.0, -big_armor_height / 2.0, 0.0), // 左上
-        cv::Point3f(-big_armor_width / 2.0, big_armor_height / 2.0, 0.0),  // 左下
-        cv::Point3f(big_armor_width / 2.0, big_armor_height / 2.0, 0.0),   // 右下
-        cv::Point3f(big_armor_width / 2.0, -big_armor_height / 2.0, 0.0),  // 右上
-};
-
-
-// 像素坐标系的端点
-std::vector<cv::Point2f> axis_2Dpoints;
 // 装甲板坐标系的端点
-vector<cv::Point3f> axis_3Dpoints =
+const std::vector<cv::Point3f> axis_3Dpoints =
     {
         // 坐标原点
         cv::Point3f(0.0, 0.0, 0.0),
@@ -103,9 +100,6 @@ vector<cv::Point3f> axis_3Dpoints =
 };
 
 
-// 存储YOLO识别出的像素坐标系的装甲板的左上，左下，右下，右上点的坐标（keypoints四个点）
-std::vector<cv::Point2f> image_points;
-
 // 相机内参矩阵
 cv::Mat K = (cv::Mat_<double>(3, 3) << 2.3331e+03, -1.6808, 690.8069,
              0, 2.3271e+03, 554.0654,
@@ -114,91 +108,362 @@ cv::Mat K = (cv::Mat_<double>(3, 3) << 2.3331e+03, -1.6808, 690.8069,
 // 畸变参数
 cv::Mat D = (cv::Mat_<double>(1, 5) << -0.1382, 0.5323, 0.0012, -0.0023, 0);
 
-// 旋转矩阵
-cv::Mat R;
-
-
-// 平移向量
-cv::Mat T;
-
-
-// Pitch角
-float pitch = 0.0;
-
-
-// Roll角
-float roll = 0.0;
-
-
-// Yaw角
-float yaw = 0.0;
-
-// 距离
-float core_distance = 0.0;
+// 在一帧中依次流过各个阶段的数据
+struct FrameJob
+{
+    cv::Mat frame;                                  // 相机原图,可视化时直接在上面画
+    uint64_t frame_id = 0;                          // 帧序号,从1开始
+    double timestamp = 0.0;                         // 采集时刻(s)
+    int64_t capture_ns = 0;                         // 采集时刻(steady_clock,ns),输出给其他进程
+    bool skip_nn = false;                           // 没有灯条候选,本帧不推理
+    int quality_level = 0;                          // 处理这一帧时的自适应质量等级
+    cv::Mat input;                                  // letterbox后的网络输入
+    YoloVino::LetterboxInfo info;                   // letterbox参数
+    cv::Mat output;                                 // 网络输出
+    std::vector<YoloVino::NNDetectData> results;    // 检测结果
+    std::vector<int> track_ids;                     // 每个检测的目标编号
+    std::vector<ArmorPose::ArmorPoseData> poses;    // 每个检测的位姿
+};
 
+// 交给可视化线程的检测结果
+struct VisualPayload
+{
+    std::vector<YoloVino::NNDetectData> results;
+    std::vector<int> track_ids;
+    std::vector<ArmorPose::ArmorPoseData> poses;
+    int quality_level = 0;
+};
 
-// 传入像素坐标系的四个角点
-void cool_pnp(vector<Point2f> img_points)
+// 传入解算好的装甲板位姿,画出坐标轴并显示距离和欧拉角
+// frame已按scale缩小,投影出的像素坐标要同样缩放
+void cool_pnp(cv::Mat &frame, const CameraModel &camera_model, const ArmorPose::ArmorPoseData &pose, double scale)
 {
-    // 求出旋转矩阵和平移向量
-    cv::solvePnP(
-        world_points,
-        img_points,
-        K,
-        D,
-        R, // 旋转向量
-        T, // 平移向量
-        false,
-        SOLVEPNP_ITERATIVE);
+    STAGE_TIMER(draw);
 
-    cv::Rodrigues(R, R); // 核心：旋转向量→3×3旋转矩阵
+    // 像素坐标系的端点
+    std::vector<cv::Point2f> axis_2Dpoints;
+    camera_model.project_points(axis_3Dpoints, pose.rvec, pose.tvec, axis_2Dpoints);
+    for (cv::Point2f &point : axis_2Dpoints)
+    {
+        point *= static_cast<float>(scale);
+    }
 
-    // 求出距离
-    core_distance = norm(T);
+    // 画箭头
+    cv::arrowedLine(frame, axis_2Dpoints[0], axis_2Dpoints[1], cv::Scalar(255, 0, 0), 2); // Z轴 = 蓝色
+    cv::arrowedLine(frame, axis_2Dpoints[0], axis_2Dpoints[2], cv::Scalar(0, 0, 255), 2); // X轴 = 红色
+    cv::arrowedLine(frame, axis_2Dpoints[0], axis_2Dpoints[3], cv::Scalar(0, 255, 0), 2); // Y轴 = 绿色
 
-    CV_Assert(R.rows == 3 && R.cols == 3 && R.type() == CV_64F);
-    // 计算Roll，pitch，yaw三轴
-    double r23 = R.at<double>(1, 2);
-    double r13 = R.at<double>(0, 2);
-    double r33 = R.at<double>(2, 2);
-    double r21 = R.at<double>(1, 0);
-    double r22 = R.at<double>(1, 1);
+    //  图像上显示数据 (距离和欧拉角)
+    std::string dist_text = cv::format("Dist: %.2f m", pose.distance);
+    std::string yaw_text = cv::format("Yaw: %.2f deg", pose.yaw);
+    std::string pitch_text = cv::format("Pitch: %.2f deg", pose.pitch);
+    std::string roll_text = cv::format("Roll: %.2f deg", pose.roll);
 
-    pitch = asin(-r23);
+    // 在图像左上方显示数据，颜色为白色
+    cv::putText(frame, dist_text, cv::Point(10, 25), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
+    cv::putText(frame, yaw_text, cv::Point(10, 50), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
+    cv::putText(frame, pitch_text, cv::Point(10, 75), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
+    cv::putText(frame, roll_text, cv::Point(10, 100), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
+}
 
-    yaw = atan2(r13, r33);
+// 画出一帧的全部检测结果
+void draw_results(cv::Mat &frame, const CameraModel &camera_model, const VisualPayload &payload, double scale)
+{
+    for (size_t i = 0; i < payload.results.size(); i++)
+    {
+        if (payload.poses[i].valid)
+        {
+            // 绘制检测框（绿色）
+            const cv::Rect &rect = payload.results[i].rect;
+            const cv::Rect scaled(cvRound(rect.x * scale), cvRound(rect.y * scale), cvRound(rect.width * scale), cvRound(rect.height * scale));
+            cv::rectangle(frame, scaled, cv::Scalar(0, 255, 0), 2);
+            cv::putText(frame, cv::format("#%d", payload.track_ids[i]), scaled.tl() - cv::Point(0, 5),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 1);
+            cool_pnp(frame, camera_model, payload.poses[i], scale);
+        }
+    }
+    if (payload.quality_level > 0)
+    {
+        cv::putText(frame, cv::format("Quality L%d", payload.quality_level), cv::Point(10, frame.rows - 10),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 165, 255), 1);
+    }
+}
 
-    roll = atan2(r21, r22);
+// 把一帧的检测和位姿结果按固定布局发给下游(云台控制),不分配内存
+void publish_results(ResultLink::Publisher &publisher, const FrameJob &job)
+{
+    publisher.begin(job.frame_id, job.capture_ns, static_cast<uint16_t>(job.quality_level));
+    for (size_t i = 0; i < job.results.size(); i++)
+    {
+        ResultLink::ArmorRecord *armor = publisher.add();
+        if (armor == nullptr)
+        {
+            break;
+        }
+        const YoloVino::NNDetectData &result = job.results[i];
+        const ArmorPose::ArmorPoseData &pose = job.poses[i];
+        armor->class_id = static_cast<int16_t>(result.class_id);
+        armor->track_id = static_cast<int16_t>(job.track_ids[i]);
+        armor->confidence = result.confidence;
+        for (int k = 0; k < YoloVino::NNDetectData::keypoint_count; k++)
+        {
+            armor->keypoints[2 * k] = result.keypoints[k].x;
+            armor->keypoints[2 * k + 1] = result.keypoints[k].y;
+        }
+        armor->pose_valid = pose.valid;
+        armor->armor_type = static_cast<uint8_t>(pose.type);
+        for (int k = 0; k < 3; k++)
+        {
+            armor->rvec[k] = static_cast<float>(pose.rvec[k]);
+            armor->tvec[k] = static_cast<float>(pose.tvec[k]);
+        }
+        armor->distance = static_cast<float>(pose.distance);
+        armor->yaw = static_cast<float>(pose.yaw);
+        armor->pitch = static_cast<float>(pose.pitch);
+        armor->roll = static_cast<float>(pose.roll);
+        armor->reprojection_error = static_cast<float>(pose.reprojection_error);
+    }
+    publisher.send();
+}
 
-    const double RAD2DEG = 180.0 / CV_PI;
+// Ctrl+C时停止流水线(无界面模式下的退出方式)
+std::atomic<bool> stop_signal{false};
+void handle_signal(int)
+{
+    stop_signal = true;
+}
 
-    // 求出角度
-    pitch *= RAD2DEG;
-    yaw *= RAD2DEG;
-    roll *= RAD2DEG;
+int main(int argc, char const *argv[])
+{
+    // 命令行参数: --profile 打开各阶段耗时统计, --profile-csv <路径> 同时写入csv
+    //            --camera <标定文件> 使用标定文件中的内参和畸变(默认读取当前目录的camera.yaml,没有时使用上面的K和D)
+    //            --no-pin 流水线各阶段线程不绑核
+    //            --headless 不调用任何界面函数(没有显示环境时自动打开)
+    //            --viz-fps <帧率> --viz-scale <比例> 可视化的最高帧率和缩放比例
+    //            --large-armor <类别> 该类别按大装甲板解算,可重复
+    //            --frame-bus <名称> 把相机帧发布到共享内存帧总线,供其他进程(frame_bus_viewer等)读取
+    //            --model v8|v5 使用的检测模型(默认v5)
+    //            --cascade v8整帧检测,低置信度或远处的候选再用v5在裁剪区域精检; --cascade-config <yaml> 级联参数
+    //            --result-link <地址> 每帧的检测和位姿结果发到udp://host:port或unix:///path(result_link_probe可接收)
+    //            --rt <布局> 各线程的cpu集合和SCHED_FIFO优先级,如 capture=0:80,infer=2:70,postprocess=3:60,main=4,ov=5-7
+    //                        (格式见ThreadPlacement.h,指定后代替--no-pin的默认绑核); --rt-lock 锁定进程内存(mlockall)
+    //            --light-bar 先用传统视觉找灯条对,网络只在候选区域上推理(周期性整帧推理); --light-bar-config <yaml> 灯条参数
+    //            --offline <目录|录像> 离线吞吐模式: 不打开相机,批量检测录好的数据(可重复,按给出的顺序),结果写入列式文件
+    //                        --offline-out <文件> --offline-readers <N> 读取线程数 --offline-requests <N> 推理请求数(默认按插件建议)
+    //            --budget <ms> 自适应质量: 采集到结果的延迟超出预算时逐级降级(可视化抽帧 -> 缩小候选/裁剪区域 -> 跳过级联第二级
+    //                          -> 网络输入限制为320),有余量时逐级恢复; 等级随每帧结果输出
+    //            --trace <前缀> 记录逐帧片段,kill -USR1时和退出时导出为 前缀_时间.json (Chrome trace格式,用ui.perfetto.dev打开)
+    bool profile = false;
+    std::string profile_csv;
+    std::string camera_yaml;
+    bool pin_threads = true;
+    Visual::SinkConfig viz_config;
+    std::vector<int> large_armor_classes;
+    std::string frame_bus_name;
+    std::string result_link_uri;
+    std::string rt_spec;
+    bool rt_lock = false;
+    std::string trace_prefix;
+    std::string model_name = "v5";
+    bool cascade = false;
+    std::string cascade_yaml = "/home/xiaoyiming/task8/vino_task/src/YoloVino/config/cascade_config.yaml";
+    bool light_bar = false;
+    double budget_ms = 0.0;
+    Offline::OfflineConfig offline_config;
+    std::string light_bar_yaml = "/home/xiaoyiming/task8/vino_task/src/YoloVino/config/light_bar_config.yaml";
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--profile")
+        {
+            profile = true;
+        }
+        else if (arg == "--profile-csv" && i + 1 < argc)
+        {
+            profile = true;
+            profile_csv = argv[++i];
+        }
+        else if (arg == "--camera" && i + 1 < argc)
+        {
+            camera_yaml = argv[++i];
+        }
+        else if (arg == "--no-pin")
+        {
+            pin_threads = false;
+        }
+        else if (arg == "--headless")
+        {
+            Visual::set_headless(true);
+        }
+        else if (arg == "--viz-fps" && i + 1 < argc)
+        {
+            viz_config.max_fps = std::stod(argv[++i]);
+        }
+        else if (arg == "--viz-scale" && i + 1 < argc)
+        {
+            viz_config.scale = std::stod(argv[++i]);
+        }
+        else if (arg == "--large-armor" && i + 1 < argc)
+        {
+            large_armor_classes.push_back(std::stoi(argv[++i]));
+        }
+        else if (arg == "--frame-bus" && i + 1 < argc)
+        {
+            frame_bus_name = argv[++i];
+        }
+        else if (arg == "--model" && i + 1 < argc)
+        {
+            model_name = argv[++i];
+        }
+        else if (arg == "--cascade")
+        {
+            cascade = true;
+        }
+        else if (arg == "--cascade-config" && i + 1 < argc)
+        {
+            cascade = true;
+            cascade_yaml = argv[++i];
+        }
+        else if (arg == "--light-bar")
+        {
+            light_bar = true;
+        }
+        else if (arg == "--light-bar-config" && i + 1 < argc)
+        {
+            light_bar = true;
+            light_bar_yaml = argv[++i];
+        }
+        else if (arg == "--offline" && i + 1 < argc)
+        {
+            offline_config.inputs.push_back(argv[++i]);
+        }
+        else if (arg == "--offline-out" && i + 1 < argc)
+        {
+            offline_config.output = argv[++i];
+        }
+        else if (arg == "--offline-readers" && i + 1 < argc)
+        {
+            offline_config.readers = std::stoi(argv[++i]);
+        }
+        else if (arg == "--offline-requests" && i + 1 < argc)
+        {
+            offline_config.infer_requests = std::stoi(argv[++i]);
+        }
+        else if (arg == "--budget" && i + 1 < argc)
+        {
+            budget_ms = std::stod(argv[++i]);
+        }
+        else if (arg == "--result-link" && i + 1 < argc)
+        {
+            result_link_uri = argv[++i];
+        }
+        else if (arg == "--rt" && i + 1 < argc)
+        {
+            rt_spec = argv[++i];
+        }
+        else if (arg == "--rt-lock")
+        {
+            rt_lock = true;
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            trace_prefix = argv[++i];
+        }
+    }
+    if (profile)
+    {
+        StageProfiler::set_enabled(true);
+        StageProfiler::start_report(std::chrono::seconds(5), profile_csv);
+    }
+    if (!trace_prefix.empty())
+    {
+        FrameTrace::set_enabled(true);
+        FrameTrace::install_signal_handler(SIGUSR1);
+    }
 
-    cv::projectPoints(axis_3Dpoints, R, T, K, D, axis_2Dpoints);
+    // 线程布局: 主线程先按main设置,之后创建的线程(相机SDK、可视化、曝光调节的输入任务)继承它的cpu集合和调度策略
+    // main一般不设优先级,这些线程不是实时线程
+    ThreadPlacement::Config rt_config;
+    if (!ThreadPlacement::Config::parse(rt_spec, rt_config))
+    {
+        return 1;
+    }
+    if (!rt_config.empty())
+    {
+        rt_config.print();
+    }
+    if (rt_lock)
+    {
+        ThreadPlacement::lock_memory();
+    }
+    if (const ThreadPlacement::ThreadSpec *spec = rt_config.find("main"))
+    {
+        ThreadPlacement::apply_to_current_thread("main", *spec);
+    }
 
-    // 画箭头
-    cv::arrowedLine(frame, axis_2Dpoints[0], axis_2Dpoints[1], cv::Scalar(255, 0, 0), 3); // Z轴 = 蓝色
-    cv::arrowedLine(frame, axis_2Dpoints[0], axis_2Dpoints[2], cv::Scalar(0, 0, 255), 3); // X轴 = 红色
-    cv::arrowedLine(frame, axis_2Dpoints[0], axis_2Dpoints[3], cv::Scalar(0, 255, 0), 3); // Y轴 = 绿色
+    // 后处理内核按cpu选择的指令集(环境变量SIMD_KERNELS_ISA可以指定较低的一级)
+    cout << "SIMD内核: " << Simd::isa_name(Simd::get_isa()) << endl;
 
-    //  图像上显示数据 (距离和欧拉角)
-    std::string dist_text = cv::format("Dist: %.2f m", core_distance);
-    std::string yaw_text = cv::format("Yaw: %.2f deg", yaw);
-    std::string pitch_text = cv::format("Pitch: %.2f deg", pitch);
-    std::string roll_text = cv::format("Roll: %.2f deg", roll);
+    // --------- 模型: 后台线程读取、编译并预热,与相机打开同时进行 ----------
+    // 级联时流水线上跑的是v8,v5只在裁剪区域上使用
+    auto make_logger = [](const std::string &yaml_path)
+    {
+        auto logger = std::make_unique<YoloVino::YoloVinoLogger>(yaml_path);
+        logger->print_yaml_info();
+        logger->set_info_level(YoloVino::LoggerInfoLevel::debug_info);
+        return logger;
+    };
+    const std::string v8_yaml = "/home/xiaoyiming/task8/vino_task/src/YoloVino/config/yolov8pose_vino_config.yaml";
+    const std::string v5_yaml = "/home/xiaoyiming/task8/vino_task/src/YoloVino/config/yolov5fourpoint_vino_config.yaml";
+    const auto load_start = std::chrono::steady_clock::now();
+    std::future<std::unique_ptr<YoloVino::Yolov8poseVino>> v8_future;
+    std::future<std::unique_ptr<YoloVino::Yolov5fourpointVino>> v5_future;
+    {
+        // 加载线程在ov的cpu上创建,编译和预热时OpenVINO创建的工作线程继承这个cpu集合,不会占用流水线的核
+        // infer阶段线程本身也参与推理计算,它的cpu由--rt中的infer指定
+        const ThreadPlacement::ThreadSpec *ov_spec = rt_config.find("ov");
+        ThreadPlacement::ScopedAffinity ov_fence(ov_spec ? ov_spec->cpus : std::vector<int>());
+        if (cascade || model_name == "v8")
+        {
+            v8_future = YoloVino::load_async<YoloVino::Yolov8poseVino>(make_logger(v8_yaml));
+        }
+        if (cascade || model_name != "v8")
+        {
+            v5_future = YoloVino::load_async<YoloVino::Yolov5fourpointVino>(make_logger(v5_yaml));
+        }
+    }
 
-    // 在图像左上方显示数据，颜色为白色
-    cv::putText(frame, dist_text, cv::Point(20, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 2);
-    cv::putText(frame, yaw_text, cv::Point(20, 90), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 2);
-    cv::putText(frame, pitch_text, cv::Point(20, 130), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 2);
-    cv::putText(frame, roll_text, cv::Point(20, 170), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 2);
-}
+    // 离线吞吐模式: 不使用相机和流水线,级联和灯条候选也不使用; 相机模型用标定文件或默认内参
+    if (!offline_config.inputs.empty())
+    {
+        std::shared_ptr<CameraModel> offline_camera;
+        if (!camera_yaml.empty())
+        {
+            offline_camera = CameraModel::load(camera_yaml);
+        }
+        if (!offline_camera)
+        {
+            offline_camera = std::make_shared<CameraModel>(K, D, cv::Size(1440, 1080));
+        }
+        ArmorPose::ArmorPoseSolver offline_solver(offline_camera);
+        for (int class_id : large_armor_classes)
+        {
+            offline_solver.set_armor_type(class_id, ArmorPose::ArmorType::large);
+        }
+        std::unique_ptr<YoloVino::YoloVino> offline_vino;
+        if (model_name == "v8")
+        {
+            offline_vino = v8_future.get();
+        }
+        else
+        {
+            offline_vino = v5_future.get();
+        }
+        const int result = Offline::run(*offline_vino, offline_solver, offline_config);
+        StageProfiler::stop_report();
+        return result;
+    }
 
-int main(int argc, char const *argv[])
-{
     // 初始化SDK
     MV_CC_Initialize();
 
@@ -220,62 +485,323 @@ int main(int argc, char const *argv[])
     // 启动采集
     c1->camera_start_grab();
 
-    // --------- 推理+读取图片 ----------
-    auto logger = std::make_unique<YoloVino::YoloVinoLogger>("/home/xiaoyiming/task8/vino_task/src/YoloVino/config/yolov5fourpoint_vino_config.yaml");
-    // auto logger = std::make_unique<YoloVino::YoloVinoLogger>();
-    logger->print_yaml_info();
-    logger->set_info_level(YoloVino::LoggerInfoLevel::debug_info);
-    // YoloVino::Yolov8poseVino vino(std::move(logger));
-    YoloVino::Yolov5fourpointVino vino(std::move(logger));
+    // 相机模型: 按分辨率预计算去畸变查找表,先取一帧得到分辨率
+    std::shared_ptr<CameraModel> camera_model;
+    if (camera_yaml.empty() && std::ifstream("camera.yaml").good())
+    {
+        camera_yaml = "camera.yaml"; // calibration程序的默认输出
+    }
+    if (!camera_yaml.empty())
+    {
+        camera_model = CameraModel::load(camera_yaml);
+    }
+    if (!camera_model)
+    {
+        cv::Mat frame = c1->camera_grab();
+        camera_model = std::make_shared<CameraModel>(K, D, frame.empty() ? cv::Size(1440, 1080) : frame.size());
+    }
 
-    cv::namedWindow("Detections", cv::WINDOW_NORMAL);
-    cv::resizeWindow("Detections", 1200, 900);
+    // 等待模型就绪(已预热),之后第一帧的推理耗时与稳态相同
+    std::unique_ptr<YoloVino::YoloVino> vino_ptr;
+    std::unique_ptr<YoloVino::YoloVino> refiner_ptr;
+    std::unique_ptr<YoloVino::YoloCascade> cascade_ptr;
+    const auto wait_start = std::chrono::steady_clock::now();
+    if (cascade)
+    {
+        vino_ptr = v8_future.get();
+        refiner_ptr = v5_future.get();
+        cascade_ptr = std::make_unique<YoloVino::YoloCascade>(*vino_ptr, *refiner_ptr, YoloVino::CascadeConfig::load(cascade_yaml));
+    }
+    else if (v8_future.valid())
+    {
+        vino_ptr = v8_future.get();
+    }
+    else
+    {
+        vino_ptr = v5_future.get();
+    }
+    YoloVino::YoloVino &vino = *vino_ptr;
 
-    while (1)
+    // 灯条候选区域: 只在预处理线程中使用
+    std::unique_ptr<YoloVino::LightBarProposer> light_bar_ptr;
+    if (light_bar)
     {
-        frame = c1->camera_grab();
-        if (frame.empty())
-            break;
+        light_bar_ptr = std::make_unique<YoloVino::LightBarProposer>(YoloVino::LightBarConfig::load(light_bar_yaml));
+        if (!vino.is_dynamic_shape())
+        {
+            cout << "灯条候选区域: 模型没有打开dynamic_shape,候选区域仍缩放到完整输入尺寸,只能跳过没有候选的帧" << endl;
+        }
+    }
+    const auto ready_time = std::chrono::steady_clock::now();
+    cout << "模型就绪: 加载 " << std::chrono::duration<double>(ready_time - load_start).count() << " s, 其中等待 "
+         << std::chrono::duration<double>(ready_time - wait_start).count() << " s" << endl;
+
+    // 装甲板位姿解算器和多目标跟踪
+    // 解算器构造后只读,可被多个线程同时调用; 热启动用的上一帧位姿由PoseHistory保存
+    ArmorPose::ArmorPoseSolver solver(camera_model);
+    for (int class_id : large_armor_classes)
+    {
+        solver.set_armor_type(class_id, ArmorPose::ArmorType::large);
+    }
+    ArmorPose::PoseHistory pose_history;
+    ArmorTracker::ArmorTracker tracker(camera_model);
+    const auto start_time = std::chrono::steady_clock::now();
 
-        // --------- 推理+测速 ----------
-        auto t_start = Clock::now();
-        std::vector<YoloVino::NNDetectData> results = vino.safe_predict(frame, cv::Rect(0, 0, frame.cols, frame.rows));
-        auto t_end = Clock::now();
-        std::cout << "[Time] safe_predict total: "
-                  << std::chrono::duration_cast<us>(t_end - t_start).count()
-                  << " us" << std::endl;
+    // 可视化: 独立线程按限定帧率缩小后绘制,无界面模式下不创建
+    std::unique_ptr<Visual::VisualSink<VisualPayload>> sink;
+    if (!Visual::is_headless())
+    {
+        sink = std::make_unique<Visual::VisualSink<VisualPayload>>(
+            [&camera_model](cv::Mat &img, const VisualPayload &payload, double scale)
+            { draw_results(img, *camera_model, payload, scale); },
+            viz_config);
+        sink->start();
+    }
+    else
+    {
+        cout << "无界面模式运行, Ctrl+C退出" << endl;
+    }
+    std::signal(SIGINT, handle_signal);
 
-        // ---------- 可视化 ----------
-        for (const auto &det : results)
+    // 自适应质量: 降级动作按对结果影响从小到大叠加,等级i启用前i个动作; 当前配置下不起作用的动作不列入
+    enum class Degrade
+    {
+        viz,    // 可视化只取每4帧中的1帧
+        roi,    // 灯条候选区域和级联裁剪区域的放大倍数缩小到0.75倍
+        refine, // 跳过级联第二级
+        input,  // 网络输入的最长边限制为320(需要dynamic_shape)
+    };
+    std::vector<Degrade> degrade_steps;
+    std::unique_ptr<QualityControl::QualityController> quality;
+    const float light_bar_expand = light_bar_ptr ? light_bar_ptr->get_config().roi_expand : 1.0f;
+    const float crop_expand = cascade_ptr ? cascade_ptr->get_config().crop_expand : 1.0f;
+    const int degraded_input = 320;
+    if (budget_ms > 0.0)
+    {
+        if (sink)
+        {
+            degrade_steps.push_back(Degrade::viz);
+        }
+        if (light_bar_ptr || cascade_ptr)
+        {
+            degrade_steps.push_back(Degrade::roi);
+        }
+        if (cascade_ptr)
+        {
+            degrade_steps.push_back(Degrade::refine);
+        }
+        if (vino.is_dynamic_shape())
         {
-            if (det.keypoints.size() == 4)
-                for (const auto &det : results)
-                {
-                    if (det.keypoints.size() == 4)
-                    {
+            degrade_steps.push_back(Degrade::input);
+            vino.prepare_input_limit(degraded_input, camera_model->get_image_size());
+        }
+        QualityControl::QualityConfig quality_config;
+        quality_config.budget_ms = budget_ms;
+        quality_config.levels = static_cast<int>(degrade_steps.size()) + 1;
+        quality = std::make_unique<QualityControl::QualityController>(quality_config);
+        cout << "自适应质量: 预算 " << budget_ms << " ms, " << degrade_steps.size() << " 级降级" << endl;
+    }
+    auto degraded = [&degrade_steps](int level, Degrade step)
+    {
+        const auto end = degrade_steps.begin() + std::min(static_cast<size_t>(level), degrade_steps.size());
+        return std::find(degrade_steps.begin(), end, step) != end;
+    };
 
-                        // 绘制检测框（绿色）
-                        cv::rectangle(frame, det.rect, cv::Scalar(0, 255, 0), 2);
-                        image_points.push_back({det.keypoints[0].x, det.keypoints[0].y}); // 左上
-                        image_points.push_back({det.keypoints[1].x, det.keypoints[1].y}); // 左下
-                        image_points.push_back({det.keypoints[2].x, det.keypoints[2].y}); // 右下
-                        image_points.push_back({det.keypoints[3].x, det.keypoints[3].y}); // 右上
+    // ---------- 流水线: 采集 -> 预处理 -> 推理 -> 后处理+位姿,每个阶段一个线程,结果交给可视化线程 ----------
+    // 核数足够时阶段i绑定到cpu i; 指定了--rt时按布局设置,没有写到的阶段不绑核
+    auto cpu_of = [pin_threads, &rt_config](int stage)
+    {
+        return pin_threads && rt_config.empty() && std::thread::hardware_concurrency() >= 5 ? stage : -1;
+    };
+    Pipeline::Pipeline<FrameJob> pipeline;
+    if (!rt_config.empty())
+    {
+        pipeline.set_thread_init([&rt_config](const std::string &name)
+                                 {
+            if (const ThreadPlacement::ThreadSpec *spec = rt_config.find(name))
+            {
+                ThreadPlacement::apply_to_current_thread(name, *spec);
+            } });
+    }
+
+    // 结果输出通道: 下游没有启动时消息直接丢弃
+    std::unique_ptr<ResultLink::Publisher> result_link;
+    if (!result_link_uri.empty())
+    {
+        auto transport = ResultLink::open_transport(result_link_uri);
+        if (transport)
+        {
+            result_link = std::make_unique<ResultLink::Publisher>(std::move(transport));
+        }
+    }
 
-                        cool_pnp(image_points);
-                    }
-                    image_points.clear();
-                }
+    // 帧总线: 第一帧到达后按帧大小创建,之后每帧拷贝一次到共享内存,不等待读者
+    std::unique_ptr<FrameBus::Writer> frame_bus;
+    bool frame_bus_failed = false;
+    uint64_t frame_count = 0;
+
+    // 采集: 相机取图
+    // 流水线循环使用FrameJob,job中是之前某一帧的内容: 各阶段覆盖自己写的字段,Mat和vector按原尺寸/容量复用
+    pipeline.set_source("capture", [&](FrameJob &job)
+                        {
+        // 逐帧追踪: 各阶段先设置帧号,之后记录的片段都属于这一帧
+        job.frame_id = ++frame_count;
+        job.quality_level = quality ? quality->level() : 0;
+        FrameTrace::set_frame(job.frame_id);
+        c1->camera_grab(job.frame);
+        const auto now = std::chrono::steady_clock::now();
+        job.timestamp = std::chrono::duration<double>(now - start_time).count();
+        job.capture_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        if (job.frame.empty())
+        {
+            return false;
+        }
+        if (!frame_bus_name.empty() && !frame_bus && !frame_bus_failed)
+        {
+            frame_bus = FrameBus::Writer::create(frame_bus_name, job.frame.total() * job.frame.elemSize());
+            frame_bus_failed = !frame_bus;
+        }
+        if (frame_bus)
+        {
+            FRAME_TRACE_SPAN("frame_bus");
+            frame_bus->publish(job.frame, job.capture_ns);
+        }
+        return true; }, cpu_of(0));
+
+    // 预处理: 推理跟不上时只处理最新的帧
+    // 打开灯条候选时只letterbox全部候选的外接区域,没有候选的帧跳过推理但仍交给后处理(跟踪器需要知道目标消失)
+    pipeline.add_stage("preprocess", [&](FrameJob &job)
+                       {
+        FrameTrace::set_frame(job.frame_id);
+        cv::Rect roi(0, 0, job.frame.cols, job.frame.rows);
+        job.skip_nn = false;
+        if (quality)
+        {
+            vino.set_input_limit(degraded(job.quality_level, Degrade::input) ? degraded_input : 0);
         }
+        if (light_bar_ptr)
+        {
+            light_bar_ptr->set_roi_expand(degraded(job.quality_level, Degrade::roi) ? light_bar_expand * 0.75f : light_bar_expand);
+            roi = light_bar_ptr->select_roi(job.frame);
+            job.skip_nn = roi.area() == 0;
+            if (job.skip_nn)
+            {
+                return true;
+            }
+        }
+        return vino.letterbox(job.frame, roi, job.input, job.info); },
+                       {2, Pipeline::keep_latest}, cpu_of(1));
+
+    // 推理
+    pipeline.add_stage("infer", [&](FrameJob &job)
+                       {
+        FrameTrace::set_frame(job.frame_id);
+        if (!job.skip_nn)
+        {
+            vino.infer(job.input, job.info, job.output);
+        }
+        return true; }, {2, Pipeline::block}, cpu_of(2));
 
-        cv::imshow("Detections", frame);
+    // 后处理的候选和NMS缓冲区,只在后处理线程中使用
+    YoloVino::DetectWorkspace postprocess_workspace;
+    VisualPayload visual_payload; // 交给可视化线程的结果,与显示线程交换后复用
 
-        int key = cv::waitKey(1);
-        if (key == 27 || key == 'q')
+    // 后处理 + 跟踪关联 + 位姿解算: 一帧内的全部装甲板一次解算,同一目标用上一帧位姿热启动
+    pipeline.add_stage("postprocess", [&](FrameJob &job)
+                       {
+        FrameTrace::set_frame(job.frame_id);
+        if (job.skip_nn)
         {
-            break;
+            job.results.clear();
+        }
+        else
+        {
+            vino.postprocess(job.output, job.info, job.frame.size(), job.results, postprocess_workspace);
+        }
+        if (cascade_ptr && !degraded(job.quality_level, Degrade::refine))
+        {
+            cascade_ptr->set_crop_expand(degraded(job.quality_level, Degrade::roi) ? crop_expand * 0.75f : crop_expand);
+            cascade_ptr->refine(job.frame, job.results);
+        }
+        {
+            STAGE_TIMER(pnp);
+            tracker.associate(job.results, job.timestamp, job.track_ids);
+            job.poses.resize(job.results.size());
+            solver.solve(job.results, job.poses, pose_history.lookup(job.track_ids));
+            pose_history.store(job.track_ids, job.poses);
+            tracker.update(job.track_ids, job.poses);
+        }
+        if (result_link)
+        {
+            FRAME_TRACE_SPAN("output");
+            publish_results(*result_link, job);
         }
+
+        // 结果已经输出,按采集到此刻的延迟调整之后的帧的等级
+        if (quality)
+        {
+            quality->observe((ResultLink::now_ns() - job.capture_ns) * 1e-6);
+        }
+
+        // 只在可视化线程需要新帧时交接,不在这里绘制
+        if (sink && sink->wants_frame() && (!degraded(job.quality_level, Degrade::viz) || job.frame_id % 4 == 0))
+        {
+            visual_payload.results.assign(job.results.begin(), job.results.end());
+            visual_payload.track_ids.assign(job.track_ids.begin(), job.track_ids.end());
+            visual_payload.poses.assign(job.poses.begin(), job.poses.end());
+            visual_payload.quality_level = job.quality_level;
+            // 原图与显示线程交换,job换回显示线程用过的图像,下次采集直接写入
+            sink->submit_swap(job.frame, visual_payload);
+        }
+        return true; }, {2, Pipeline::block}, cpu_of(3));
+
+    pipeline.start();
+    while (pipeline.is_running())
+    {
+        if (stop_signal || (sink && sink->quit_requested()))
+        {
+            pipeline.request_stop();
+        }
+        if (!trace_prefix.empty())
+        {
+            FrameTrace::dump_if_requested(trace_prefix);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    pipeline.wait();
+    Pipeline::print_stats(pipeline.get_stats());
+    if (sink)
+    {
+        sink->stop();
+        cout << "可视化: 显示 " << sink->get_shown() << " 帧, 丢弃 " << sink->get_dropped() << " 帧" << endl;
+    }
+    if (cascade_ptr)
+    {
+        cascade_ptr->get_stats().print();
+    }
+    if (light_bar_ptr)
+    {
+        light_bar_ptr->get_stats().print();
+    }
+    if (quality)
+    {
+        quality->print_stats();
+    }
+    if (result_link)
+    {
+        cout << "结果输出: 发送 " << result_link->get_sent() << " 条, 失败 " << result_link->get_dropped() << " 条" << endl;
+    }
+    if (frame_bus)
+    {
+        cout << "帧总线" << frame_bus->get_name() << ": 发布 " << frame_bus->get_published() << " 帧" << endl;
+    }
+
+    if (!trace_prefix.empty())
+    {
+        const std::string trace_path = trace_prefix + "_exit.json";
+        cout << "逐帧追踪: 导出 " << FrameTrace::dump(trace_path) << " 个片段到 " << trace_path << endl;
     }
 
-    cv::destroyAllWindows();
+    StageProfiler::stop_report();
     return 0;
 }
@@ -0,0 +1,471 @@
+#include "offline_runner.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace Offline
+{
+
+    namespace
+    {
+        // 列块的行数,写满后一次写出
+        constexpr size_t rows_per_block = 4096;
+
+        // 一个读取单元: 一张图片或一个录像(录像只能顺序解码,整段交给一个读取线程)
+        struct Unit
+        {
+            uint16_t source = 0;       // 输入序号
+            std::string path;          // 图片或录像路径
+            bool video = false;
+            uint32_t first_frame = 0;  // 图片在所属输入内的帧号
+        };
+
+        // 一帧的全局排序键: (读取单元, 单元内帧号)
+        using FrameKey = std::pair<uint32_t, uint32_t>;
+
+        struct FrameTask
+        {
+            FrameKey key;
+            cv::Mat input;                   // letterbox后的网络输入
+            YoloVino::LetterboxInfo info;    // letterbox参数
+            cv::Size frame_size;             // 原图尺寸
+        };
+
+        struct FrameResult
+        {
+            std::vector<YoloVino::NNDetectData> detections;
+            std::vector<ArmorPose::ArmorPoseData> poses;
+        };
+
+        // 把输入展开为读取单元,目录内的图片按文件名排序
+        bool list_units(const std::vector<std::string> &inputs, std::vector<Unit> &units)
+        {
+            for (size_t source = 0; source < inputs.size(); source++)
+            {
+                std::vector<cv::String> files;
+                for (const char *pattern : {"/*.png", "/*.jpg", "/*.bmp"})
+                {
+                    std::vector<cv::String> found;
+                    cv::glob(inputs[source] + pattern, found, false);
+                    files.insert(files.end(), found.begin(), found.end());
+                }
+                std::sort(files.begin(), files.end());
+                if (files.empty())
+                {
+                    if (!cv::VideoCapture(inputs[source]).isOpened())
+                    {
+                        std::cout << "[Offline] 无法打开 " << inputs[source] << std::endl;
+                        return false;
+                    }
+                    units.push_back(Unit{static_cast<uint16_t>(source), inputs[source], true, 0});
+                    continue;
+                }
+                for (size_t i = 0; i < files.size(); i++)
+                {
+                    units.push_back(Unit{static_cast<uint16_t>(source), files[i], false, static_cast<uint32_t>(i)});
+                }
+            }
+            return true;
+        }
+
+        // 有界队列,读取线程比推理快时阻塞,限制在途的帧数
+        class TaskQueue
+        {
+        private:
+            std::mutex m_mutex;
+            std::condition_variable m_not_full, m_not_empty;
+            std::deque<FrameTask> m_tasks;
+            size_t m_capacity;
+            bool m_closed = false;
+
+        public:
+            explicit TaskQueue(size_t capacity) : m_capacity(capacity) {}
+
+            void push(FrameTask &&task)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_not_full.wait(lock, [this]()
+                                { return m_tasks.size() < m_capacity; });
+                m_tasks.push_back(std::move(task));
+                m_not_empty.notify_one();
+            }
+
+            // 队列关闭且取空后返回false
+            bool pop(FrameTask &task)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_not_empty.wait(lock, [this]()
+                                 { return !m_tasks.empty() || m_closed; });
+                if (m_tasks.empty())
+                {
+                    return false;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+                m_not_full.notify_one();
+                return true;
+            }
+
+            void close()
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_closed = true;
+                m_not_empty.notify_all();
+            }
+        };
+
+        // 按排序键重排的结果: 推理线程乱序放入,写入线程按顺序取出
+        class ResultReorder
+        {
+        private:
+            std::mutex m_mutex;
+            std::condition_variable m_changed;
+            std::map<FrameKey, FrameResult> m_results;
+            std::vector<int64_t> m_unit_frames; // 各读取单元的帧数,读完之前为-1
+
+        public:
+            explicit ResultReorder(size_t units) : m_unit_frames(units, -1) {}
+
+            void put(const FrameKey &key, FrameResult &&result)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_results.emplace(key, std::move(result));
+                m_changed.notify_all();
+            }
+
+            void finish_unit(uint32_t unit, int64_t frames)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_unit_frames[unit] = frames;
+                m_changed.notify_all();
+            }
+
+            // 等待key的结果; 该单元已经没有这一帧时返回false
+            bool take(const FrameKey &key, FrameResult &result)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                for (;;)
+                {
+                    auto it = m_results.find(key);
+                    if (it != m_results.end())
+                    {
+                        result = std::move(it->second);
+                        m_results.erase(it);
+                        return true;
+                    }
+                    const int64_t frames = m_unit_frames[key.first];
+                    if (frames >= 0 && key.second >= frames)
+                    {
+                        return false;
+                    }
+                    m_changed.wait(lock);
+                }
+            }
+        };
+
+        // 列式结果文件的写入
+        class ColumnWriter
+        {
+        private:
+            std::ofstream m_file;
+            std::vector<uint32_t> m_frame, m_source_frame;
+            std::vector<uint16_t> m_source;
+            std::vector<int16_t> m_class_id, m_x, m_y, m_w, m_h;
+            std::vector<float> m_confidence, m_reprojection_error;
+            std::array<std::vector<float>, YoloVino::NNDetectData::keypoint_count> m_kpt_x, m_kpt_y;
+            std::vector<uint8_t> m_pose_valid;
+            std::array<std::vector<float>, 3> m_tvec, m_rvec;
+            uint64_t m_rows = 0;
+
+            template <typename T>
+            void write_column(const std::vector<T> &column)
+            {
+                m_file.write(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+            }
+
+            template <typename T>
+            void write_value(T value)
+            {
+                m_file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+            }
+
+            static int16_t clamp16(int value)
+            {
+                return static_cast<int16_t>(std::max(-32768, std::min(32767, value)));
+            }
+
+            void flush_block()
+            {
+                if (m_frame.empty())
+                {
+                    return;
+                }
+                write_value(static_cast<uint32_t>(m_frame.size()));
+                write_column(m_frame);
+                write_column(m_source);
+                write_column(m_source_frame);
+                write_column(m_class_id);
+                write_column(m_confidence);
+                write_column(m_x);
+                write_column(m_y);
+                write_column(m_w);
+                write_column(m_h);
+                for (const auto &column : m_kpt_x)
+                {
+                    write_column(column);
+                }
+                for (const auto &column : m_kpt_y)
+                {
+                    write_column(column);
+                }
+                write_column(m_pose_valid);
+                for (const auto &column : m_tvec)
+                {
+                    write_column(column);
+                }
+                for (const auto &column : m_rvec)
+                {
+                    write_column(column);
+                }
+                write_column(m_reprojection_error);
+
+                m_frame.clear(), m_source.clear(), m_source_frame.clear();
+                m_class_id.clear(), m_confidence.clear(), m_x.clear(), m_y.clear(), m_w.clear(), m_h.clear();
+                m_pose_valid.clear(), m_reprojection_error.clear();
+                for (size_t k = 0; k < m_kpt_x.size(); k++)
+                {
+                    m_kpt_x[k].clear(), m_kpt_y[k].clear();
+                }
+                for (size_t k = 0; k < 3; k++)
+                {
+                    m_tvec[k].clear(), m_rvec[k].clear();
+                }
+            }
+
+        public:
+            bool open(const std::string &path)
+            {
+                m_file.open(path, std::ios::binary | std::ios::trunc);
+                if (!m_file)
+                {
+                    return false;
+                }
+                m_file.write("T8OFFLN1", 8);
+                return true;
+            }
+
+            void append(uint32_t frame, uint16_t source, uint32_t source_frame, const FrameResult &result)
+            {
+                for (size_t i = 0; i < result.detections.size(); i++)
+                {
+                    const YoloVino::NNDetectData &det = result.detections[i];
+                    const ArmorPose::ArmorPoseData &pose = result.poses[i];
+                    m_frame.push_back(frame);
+                    m_source.push_back(source);
+                    m_source_frame.push_back(source_frame);
+                    m_class_id.push_back(static_cast<int16_t>(det.class_id));
+                    m_confidence.push_back(det.confidence);
+                    m_x.push_back(clamp16(det.rect.x));
+                    m_y.push_back(clamp16(det.rect.y));
+                    m_w.push_back(clamp16(det.rect.width));
+                    m_h.push_back(clamp16(det.rect.height));
+                    for (size_t k = 0; k < det.keypoints.size(); k++)
+                    {
+                        m_kpt_x[k].push_back(det.keypoints[k].x);
+                        m_kpt_y[k].push_back(det.keypoints[k].y);
+                    }
+                    m_pose_valid.push_back(pose.valid ? 1 : 0);
+                    for (int k = 0; k < 3; k++)
+                    {
+                        m_tvec[k].push_back(static_cast<float>(pose.tvec[k]));
+                        m_rvec[k].push_back(static_cast<float>(pose.rvec[k]));
+                    }
+                    m_reprojection_error.push_back(static_cast<float>(pose.reprojection_error));
+                    m_rows++;
+                    if (m_frame.size() >= rows_per_block)
+                    {
+                        flush_block();
+                    }
+                }
+            }
+
+            // 写出剩余的行和文件尾
+            bool close(const std::vector<std::string> &inputs, const std::vector<uint32_t> &source_frames, uint64_t total_frames)
+            {
+                flush_block();
+                write_value(static_cast<uint32_t>(0));
+                write_value(static_cast<uint32_t>(inputs.size()));
+                for (size_t i = 0; i < inputs.size(); i++)
+                {
+                    write_value(static_cast<uint32_t>(inputs[i].size()));
+                    m_file.write(inputs[i].data(), inputs[i].size());
+                    write_value(source_frames[i]);
+                }
+                write_value(total_frames);
+                write_value(m_rows);
+                m_file.write("T8OFFLN1", 8);
+                m_file.close();
+                return !m_file.fail();
+            }
+
+            uint64_t rows() const { return m_rows; }
+        };
+
+        double seconds_since(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    } // namespace
+
+    int run(YoloVino::YoloVino &vino, const ArmorPose::ArmorPoseSolver &solver, const OfflineConfig &config)
+    {
+        std::vector<Unit> units;
+        if (config.inputs.empty() || config.inputs.size() > 65535 || !list_units(config.inputs, units))
+        {
+            return 1;
+        }
+        ColumnWriter writer;
+        if (!writer.open(config.output))
+        {
+            std::cout << "[Offline] 无法写入 " << config.output << std::endl;
+            return 1;
+        }
+
+        // 吞吐模型: 全部帧使用默认输入尺寸,推理请求数默认取插件的建议值(约等于推理流数)
+        vino.disable_dynamic_shape();
+        YoloVino::InferBucket bucket = vino.compile_throughput_bucket();
+        const int requests = config.infer_requests > 0
+                                 ? config.infer_requests
+                                 : std::max(1, static_cast<int>(bucket.compiled_model.get_property(ov::optimal_number_of_infer_requests)));
+        const int cpus = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        const int readers = config.readers > 0 ? config.readers : std::max(2, cpus / 4);
+        std::cout << "[Offline] " << config.inputs.size() << " 个输入, " << units.size() << " 个读取单元, "
+                  << readers << " 个读取线程, " << requests << " 个推理请求" << std::endl;
+
+        TaskQueue queue(static_cast<size_t>(2 * requests));
+        ResultReorder reorder(units.size());
+        const auto start = std::chrono::steady_clock::now();
+
+        // 读取: 按单元序号领取,解码后直接letterbox,原图不进入队列
+        std::atomic<size_t> next_unit{0};
+        std::vector<std::thread> reader_threads;
+        for (int r = 0; r < readers; r++)
+        {
+            reader_threads.emplace_back([&]()
+                                        {
+                cv::Mat frame;
+                for (size_t u = next_unit++; u < units.size(); u = next_unit++)
+                {
+                    const Unit &unit = units[u];
+                    cv::VideoCapture capture;
+                    if (unit.video)
+                    {
+                        capture.open(unit.path);
+                    }
+                    uint32_t frames = 0;
+                    for (;;)
+                    {
+                        if (unit.video ? !capture.read(frame) : frames > 0)
+                        {
+                            break;
+                        }
+                        if (!unit.video)
+                        {
+                            frame = cv::imread(unit.path);
+                        }
+                        FrameTask task;
+                        task.key = FrameKey(static_cast<uint32_t>(u), frames++);
+                        task.frame_size = frame.size();
+                        if (frame.empty() || !vino.letterbox(frame, cv::Rect(0, 0, frame.cols, frame.rows), task.input, task.info))
+                        {
+                            // 读不出或无法letterbox的帧仍占一个帧号,结果为空
+                            reorder.put(task.key, FrameResult());
+                            continue;
+                        }
+                        queue.push(std::move(task));
+                    }
+                    reorder.finish_unit(static_cast<uint32_t>(u), frames);
+                } });
+        }
+
+        // 推理 + 后处理 + 位姿解算: 每个线程一个推理请求和一份工作区
+        std::vector<std::thread> infer_threads;
+        for (int r = 0; r < requests; r++)
+        {
+            infer_threads.emplace_back([&, r]()
+                                       {
+                ov::InferRequest request = r == 0 ? bucket.infer_request : bucket.compiled_model.create_infer_request();
+                YoloVino::DetectWorkspace workspace;
+                FrameTask task;
+                while (queue.pop(task))
+                {
+                    YoloVino::YoloVino::bind_inputs(bucket, request, ov::Tensor(bucket.compiled_model.input(0).get_element_type(),
+                                                                                bucket.compiled_model.input(0).get_shape(), task.input.data),
+                                                    task.info);
+                    request.infer();
+
+                    // 直接在推理请求的输出上解码,不拷贝
+                    const cv::Mat output = YoloVino::YoloVino::output_view(bucket, request);
+                    task.info.bucket = &bucket; // 后处理按吞吐模型的输出格式(是否图内NMS)
+                    FrameResult result;
+                    vino.postprocess(output, task.info, task.frame_size, result.detections, workspace);
+                    result.poses.resize(result.detections.size());
+                    solver.solve(result.detections, result.poses);
+                    reorder.put(task.key, std::move(result));
+                } });
+        }
+
+        // 写入: 按(单元, 帧号)的顺序取结果,分配全局帧号
+        std::vector<uint32_t> source_frames(config.inputs.size(), 0);
+        uint64_t total_frames = 0;
+        double last_report = 0.0;
+        FrameResult result;
+        for (uint32_t u = 0; u < units.size(); u++)
+        {
+            const Unit &unit = units[u];
+            for (uint32_t f = 0; reorder.take(FrameKey(u, f), result); f++)
+            {
+                const uint32_t source_frame = unit.video ? f : unit.first_frame;
+                writer.append(static_cast<uint32_t>(total_frames), unit.source, source_frame, result);
+                source_frames[unit.source] = std::max(source_frames[unit.source], source_frame + 1);
+                total_frames++;
+
+                const double elapsed = seconds_since(start);
+                if (elapsed - last_report >= 5.0)
+                {
+                    last_report = elapsed;
+                    std::printf("[Offline] %llu 帧, %.1f 帧/s\n", static_cast<unsigned long long>(total_frames), total_frames / elapsed);
+                }
+            }
+        }
+
+        for (std::thread &thread : reader_threads)
+        {
+            thread.join();
+        }
+        queue.close();
+        for (std::thread &thread : infer_threads)
+        {
+            thread.join();
+        }
+        const bool written = writer.close(config.inputs, source_frames, total_frames);
+        const double elapsed = seconds_since(start);
+
+        std::printf("========== 离线处理 ==========\n");
+        std::printf("帧数 %llu, 检测 %llu, 耗时 %.2f s, %.1f 帧/s\n", static_cast<unsigned long long>(total_frames),
+                    static_cast<unsigned long long>(writer.rows()), elapsed, elapsed > 0.0 ? total_frames / elapsed : 0.0);
+        std::printf("结果 %s%s\n", config.output.c_str(), written ? "" : " (写入失败)");
+        return written ? 0 : 1;
+    }
+
+} // namespace Offline
@@ -0,0 +1,38 @@
+#pragma once
+#include "yolo_vino.hpp"
+#include "armor_pose.hpp"
+#include <string>
+#include <vector>
+
+// 离线吞吐模式: 对录好的数据集(图片目录或录像)批量检测,占满全部的核
+// 读取线程池解码并letterbox -> 多个推理线程各持一个推理请求(模型按THROUGHPUT性能提示编译),
+// 推理后在同一线程中后处理和位姿解算 -> 主线程按输入顺序写入列式结果文件
+// 输出顺序与线程数、调度无关: 先按输入的顺序,目录内按文件名,录像内按帧序
+namespace Offline
+{
+
+    struct OfflineConfig
+    {
+        std::vector<std::string> inputs;              // 图片目录或录像文件,按给出的顺序处理
+        std::string output = "offline_results.t8r";   // 结果文件
+        int readers = 0;                              // 读取线程数,0为按cpu数
+        int infer_requests = 0;                       // 推理请求(线程)数,0为插件建议的数目
+    };
+
+    /*
+        结果文件格式(小端):
+        文件头   char magic[8] = "T8OFFLN1"
+        若干列块 uint32 行数n, 之后每列连续n个值:
+                 frame u32(全局帧号), source u16(输入序号), source_frame u32(输入内帧号),
+                 class_id i16, confidence f32, x i16, y i16, w i16, h i16,
+                 kpt_x f32 x4列, kpt_y f32 x4列,
+                 pose_valid u8, tvec_x/y/z f32, rvec_x/y/z f32, reprojection_error f32
+        文件尾   uint32 0(空列块,表示列块结束), uint32 输入数, 每个输入: uint32 路径长度, 路径, uint32 帧数
+                 uint64 总帧数, uint64 总检测数, char magic[8]
+        没有检测的帧不占行,全局帧号 = 之前各输入的帧数之和 + 输入内帧号
+    */
+
+    // 处理全部输入,返回0为成功; 模型的dynamic_shape会被关闭,全部帧使用默认输入尺寸
+    int run(YoloVino::YoloVino &vino, const ArmorPose::ArmorPoseSolver &solver, const OfflineConfig &config);
+
+} // namespace Offline
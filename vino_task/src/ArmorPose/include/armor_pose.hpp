@@ -0,0 +1,130 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include "yolo_vino.hpp"
+#include "CameraModel.h"
+
+namespace ArmorPose{
+
+//连续内存的只读/可写视图(C++17没有std::span)
+template<typename T>
+class Span
+{
+private:
+    T *m_data = nullptr;
+    size_t m_size = 0;
+
+public:
+    Span() = default;
+    Span(T *data, size_t size) : m_data(data), m_size(size) {}
+    //任何有data()和size()的容器(vector, array, 另一个Span)
+    template<typename Container>
+    Span(Container &&container) : m_data(container.data()), m_size(container.size()) {}
+
+    T *data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T *begin() const { return m_data; }
+    T *end() const { return m_data + m_size; }
+    T &operator[](size_t index) const { return m_data[index]; }
+    Span first(size_t count) const { return Span(m_data, std::min(count, m_size)); }
+};
+
+//装甲板类型,决定四个角点的3D尺寸
+enum class ArmorType
+{
+    small = 0,//小装甲板
+    large,//大装甲板
+};
+
+//一个装甲板的位姿(相机坐标系)
+struct ArmorPoseData
+{
+    bool valid = false;//解算是否成功
+    bool warm_started = false;//是否由上一帧的位姿热启动
+    ArmorType type = ArmorType::small;//解算时使用的装甲板类型
+    cv::Vec3d rvec;//旋转向量
+    cv::Vec3d tvec;//平移向量(m)
+    double distance = 0.0;//距离(m)
+    double pitch = 0.0;//俯仰角(deg)
+    double yaw = 0.0;//偏航角(deg)
+    double roll = 0.0;//横滚角(deg)
+    double reprojection_error = 0.0;//重投影误差(像素,RMS)
+};
+
+/*
+    装甲板是平面目标,四个角点用IPPE求闭式解(两个候选里取重投影误差小的),
+    同一目标上一帧有位姿时直接从上一帧出发做几次LM迭代,误差过大再退回IPPE
+    角点先经CameraModel的查找表转换到归一化去畸变平面,解算时内参为单位阵、无畸变
+    构造并设置好装甲板类型后只有const成员函数,可以被多个线程(多路相机)同时调用
+*/
+class ArmorPoseSolver
+{
+public:
+    static constexpr int MAX_CLASSES = 16;//类别编号上限
+
+private:
+    std::shared_ptr<const CameraModel> m_camera;//相机模型
+    std::array<std::vector<cv::Point3f>, 2> m_world_points;//各类型装甲板四个角点(左上,左下,右下,右上)
+    std::array<ArmorType, MAX_CLASSES> m_class_types;//各类别的装甲板类型
+    int m_refine_iterations = 5;//热启动时LM的最大迭代次数
+    double m_warm_start_max_error = 2.0;//热启动后的重投影误差超过该值则重新用IPPE解算
+    size_t m_parallel_min = 4;//一帧装甲板数达到该值时用OpenCV线程池并行解算
+
+    void fill_angles(ArmorPoseData &pose) const;//由旋转向量求距离和欧拉角
+    //归一化平面上的重投影误差,换算成像素
+    double reprojection_error(const std::vector<cv::Point3f> &world_points, const cv::Vec3d &rvec, const cv::Vec3d &tvec, const cv::Point2f *normalized_points) const;
+    //解算一个检测,不满足条件时返回无效位姿
+    ArmorPoseData solve_detection(const YoloVino::NNDetectData &detection, const ArmorPoseData *warm_start) const;
+
+public:
+    ArmorPoseSolver(
+        std::shared_ptr<const CameraModel> camera,//相机模型
+        cv::Size2f small_armor = cv::Size2f(0.135f, 0.055f),//小装甲板宽高(m)
+        cv::Size2f large_armor = cv::Size2f(0.225f, 0.055f)//大装甲板宽高(m)
+    );
+
+    //设置某类别的装甲板类型(默认全部为小装甲板),需在开始解算前调用
+    void set_armor_type(int class_id, ArmorType type);
+    ArmorType get_armor_type(int class_id) const;
+
+    //解算一帧中的全部装甲板,poses[i]对应detections[i],返回写入的部分
+    //warm_starts为空或warm_starts[i]为空时第i个检测不热启动
+    Span<ArmorPoseData> solve(Span<const YoloVino::NNDetectData> detections, Span<ArmorPoseData> poses,
+                              Span<const ArmorPoseData *const> warm_starts = Span<const ArmorPoseData *const>()) const;
+
+    //解算单个装甲板(像素坐标),warm_start为空时用IPPE
+    ArmorPoseData solve_one(const std::vector<cv::Point2f> &image_points, ArmorType type, const ArmorPoseData *warm_start) const;
+
+    //解算单个装甲板(已经去畸变的归一化坐标,4个点)
+    ArmorPoseData solve_normalized(const cv::Point2f *normalized_points, ArmorType type, const ArmorPoseData *warm_start) const;
+
+    //原来的解法: 像素坐标上不带初值的SOLVEPNP_ITERATIVE,用于对比
+    ArmorPoseData solve_iterative(const std::vector<cv::Point2f> &image_points, ArmorType type) const;
+
+    const std::vector<cv::Point3f> &get_world_points(ArmorType type) const { return m_world_points[static_cast<int>(type)]; }
+};
+
+/*
+    按目标编号保存上一帧的位姿,为ArmorPoseSolver提供热启动
+    每路相机(每条处理线程)各自持有一个,不跨线程共享
+*/
+class PoseHistory
+{
+private:
+    std::unordered_map<int, ArmorPoseData> m_last_poses;//上一帧各目标的位姿
+    std::unordered_map<int, ArmorPoseData> m_current_poses;//本帧各目标的位姿
+    std::vector<const ArmorPoseData *> m_warm_starts;//lookup的结果
+
+public:
+    //每个检测对应的上一帧位姿,没有时为空;结果在下一次store之前有效
+    Span<const ArmorPoseData *const> lookup(const std::vector<int> &track_ids);
+
+    //保存本帧的位姿,本帧没有出现的目标不再保留
+    void store(const std::vector<int> &track_ids, Span<const ArmorPoseData> poses);
+};
+
+} // namespace ArmorPose
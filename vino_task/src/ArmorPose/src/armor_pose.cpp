@@ -0,0 +1,248 @@
+#include "armor_pose.hpp"
+#include <limits>
+
+namespace ArmorPose
+{
+
+    namespace
+    {
+        // 归一化平面上的"相机": 单位内参,无畸变
+        const cv::Matx33d IDENTITY_K = cv::Matx33d::eye();
+
+        // 装甲板坐标系原点在中心,x向右,y向下,z朝里
+        std::vector<cv::Point3f> make_world_points(cv::Size2f armor)
+        {
+            return {
+                cv::Point3f(-armor.width / 2.0f, -armor.height / 2.0f, 0.0f), // 左上
+                cv::Point3f(-armor.width / 2.0f, armor.height / 2.0f, 0.0f),  // 左下
+                cv::Point3f(armor.width / 2.0f, armor.height / 2.0f, 0.0f),   // 右下
+                cv::Point3f(armor.width / 2.0f, -armor.height / 2.0f, 0.0f),  // 右上
+            };
+        }
+    } // namespace
+
+    ArmorPoseSolver::ArmorPoseSolver(std::shared_ptr<const CameraModel> camera, cv::Size2f small_armor, cv::Size2f large_armor)
+        : m_camera(std::move(camera))
+    {
+        m_world_points[static_cast<int>(ArmorType::small)] = make_world_points(small_armor);
+        m_world_points[static_cast<int>(ArmorType::large)] = make_world_points(large_armor);
+        m_class_types.fill(ArmorType::small);
+    }
+
+    void ArmorPoseSolver::set_armor_type(int class_id, ArmorType type)
+    {
+        if (class_id >= 0 && class_id < MAX_CLASSES)
+        {
+            m_class_types[class_id] = type;
+        }
+    }
+
+    ArmorType ArmorPoseSolver::get_armor_type(int class_id) const
+    {
+        return class_id >= 0 && class_id < MAX_CLASSES ? m_class_types[class_id] : ArmorType::small;
+    }
+
+    void ArmorPoseSolver::fill_angles(ArmorPoseData &pose) const
+    {
+        cv::Matx33d R;
+        cv::Rodrigues(pose.rvec, R); // 旋转向量→3×3旋转矩阵
+
+        // 求出距离
+        pose.distance = cv::norm(pose.tvec);
+
+        // 计算Roll，pitch，yaw三轴
+        const double RAD2DEG = 180.0 / CV_PI;
+        pose.pitch = std::asin(-R(1, 2)) * RAD2DEG;
+        pose.yaw = std::atan2(R(0, 2), R(2, 2)) * RAD2DEG;
+        pose.roll = std::atan2(R(1, 0), R(1, 1)) * RAD2DEG;
+    }
+
+    double ArmorPoseSolver::reprojection_error(const std::vector<cv::Point3f> &world_points, const cv::Vec3d &rvec, const cv::Vec3d &tvec, const cv::Point2f *normalized_points) const
+    {
+        cv::Matx33d R;
+        cv::Rodrigues(rvec, R);
+
+        double sum = 0.0;
+        for (size_t i = 0; i < world_points.size(); i++)
+        {
+            const cv::Point3f &w = world_points[i];
+            cv::Vec3d p = R * cv::Vec3d(w.x, w.y, w.z) + tvec;
+            double dx = p[0] / p[2] - normalized_points[i].x;
+            double dy = p[1] / p[2] - normalized_points[i].y;
+            sum += dx * dx + dy * dy;
+        }
+        return std::sqrt(sum / world_points.size()) * m_camera->get_focal();
+    }
+
+    ArmorPoseData ArmorPoseSolver::solve_one(const std::vector<cv::Point2f> &image_points, ArmorType type, const ArmorPoseData *warm_start) const
+    {
+        if (image_points.size() != 4)
+        {
+            return ArmorPoseData();
+        }
+        std::array<cv::Point2f, 4> normalized_points;
+        m_camera->undistort_points(image_points.data(), normalized_points.data(), 4);
+        return solve_normalized(normalized_points.data(), type, warm_start);
+    }
+
+    ArmorPoseData ArmorPoseSolver::solve_normalized(const cv::Point2f *normalized_points, ArmorType type, const ArmorPoseData *warm_start) const
+    {
+        const std::vector<cv::Point3f> &world_points = get_world_points(type);
+        const cv::Mat image_points(4, 1, CV_32FC2, const_cast<cv::Point2f *>(normalized_points)); // 只读视图
+
+        ArmorPoseData pose;
+        pose.type = type;
+
+        // 热启动: 从上一帧位姿出发迭代几次(装甲板类型必须相同)
+        if (warm_start != nullptr && warm_start->valid && warm_start->type == type)
+        {
+            cv::Mat rvec(warm_start->rvec);
+            cv::Mat tvec(warm_start->tvec);
+            cv::solvePnPRefineLM(world_points, image_points, IDENTITY_K, cv::noArray(), rvec, tvec,
+                                 cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, m_refine_iterations, 1e-9));
+            pose.rvec = cv::Vec3d(rvec);
+            pose.tvec = cv::Vec3d(tvec);
+            if (pose.tvec[2] > 0)
+            {
+                pose.reprojection_error = reprojection_error(world_points, pose.rvec, pose.tvec, normalized_points);
+                if (pose.reprojection_error <= m_warm_start_max_error)
+                {
+                    pose.valid = true;
+                    pose.warm_started = true;
+                    fill_angles(pose);
+                    return pose;
+                }
+            }
+        }
+
+        // 平面目标的闭式解,有两个候选
+        std::vector<cv::Mat> rvecs, tvecs;
+        int solutions = cv::solvePnPGeneric(world_points, image_points, IDENTITY_K, cv::noArray(),
+                                            rvecs, tvecs, false, cv::SOLVEPNP_IPPE);
+        pose = ArmorPoseData();
+        pose.type = type;
+        double best_error = std::numeric_limits<double>::max();
+        for (int i = 0; i < solutions; i++)
+        {
+            cv::Vec3d rvec(rvecs[i]);
+            cv::Vec3d tvec(tvecs[i]);
+            if (tvec[2] <= 0) // 装甲板必须在相机前方
+            {
+                continue;
+            }
+            double error = reprojection_error(world_points, rvec, tvec, normalized_points);
+            if (error < best_error)
+            {
+                best_error = error;
+                pose.rvec = rvec;
+                pose.tvec = tvec;
+                pose.reprojection_error = error;
+                pose.valid = true;
+            }
+        }
+
+        if (pose.valid)
+        {
+            fill_angles(pose);
+        }
+        return pose;
+    }
+
+    ArmorPoseData ArmorPoseSolver::solve_iterative(const std::vector<cv::Point2f> &image_points, ArmorType type) const
+    {
+        const std::vector<cv::Point3f> &world_points = get_world_points(type);
+        ArmorPoseData pose;
+        pose.type = type;
+        cv::Mat rvec, tvec;
+        if (image_points.size() != 4 ||
+            !cv::solvePnP(world_points, image_points, m_camera->get_camera_matrix(), m_camera->get_dist_coeffs(),
+                          rvec, tvec, false, cv::SOLVEPNP_ITERATIVE))
+        {
+            return pose;
+        }
+        pose.rvec = cv::Vec3d(rvec);
+        pose.tvec = cv::Vec3d(tvec);
+
+        std::array<cv::Point2f, 4> normalized_points;
+        m_camera->undistort_points(image_points.data(), normalized_points.data(), 4);
+        pose.reprojection_error = reprojection_error(world_points, pose.rvec, pose.tvec, normalized_points.data());
+        pose.valid = true;
+        fill_angles(pose);
+        return pose;
+    }
+
+    ArmorPoseData ArmorPoseSolver::solve_detection(const YoloVino::NNDetectData &detection, const ArmorPoseData *warm_start) const
+    {
+        // 左上,左下,右下,右上 → 归一化平面
+        static_assert(YoloVino::NNDetectData::keypoint_count == 4, "装甲板需要4个角点");
+        std::array<cv::Point2f, 4> normalized_points;
+        for (int i = 0; i < 4; i++)
+        {
+            normalized_points[i] = cv::Point2f(detection.keypoints[i].x, detection.keypoints[i].y);
+        }
+        m_camera->undistort_points(normalized_points.data(), normalized_points.data(), 4);
+        return solve_normalized(normalized_points.data(), get_armor_type(detection.class_id), warm_start);
+    }
+
+    Span<ArmorPoseData> ArmorPoseSolver::solve(Span<const YoloVino::NNDetectData> detections, Span<ArmorPoseData> poses,
+                                               Span<const ArmorPoseData *const> warm_starts) const
+    {
+        const size_t count = std::min(detections.size(), poses.size());
+        auto solve_range = [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                const ArmorPoseData *warm_start = i < warm_starts.size() ? warm_starts[i] : nullptr;
+                poses[i] = solve_detection(detections[i], warm_start);
+            }
+        };
+
+        // 装甲板较多时分给OpenCV的线程池,每个元素只写自己的poses[i]
+        if (count >= m_parallel_min)
+        {
+            cv::parallel_for_(cv::Range(0, static_cast<int>(count)), [&](const cv::Range &range)
+                              { solve_range(range.start, range.end); });
+        }
+        else
+        {
+            solve_range(0, count);
+        }
+        return poses.first(count);
+    }
+
+    Span<const ArmorPoseData *const> PoseHistory::lookup(const std::vector<int> &track_ids)
+    {
+        m_warm_starts.assign(track_ids.size(), nullptr);
+        for (size_t i = 0; i < track_ids.size(); i++)
+        {
+            if (track_ids[i] < 0)
+            {
+                continue;
+            }
+            auto it = m_last_poses.find(track_ids[i]);
+            if (it != m_last_poses.end())
+            {
+                m_warm_starts[i] = &it->second;
+            }
+        }
+        return m_warm_starts;
+    }
+
+    void PoseHistory::store(const std::vector<int> &track_ids, Span<const ArmorPoseData> poses)
+    {
+        m_current_poses.clear();
+        const size_t count = std::min(track_ids.size(), poses.size());
+        for (size_t i = 0; i < count; i++)
+        {
+            if (track_ids[i] >= 0 && poses[i].valid)
+            {
+                m_current_poses[track_ids[i]] = poses[i];
+            }
+        }
+
+        // 本帧没有出现的目标不再保留
+        m_last_poses.swap(m_current_poses);
+        m_warm_starts.clear();
+    }
+
+} // namespace ArmorPose
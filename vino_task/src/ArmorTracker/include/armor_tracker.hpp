@@ -0,0 +1,103 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <memory>
+#include "armor_pose.hpp"
+#include "CameraModel.h"
+
+namespace ArmorTracker{
+
+//跟踪器参数
+struct TrackerParams
+{
+    float gate_scale = 1.5f;//关联门限: 预测中心与检测中心的距离不超过 框对角线×gate_scale
+    float gate_min_px = 30.0f;//关联门限的下限(像素)
+    int max_misses = 5;//连续丢失超过该帧数则删除目标
+    double accel_noise = 4.0;//过程噪声: 加速度标准差(m/s^2)
+    double meas_noise_xy = 0.01;//观测噪声: 横向位置标准差(m)
+    double meas_noise_z_ratio = 0.02;//观测噪声: 深度标准差与距离的比例
+};
+
+//一个目标的对外结果
+struct TrackInfo
+{
+    int id = -1;//目标编号
+    int class_id = -1;//类别
+    int hits = 0;//累计关联次数
+    int misses = 0;//连续丢失帧数
+    bool has_state = false;//是否已经有3D状态(至少一次位姿解算成功)
+    cv::Vec3d position;//相机坐标系位置(m)
+    cv::Vec3d velocity;//相机坐标系速度(m/s)
+};
+
+/*
+    多目标装甲板跟踪
+    每帧先associate: 所有目标预测到本帧时刻,在像素平面上按门限关联检测,得到每个检测的目标编号
+    位姿解算后update: 用PnP的平移向量更新每个目标的匀速卡尔曼滤波(x y z三轴独立,每轴2维状态)
+    目标状态按固定容量的SoA存放,预测与更新只遍历活动目标
+*/
+class ArmorTracker
+{
+public:
+    static constexpr int CAPACITY = 16;//最多同时跟踪的目标数
+
+private:
+    //----------------SoA状态----------------
+    std::array<bool, CAPACITY> m_active{};//该槽位是否在用
+    std::array<int, CAPACITY> m_id{};//目标编号
+    std::array<int, CAPACITY> m_class_id{};//类别
+    std::array<int, CAPACITY> m_hits{};//累计关联次数
+    std::array<int, CAPACITY> m_misses{};//连续丢失帧数
+    std::array<bool, CAPACITY> m_has_state{};//是否有3D状态
+    std::array<double, CAPACITY> m_timestamp{};//状态对应的时刻(s)
+    std::array<double, CAPACITY> m_pos[3]{};//位置
+    std::array<double, CAPACITY> m_vel[3]{};//速度
+    std::array<double, CAPACITY> m_p00[3]{};//协方差 位置-位置
+    std::array<double, CAPACITY> m_p01[3]{};//协方差 位置-速度
+    std::array<double, CAPACITY> m_p11[3]{};//协方差 速度-速度
+    std::array<cv::Point2f, CAPACITY> m_center{};//上次关联到的像素中心
+    std::array<cv::Size2f, CAPACITY> m_box{};//上次关联到的框尺寸
+    std::array<float, CAPACITY> m_box_depth{};//框尺寸对应的深度,用于预测ROI时缩放
+
+    std::shared_ptr<const CameraModel> m_camera;//用于把3D预测投影到像素平面
+    TrackerParams m_params;
+    int m_next_id = 0;//下一个新目标的编号
+    int m_active_count = 0;//活动目标数
+    double m_last_timestamp = 0.0;//上一次associate的时刻
+
+    //关联用的临时数组,避免每帧分配
+    struct Candidate
+    {
+        float cost;
+        int slot;
+        int detection;
+    };
+    std::vector<Candidate> m_candidates;
+    std::vector<int> m_slot_of_detection;
+
+    void predict_slot(int slot, double timestamp);//把一个目标的状态预测到timestamp
+    void correct_slot(int slot, const cv::Vec3d &measurement);//用一次位置观测更新
+    cv::Point2f predicted_center(int slot) const;//当前状态在像素平面上的中心
+    int allocate_slot();//找一个空槽位,满了返回-1
+    void release_slot(int slot);
+
+public:
+    ArmorTracker(std::shared_ptr<const CameraModel> camera, const TrackerParams &params = TrackerParams());
+
+    //把检测关联到已有目标,track_ids与detections一一对应;未关联的检测创建新目标,容量满时为-1
+    //timestamp为本帧采集时刻(s)
+    void associate(const std::vector<YoloVino::NNDetectData> &detections, double timestamp, std::vector<int> &track_ids);
+
+    //用本帧的位姿更新目标,track_ids和poses与associate时的detections一一对应
+    void update(const std::vector<int> &track_ids, const std::vector<ArmorPose::ArmorPoseData> &poses);
+
+    //预测目标在(上一次associate时刻 + latency)秒的3D位置和像素ROI,目标不存在或没有3D状态时返回false
+    bool predict(int track_id, double latency, cv::Vec3d &position, cv::Rect &roi) const;
+
+    //当前全部活动目标
+    void get_tracks(std::vector<TrackInfo> &tracks) const;
+
+    int get_track_count() const { return m_active_count; }
+};
+
+} // namespace ArmorTracker
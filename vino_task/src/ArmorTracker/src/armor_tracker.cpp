@@ -0,0 +1,291 @@
+#include "armor_tracker.hpp"
+#include <algorithm>
+
+namespace ArmorTracker
+{
+
+    namespace
+    {
+        const double INITIAL_VEL_VAR = 4.0; // 新目标速度的初始方差((m/s)^2)
+
+        // 检测的中心: 取4个角点的中心
+        cv::Point2f detection_center(const YoloVino::NNDetectData &det)
+        {
+            cv::Point2f sum(0.0f, 0.0f);
+            for (const cv::Point3f &keypoint : det.keypoints)
+            {
+                sum += cv::Point2f(keypoint.x, keypoint.y);
+            }
+            return sum * (1.0f / det.keypoints.size());
+        }
+    } // namespace
+
+    ArmorTracker::ArmorTracker(std::shared_ptr<const CameraModel> camera, const TrackerParams &params)
+        : m_camera(std::move(camera)),
+          m_params(params)
+    {
+        m_candidates.reserve(CAPACITY * 8);
+    }
+
+    int ArmorTracker::allocate_slot()
+    {
+        for (int slot = 0; slot < CAPACITY; slot++)
+        {
+            if (!m_active[slot])
+            {
+                m_active[slot] = true;
+                m_active_count++;
+                return slot;
+            }
+        }
+        return -1;
+    }
+
+    void ArmorTracker::release_slot(int slot)
+    {
+        m_active[slot] = false;
+        m_active_count--;
+    }
+
+    void ArmorTracker::predict_slot(int slot, double timestamp)
+    {
+        const double dt = timestamp - m_timestamp[slot];
+        m_timestamp[slot] = timestamp;
+        if (!m_has_state[slot] || dt <= 0.0)
+        {
+            return;
+        }
+
+        // 匀速模型,加速度为白噪声
+        const double q = m_params.accel_noise * m_params.accel_noise;
+        const double dt2 = dt * dt;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            double &p00 = m_p00[axis][slot];
+            double &p01 = m_p01[axis][slot];
+            double &p11 = m_p11[axis][slot];
+            m_pos[axis][slot] += m_vel[axis][slot] * dt;
+            p00 += dt * (2.0 * p01 + dt * p11) + q * dt2 * dt2 * 0.25;
+            p01 += dt * p11 + q * dt2 * dt * 0.5;
+            p11 += q * dt2;
+        }
+    }
+
+    void ArmorTracker::correct_slot(int slot, const cv::Vec3d &measurement)
+    {
+        const double noise_z = m_params.meas_noise_z_ratio * measurement[2];
+        const double r[3] = {m_params.meas_noise_xy * m_params.meas_noise_xy,
+                             m_params.meas_noise_xy * m_params.meas_noise_xy,
+                             noise_z * noise_z};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            double &p00 = m_p00[axis][slot];
+            double &p01 = m_p01[axis][slot];
+            double &p11 = m_p11[axis][slot];
+            const double s = p00 + r[axis];
+            const double k0 = p00 / s;
+            const double k1 = p01 / s;
+            const double innovation = measurement[axis] - m_pos[axis][slot];
+            m_pos[axis][slot] += k0 * innovation;
+            m_vel[axis][slot] += k1 * innovation;
+            p11 -= k1 * p01;
+            p00 *= (1.0 - k0);
+            p01 *= (1.0 - k0);
+        }
+    }
+
+    cv::Point2f ArmorTracker::predicted_center(int slot) const
+    {
+        const double z = m_pos[2][slot];
+        if (!m_has_state[slot] || z <= 0.0)
+        {
+            return m_center[slot];
+        }
+        return m_camera->distort_point(cv::Point2f(m_pos[0][slot] / z, m_pos[1][slot] / z));
+    }
+
+    void ArmorTracker::associate(const std::vector<YoloVino::NNDetectData> &detections, double timestamp, std::vector<int> &track_ids)
+    {
+        m_last_timestamp = timestamp;
+        track_ids.assign(detections.size(), -1);
+        m_slot_of_detection.assign(detections.size(), -1);
+
+        // 所有目标预测到本帧
+        for (int slot = 0; slot < CAPACITY; slot++)
+        {
+            if (m_active[slot])
+            {
+                predict_slot(slot, timestamp);
+            }
+        }
+
+        // 门限内的(目标,检测)对,代价为归一化后的像素距离
+        m_candidates.clear();
+        for (int slot = 0; slot < CAPACITY; slot++)
+        {
+            if (!m_active[slot])
+            {
+                continue;
+            }
+            const cv::Point2f center = predicted_center(slot);
+            const cv::Size2f box = m_box[slot];
+            const float gate = std::max(m_params.gate_min_px, std::sqrt(box.width * box.width + box.height * box.height) * m_params.gate_scale);
+            for (size_t i = 0; i < detections.size(); i++)
+            {
+                if (detections[i].class_id != m_class_id[slot])
+                {
+                    continue;
+                }
+                const float distance = static_cast<float>(cv::norm(detection_center(detections[i]) - center));
+                if (distance < gate)
+                {
+                    m_candidates.push_back({distance / gate, slot, static_cast<int>(i)});
+                }
+            }
+        }
+
+        // 代价从小到大贪心分配,目标数很少,效果与匈牙利算法接近
+        std::sort(m_candidates.begin(), m_candidates.end(),
+                  [](const Candidate &a, const Candidate &b)
+                  { return a.cost < b.cost; });
+        std::array<bool, CAPACITY> slot_used{};
+        for (const Candidate &candidate : m_candidates)
+        {
+            if (slot_used[candidate.slot] || m_slot_of_detection[candidate.detection] >= 0)
+            {
+                continue;
+            }
+            slot_used[candidate.slot] = true;
+            m_slot_of_detection[candidate.detection] = candidate.slot;
+        }
+
+        // 没有关联上的目标累计丢失
+        for (int slot = 0; slot < CAPACITY; slot++)
+        {
+            if (m_active[slot] && !slot_used[slot] && ++m_misses[slot] > m_params.max_misses)
+            {
+                release_slot(slot);
+            }
+        }
+
+        for (size_t i = 0; i < detections.size(); i++)
+        {
+            const YoloVino::NNDetectData &det = detections[i];
+            int slot = m_slot_of_detection[i];
+            if (slot < 0)
+            {
+                // 新目标
+                slot = allocate_slot();
+                if (slot < 0)
+                {
+                    continue;
+                }
+                m_id[slot] = m_next_id++;
+                m_class_id[slot] = det.class_id;
+                m_hits[slot] = 0;
+                m_has_state[slot] = false;
+                m_timestamp[slot] = timestamp;
+                m_slot_of_detection[i] = slot;
+            }
+
+            m_hits[slot]++;
+            m_misses[slot] = 0;
+            m_center[slot] = detection_center(det);
+            m_box[slot] = cv::Size2f(det.rect.width, det.rect.height);
+            track_ids[i] = m_id[slot];
+        }
+    }
+
+    void ArmorTracker::update(const std::vector<int> &track_ids, const std::vector<ArmorPose::ArmorPoseData> &poses)
+    {
+        const size_t count = std::min(track_ids.size(), poses.size());
+        for (size_t i = 0; i < count; i++)
+        {
+            // associate之后m_slot_of_detection与track_ids一一对应
+            const int slot = i < m_slot_of_detection.size() ? m_slot_of_detection[i] : -1;
+            if (slot < 0 || !m_active[slot] || m_id[slot] != track_ids[i] || !poses[i].valid)
+            {
+                continue;
+            }
+
+            const cv::Vec3d &tvec = poses[i].tvec;
+            if (!m_has_state[slot])
+            {
+                const double noise_z = m_params.meas_noise_z_ratio * tvec[2];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    m_pos[axis][slot] = tvec[axis];
+                    m_vel[axis][slot] = 0.0;
+                    m_p00[axis][slot] = axis == 2 ? noise_z * noise_z : m_params.meas_noise_xy * m_params.meas_noise_xy;
+                    m_p01[axis][slot] = 0.0;
+                    m_p11[axis][slot] = INITIAL_VEL_VAR;
+                }
+                m_has_state[slot] = true;
+            }
+            else
+            {
+                correct_slot(slot, tvec);
+            }
+            m_box_depth[slot] = static_cast<float>(tvec[2]);
+        }
+    }
+
+    bool ArmorTracker::predict(int track_id, double latency, cv::Vec3d &position, cv::Rect &roi) const
+    {
+        for (int slot = 0; slot < CAPACITY; slot++)
+        {
+            if (!m_active[slot] || m_id[slot] != track_id)
+            {
+                continue;
+            }
+            if (!m_has_state[slot])
+            {
+                return false;
+            }
+
+            const double dt = m_last_timestamp + latency - m_timestamp[slot];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                position[axis] = m_pos[axis][slot] + m_vel[axis][slot] * dt;
+            }
+            if (position[2] <= 0.0)
+            {
+                return false;
+            }
+
+            // 框尺寸按深度反比缩放
+            const cv::Point2f center = m_camera->distort_point(cv::Point2f(position[0] / position[2], position[1] / position[2]));
+            const float scale = m_box_depth[slot] > 0.0f ? static_cast<float>(m_box_depth[slot] / position[2]) : 1.0f;
+            const cv::Size2f box = m_box[slot] * scale;
+            roi = cv::Rect(cv::Point(cvRound(center.x - box.width * 0.5f), cvRound(center.y - box.height * 0.5f)),
+                           cv::Size(cvRound(box.width), cvRound(box.height)));
+            return true;
+        }
+        return false;
+    }
+
+    void ArmorTracker::get_tracks(std::vector<TrackInfo> &tracks) const
+    {
+        tracks.clear();
+        for (int slot = 0; slot < CAPACITY; slot++)
+        {
+            if (!m_active[slot])
+            {
+                continue;
+            }
+            TrackInfo info;
+            info.id = m_id[slot];
+            info.class_id = m_class_id[slot];
+            info.hits = m_hits[slot];
+            info.misses = m_misses[slot];
+            info.has_state = m_has_state[slot];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                info.position[axis] = m_pos[axis][slot];
+                info.velocity[axis] = m_vel[axis][slot];
+            }
+            tracks.push_back(info);
+        }
+    }
+
+} // namespace ArmorTracker
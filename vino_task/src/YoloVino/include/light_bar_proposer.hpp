@@ -0,0 +1,136 @@
+#pragma once
+#include "yolo_vino.hpp"
+#include <cstdint>
+#include <string>
+
+namespace YoloVino{
+
+//敌方灯条颜色
+enum class EnemyColor
+{
+    red = 0,
+    blue,
+    any,//红蓝都找(不区分敌我时使用)
+};
+
+//灯条候选区域的参数,可从yaml读取(未写的项使用默认值)
+struct LightBarConfig
+{
+    EnemyColor enemy_color = EnemyColor::any;//要找的灯条颜色
+    int min_value = 150;//灯条主通道(红/蓝)亮度下限
+    int min_diff = 60;//主通道比另一通道(蓝/红)高出的下限
+    int downscale = 4;//颜色掩码按该倍数做最大值池化后再找连通域,远处的细灯条不会丢失
+    int min_bar_height = 6;//灯条最小高度(原图像素)
+    float min_bar_aspect = 1.2f;//灯条外接框高/宽的下限(倾斜的灯条外接框较方)
+    float max_height_ratio = 2.0f;//一对灯条的高度比上限
+    float max_y_offset = 0.8f;//两灯条中心的竖直距离/平均高度的上限
+    float min_x_gap = 0.8f;//两灯条中心的水平距离/平均高度的下限
+    float max_x_gap = 5.5f;//同上的上限(小装甲板约2.4,大装甲板约4.2)
+    float roi_expand = 1.6f;//候选区域相对灯条对外接框(高度按装甲板取平均灯条高度的2.2倍)的放大倍数
+    int roi_min_size = 96;//候选区域的最小边长(原图像素)
+    int max_rois = 4;//每帧最多的候选区域数,更多时合并为一个外接区域
+    int full_frame_interval = 15;//每隔多少帧整帧推理一次,找回灯条被遮挡或过曝的目标,0为从不
+    bool full_frame_when_empty = false;//没有候选时是否整帧推理(否则跳过推理)
+
+    static LightBarConfig load(const std::string &yaml_path);
+};
+
+//一根灯条(原图坐标)
+struct LightBar
+{
+    cv::Rect box;//外接框
+    cv::Point2f center;//中心
+    EnemyColor color = EnemyColor::red;
+};
+
+//统计
+struct LightBarStats
+{
+    uint64_t frames = 0;//处理的帧数
+    uint64_t full_frames = 0;//整帧推理的帧数(周期性的和没有候选时的)
+    uint64_t empty_frames = 0;//没有候选、跳过推理的帧数
+    uint64_t bars = 0;//找到的灯条数
+    uint64_t rois = 0;//候选区域数(即候选区域上的推理次数)
+    uint64_t roi_pixels = 0;//推理覆盖的原图像素(整帧推理按整帧计)
+    uint64_t frame_pixels = 0;//每帧都整帧推理时覆盖的原图像素
+    uint64_t nn_pixels = 0;//网络输入像素(只由LightBarDetector::predict统计)
+    uint64_t full_nn_pixels = 0;//每帧都整帧推理时的网络输入像素(同上)
+    double propose_ms = 0.0;//找候选区域的累计耗时
+
+    void print() const;
+};
+
+/*
+    传统视觉前端: 在整帧上找红/蓝灯条对,生成紧凑的候选区域,网络只在候选区域上推理
+    颜色阈值是一次遍历的SIMD内核(Simd::color_mask_u8c3),按downscale做最大值池化后用连通域找灯条
+    候选区域之外的目标(灯条被遮挡、过曝)靠每full_frame_interval帧一次的整帧推理找回
+*/
+class LightBarProposer
+{
+private:
+    LightBarConfig m_config;
+    LightBarStats m_stats;
+    uint64_t m_frame_index = 0;
+    cv::Mat m_mask;//原图尺寸的颜色掩码
+    cv::Mat m_pooled;//池化后的掩码
+    cv::Mat m_labels, m_components, m_centroids;//连通域
+    std::vector<LightBar> m_bars;//本帧的灯条
+    std::vector<cv::Rect> m_rois;//select_roi使用
+
+    void find_bars(const cv::Mat &bgr, EnemyColor color);
+    void pair_bars(cv::Size image_size, std::vector<cv::Rect> &rois) const;
+
+public:
+    explicit LightBarProposer(const LightBarConfig &config = LightBarConfig());
+
+    //本帧是否按周期整帧推理(每帧调用一次,推进帧计数)
+    bool next_frame_is_full();
+
+    //找灯条对,候选区域(原图坐标,已合并重叠的区域)写入rois(先清空),返回候选数
+    int propose(const cv::Mat &bgr, std::vector<cv::Rect> &rois);
+
+    //流水线中每帧只推理一次时使用: 周期帧或没有候选且full_frame_when_empty时返回整帧,
+    //否则返回全部候选的外接区域; 没有候选时返回空区域(跳过推理)
+    cv::Rect select_roi(const cv::Mat &bgr);
+
+    //把区域合并为不重叠的区域,超过max_rois时合并为一个外接区域
+    void merge_rois(std::vector<cv::Rect> &rois) const;
+
+    const std::vector<LightBar> &get_bars() const { return m_bars; }
+    const LightBarConfig &get_config() const { return m_config; }
+
+    //运行时修改候选区域的放大倍数(自适应质量降级时使用),只能在调用propose的线程中修改
+    void set_roi_expand(float roi_expand) { m_config.roi_expand = std::max(1.0f, roi_expand); }
+
+    LightBarStats &stats() { return m_stats; }
+    const LightBarStats &get_stats() const { return m_stats; }
+    void reset_stats() { m_stats = LightBarStats(); }
+};
+
+//灯条候选区域 + 网络: 网络只在候选区域上推理,周期性整帧推理
+//网络没有打开dynamic_shape时每次推理都是完整的输入尺寸,这时候选区域合并为一个外接区域只推理一次
+class LightBarDetector
+{
+private:
+    YoloVino &m_net;
+    LightBarProposer m_proposer;
+    std::vector<cv::Rect> m_rois;
+    std::vector<NNDetectData> m_roi_results;//一个候选区域的结果
+    DetectWorkspace m_workspace;
+    uint64_t m_full_nn_pixels = 0;//最近一次整帧推理的网络输入像素
+
+public:
+    LightBarDetector(YoloVino &net, const LightBarConfig &config = LightBarConfig());
+
+    //检测一帧,结果写入detections(先清空)
+    void predict(const cv::Mat &ori_img, std::vector<NNDetectData> &detections);
+
+    LightBarProposer &proposer() { return m_proposer; }
+    const std::vector<cv::Rect> &get_rois() const { return m_rois; }//上一帧推理的区域(原图坐标),跳过推理的帧不更新
+    const LightBarStats &get_stats() const { return m_proposer.get_stats(); }
+
+    LightBarDetector(const LightBarDetector&) = delete;
+    LightBarDetector& operator=(const LightBarDetector&) = delete;
+};
+
+} // namespace YoloVino
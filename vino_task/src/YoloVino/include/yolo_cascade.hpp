@@ -0,0 +1,86 @@
+#pragma once
+#include "yolo_vino.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace YoloVino{
+
+//级联的触发条件和合并参数,可从yaml读取(未写的项使用默认值)
+struct CascadeConfig
+{
+    float refine_conf_below = 0.75f;//置信度低于该值的候选送第二级
+    int refine_height_below = 24;//框高度(像素)小于该值的候选(远处目标)送第二级,0为不按大小触发
+    float crop_expand = 2.5f;//裁剪区域相对候选框的放大倍数
+    int crop_min_size = 128;//裁剪区域的最小边长(像素)
+    int max_refine = 4;//每帧最多送第二级的候选数,按置信度从低到高选取
+    float merge_iou = 0.3f;//第二级结果与候选框的IoU达到该值时认为是同一目标
+    bool keep_unconfirmed = true;//第二级没有检出的候选是否保留第一级的结果
+    //两级模型的类别含义不同,第二级的类别按下标映射到第一级的类别(第二级类别 -> 第一级类别,-1为没有对应)
+    //替换候选时保留第一级的类别,只有新增目标需要映射; 为空或没有对应时不新增该目标
+    std::vector<int> refine_class_map;
+
+    static CascadeConfig load(const std::string &yaml_path);
+};
+
+//级联统计
+struct CascadeStats
+{
+    uint64_t frames = 0;//处理的帧数
+    uint64_t frames_refined = 0;//触发第二级的帧数
+    uint64_t proposals = 0;//第一级的候选数
+    uint64_t crops = 0;//第二级推理次数
+    uint64_t confirmed = 0;//第二级确认并替换的候选数
+    uint64_t unconfirmed = 0;//第二级没有检出的候选数
+    uint64_t added = 0;//第二级在裁剪区域内新检出的目标数
+    uint64_t unmapped = 0;//新检出但类别没有对应、没有加入的目标数
+    double proposal_ms = 0.0;//第一级累计耗时(只统计predict调用)
+    double refine_ms = 0.0;//第二级累计耗时
+
+    void print() const;
+};
+
+/*
+    两级级联: 小模型(v8pose 320)在整帧上给出候选,
+    置信度低或框很小(远处)的候选扩大成裁剪区域后交给大模型(v5fourpoint 640)重新检测,
+    大模型的框、关键点和置信度替换对应的候选(类别沿用第一级),其余候选原样保留
+    大模型建议打开dynamic_shape,裁剪区域较小时用小尺寸输入,第二级的耗时随裁剪区域大小变化
+*/
+class YoloCascade
+{
+private:
+    YoloVino &m_proposal;//第一级(整帧)
+    YoloVino &m_refiner;//第二级(裁剪区域)
+    CascadeConfig m_config;
+    CascadeStats m_stats;
+    std::vector<int> m_refine_order;//本帧需要精检的候选下标,复用避免分配
+    std::vector<uint8_t> m_matched;//候选是否已被第二级结果替换
+    std::vector<NNDetectData> m_refined;//一个裁剪区域的第二级结果
+    DetectWorkspace m_refine_workspace;//第二级的中间数据
+    DetectWorkspace m_proposal_workspace;//predict中第一级的中间数据
+
+    bool needs_refine(const NNDetectData &detection) const;
+    cv::Rect crop_around(const cv::Rect &rect, cv::Size image_size) const;
+    int map_class(int refine_class_id) const;//第二级类别对应的第一级类别,-1为没有对应
+
+public:
+    YoloCascade(YoloVino &proposal, YoloVino &refiner, const CascadeConfig &config = CascadeConfig());
+
+    //整帧: 第一级检测后精检,结果写入detections(先清空)
+    void predict(const cv::Mat &ori_img, std::vector<NNDetectData> &detections);
+
+    //对已有的第一级结果精检,原地替换/追加(流水线中第一级已经分阶段跑完时使用)
+    void refine(const cv::Mat &ori_img, std::vector<NNDetectData> &detections);
+
+    const CascadeConfig &get_config() const { return m_config; }
+
+    //运行时修改裁剪区域的放大倍数(自适应质量降级时使用),只能在调用refine的线程中修改
+    void set_crop_expand(float crop_expand) { m_config.crop_expand = std::max(1.0f, crop_expand); }
+    const CascadeStats &get_stats() const { return m_stats; }
+    void reset_stats() { m_stats = CascadeStats(); }
+
+    YoloCascade(const YoloCascade&) = delete;
+    YoloCascade& operator=(const YoloCascade&) = delete;
+};
+
+} // namespace YoloVino
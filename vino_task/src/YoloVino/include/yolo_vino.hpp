@@ -1,68 +1,33 @@
 #pragma once
 #include<openvino/openvino.hpp>
+#include <array>
+#include <atomic>
+#include <type_traits>
 #include <yaml-cpp/yaml.h>
 #include <opencv2/opencv.hpp>
+#include <future>
+#include <map>
+#include "yolo_vino_log.hpp"
 
 namespace YoloVino{
 
-//如果是v5fourpoint是没有框的
+//如果是v5fourpoint是没有框的(框为4个角点的外接矩形)
+//定长、可平凡拷贝,结果容器复用时不再为每个装甲板分配内存
 struct NNDetectData
 {
+    static constexpr int keypoint_count = 4;//角点数目
     int class_id = -1;//类别
     float confidence = 0.0f;//置信度
     cv::Rect rect; // 装甲板框
-    std::vector<cv::Point3f> keypoints;//角点
+    std::array<cv::Point3f, keypoint_count> keypoints;//角点(x,y,置信度)
 };
+static_assert(std::is_trivially_copyable<NNDetectData>::value, "NNDetectData需要可平凡拷贝");
 
-class YoloVino
-{
-protected:
-    std::mutex m_infer_mutex;//推理锁
-    ov::CompiledModel m_compiled_model;//推理模型
-    ov::InferRequest m_infer_request;//推理请求(流)
-    cv::Size m_output_shape;//模型的输出尺寸
-    int m_target_size;//网络输入的图片尺寸
-    int m_archors_num;//锚框数目
-    int m_channels_num;//通道数
-    float m_class_conf_thresh;//类别置信度阈值
-    float m_NMS_IOU_threshold;//nms的iou阈值
-
-protected:
-    YoloVino(
-        int target_size,//网络输入的图片尺寸
-        int archors_num,//锚框数目
-        int channels_num,//通道数
-        float class_conf_thresh,//类别置信度阈值
-        float NMS_IOU_threshold//nms的iou阈值
-    );
-
-    virtual void build_compiled_model() = 0;//构建完整的推理模型
-
-public:
-    //线程安全推理
-    virtual std::vector<NNDetectData> safe_predict(const cv::Mat &ori_img, cv::Rect roi) = 0;
-
-    //默认虚析构函数
-    virtual ~YoloVino() = default;
-
-    //禁止拷贝构造和拷贝赋值
-    YoloVino(const YoloVino&) = delete;
-    YoloVino& operator=(const YoloVino&) = delete;
-
-};
-
-enum LoggerInfoLevel 
-{
-    debug_info = 0,//只要需要输出就大于等于这个等级
-    basic_info,//正常处理中的提示信息
-    warning_info//一般不会出现的情况
-
-};
+class YoloVino;
 
 class YoloVinoLogger
 {
 private:
-    std::mutex m_log_mutex;
     const YoloVino * m_owner_ptr = nullptr;
     LoggerInfoLevel m_info_level =  warning_info;//默认只输出警告信息
     std::string m_yaml_path = "/home/xiaoyiming/task8/vino_task/src/YoloVino/config/yolov8pose_vino_config.yaml";//模型配置文件路径
@@ -72,10 +37,22 @@ private:
     std::string m_input_size;//模型的输入图像尺寸
     std::string m_output_size;//模型的输出尺寸
     std::string m_date;//修改该yaml的日期
+    bool m_dynamic_shape = false;//是否按roi尺寸选择网络输入尺寸(可选)
+    int m_bucket_min = 160;//动态输入尺寸的下限(可选)
+    int m_bucket_step = 32;//动态输入尺寸的步长(可选)
+    int m_profiling_frames = 0;//逐层性能统计的帧数,0为关闭(可选,环境变量YOLOVINO_PROFILE优先)
+    std::string m_profiling_report = "yolovino_profile.csv";//逐层性能统计的输出文件(可选)
+    int m_warmup_frames = 3;//就绪前用合成输入预热的推理次数(可选)
+    std::string m_cache_dir;//OpenVINO编译缓存目录,为空时不缓存(可选)
+    int m_inference_threads = 0;//OpenVINO推理线程数,0为插件默认(可选)
+    bool m_graph_nms = false;//是否把阈值、TopK和NMS接到网络图的末尾(可选)
+    int m_graph_nms_topk = 256;//图内NMS前按得分保留的锚框数(可选)
+    int m_graph_nms_max = 32;//图内NMS最多输出的目标数(可选)
     void init_config(const std::string yaml_path);//初始化参数
     
+    //格式化到定长记录后交给后台线程输出,不加锁也不产生系统调用
     template<typename... Args>
-    void log(const std::string &type, Args &&...args);
+    void log(LoggerInfoLevel info_level, Args &&...args);
 
 public:
     explicit YoloVinoLogger();
@@ -85,10 +62,23 @@ public:
     void print_yaml_info();
     const std::string& get_model_path() const { return m_model_path; }
     const std::string& get_device_type() const {return m_device_type; }
+    bool get_dynamic_shape() const { return m_dynamic_shape; }
+    int get_bucket_min() const { return m_bucket_min; }
+    int get_bucket_step() const { return m_bucket_step; }
+    int get_profiling_frames() const { return m_profiling_frames; }
+    const std::string& get_profiling_report() const { return m_profiling_report; }
+    int get_warmup_frames() const { return m_warmup_frames; }
+    const std::string& get_cache_dir() const { return m_cache_dir; }
+    int get_inference_threads() const { return m_inference_threads; }
+    bool get_graph_nms() const { return m_graph_nms; }
+    int get_graph_nms_topk() const { return m_graph_nms_topk; }
+    int get_graph_nms_max() const { return m_graph_nms_max; }
+    void set_graph_nms(bool graph_nms) { m_graph_nms = graph_nms; }//在构造检测器之前调用(基准测试对比两种后处理时使用)
     void set_owner(const YoloVino* owner_ptr) { m_owner_ptr = owner_ptr; }
 
-    template<typename... Args>
-    void YVL_LOG(const YoloVino* user_ptr, LoggerInfoLevel info_level, Args&&... args);
+    //等级低于YVL_COMPILE_LEVEL的调用在编译期被移除
+    template<LoggerInfoLevel info_level, typename... Args>
+    void YVL_LOG(const YoloVino* user_ptr, Args&&... args);
 
     // 禁止拷贝
     YoloVinoLogger(const YoloVinoLogger&) = delete;
@@ -96,16 +86,223 @@ public:
 
 };
 
-class Yolov8poseVino : public YoloVino
+//某一输入尺寸下编译好的推理模型
+struct InferBucket
 {
-private:
+    cv::Size input_size;//网络输入的图片尺寸(宽,高)
+    cv::Size output_shape;//模型的输出尺寸,锚框数目随输入尺寸变化
+    ov::CompiledModel compiled_model;//推理模型
+    ov::InferRequest infer_request;//推理请求(流)
+    std::vector<std::pair<const void*, ov::Tensor>> input_tensors;//按输入缓冲区地址缓存的输入张量,避免每帧创建
+    bool graph_nms = false;//网络图末尾接了阈值和NMS,输出只有NMS保留的锚框(锚框数每帧不同),不再做NMS
+    bool roi_limit_input = false;//图内NMS模型有第二个输入: letterbox有效区域的右下边界(x,y),由bind_inputs每帧写入
+    bool profiling = false;//编译时打开了逐层性能统计(每次推理都有额外开销),统计完成后在推理锁内换成不带统计的compiled_model和infer_request
+};
+
+//图内后处理的输入,由各模型从原始输出构造
+struct GraphNmsInputs
+{
+    ov::Output<ov::Node> rows;//按锚框排列的原始输出[1,锚框,通道]
+    ov::Output<ov::Node> boxes;//NMS使用的框[1,锚框,4]
+    ov::Output<ov::Node> scores;//NMS使用的得分[1,锚框],不满足解码条件的锚框为0
+    bool center_boxes = false;//框为(cx,cy,w,h),否则为两个对角点
+    bool channels_first = false;//原始输出为(通道 x 锚框),压缩后的输出转回同样的排列
+};
+
+//letterbox的结果,用于把网络输出还原到原图
+struct LetterboxInfo
+{
+    cv::Rect final_roi;//落在原图内的roi
+    float scale = 1.0f;//缩放系数
+    int pad_x = 0;//左侧填充
+    int pad_y = 0;//上方填充
+    InferBucket *bucket = nullptr;//本次推理使用的模型
+};
+
+//解码后、NMS前的候选(坐标在roi内),每个候选对应4个关键点
+struct DecodeCandidates
+{
+    std::vector<int> class_ids;//类别容器
+    std::vector<cv::Rect> rects;//rect容器
+    std::vector<float> confs;//conf容器
+    std::vector<cv::Point3f> keypoints;//keypoints容器
+    bool empty() const { return class_ids.empty(); }
+    void clear() { class_ids.clear(); rects.clear(); confs.clear(); keypoints.clear(); }
+};
+
+//NMS的缓冲区
+struct NmsScratch
+{
+    std::vector<int> order;//按置信度排序后的下标
+    std::vector<float> coords;//排序后的框(x1,y1,x2,y2,面积各一段)
+    std::vector<uint8_t> suppressed;//是否被抑制
+};
+
+//一次检测的全部中间数据,由调用者持有并在帧之间复用,容量稳定后不再分配内存
+//同一个工作区同一时间只能被一个线程使用
+struct DetectWorkspace
+{
+    cv::Mat final_img;//网络输入
+    LetterboxInfo info;//letterbox参数
+    cv::Mat output;//网络输出
+    DecodeCandidates candidates;//解码候选
+    std::vector<int> indices;//NMS保留的下标
+    NmsScratch nms;//NMS缓冲区
+};
+
+//逐层性能统计: 某一层在多帧内的累计耗时
+struct LayerProfile
+{
+    std::string node_type;//层的类型(Convolution, Multiply...)
+    std::string exec_type;//实际执行的实现与精度(jit_avx2_FP32, ref_any_I8...)
+    double real_us = 0.0;//累计墙钟时间
+    double cpu_us = 0.0;//累计cpu时间
+    int64_t count = 0;//执行次数
+};
+
+class YoloVino
+{
+protected:
+    std::mutex m_infer_mutex;//推理锁
     std::unique_ptr<YoloVinoLogger> m_logger_ptr;//日志记录器,记录了模型的基础信息
+    ov::Core m_core;//openvino核心,需要在编译新尺寸时复用
+    std::shared_ptr<ov::Model> m_model;//读取的原始模型
+    std::map<std::pair<int, int>, InferBucket> m_buckets;//按(宽,高)缓存的推理模型
+    InferBucket *m_default_bucket = nullptr;//m_target_size x m_target_size的推理模型
+    int m_target_size;//网络输入的最大图片尺寸
+    float m_class_conf_thresh;//类别置信度阈值
+    float m_NMS_IOU_threshold;//nms的iou阈值
+    std::atomic<bool> m_dynamic_shape{false};//是否按roi尺寸选择输入尺寸,编译失败时由编译线程关闭
+    int m_bucket_min;//动态输入尺寸的下限
+    int m_bucket_step;//动态输入尺寸的步长
+    std::atomic<int> m_input_limit{0};//动态尺寸下网络输入边长的运行时上限,0为不限(自适应质量降级时使用)
+    std::future<void> m_compile_future;//后台编译新尺寸的任务,同一时间只有一个
+    int m_profiling_frames = 0;//还需要统计的帧数,0为关闭
+    std::atomic<bool> m_profiling_compile{false};//新编译的模型是否打开逐层性能统计,统计完成后关闭(后台编译线程也会读)
+    std::map<std::pair<int, int>, InferBucket> m_unprofiled_buckets;//统计完成后重新编译的不带统计的模型,推理时换入
+    std::future<void> m_unprofile_future;//后台重新编译不带统计的模型的任务
+    int m_profiled_frames = 0;//已经统计的帧数
+    std::map<std::string, LayerProfile> m_layer_profiles;//按层名累计的耗时
+    int m_warmup_frames = 0;//预热的推理次数
+    std::atomic<bool> m_graph_nms{false};//是否在网络图内做阈值和NMS,图编辑失败时由编译线程(可能是后台编译)关闭
+
+protected:
+    YoloVino(
+        std::unique_ptr<YoloVinoLogger> &&logger_ptr,//日志记录器
+        int target_size,//网络输入的图片尺寸
+        float class_conf_thresh,//类别置信度阈值
+        float NMS_IOU_threshold//nms的iou阈值
+    );
+
+    virtual void build_compiled_model() = 0;//构建完整的推理模型
+
+    void build_default_bucket();//读取模型并编译默认尺寸的推理模型
+    InferBucket compile_bucket(cv::Size input_size, const ov::AnyMap &properties = ov::AnyMap());//编译指定输入尺寸的推理模型
+    InferBucket &select_bucket(cv::Size view_size);//选择已编译的能装下view_size的最小尺寸,没有对应尺寸时交给后台编译,需要持有推理锁
+    InferBucket &compile_and_cache(std::pair<int, int> key);//同步编译并缓存,需要持有推理锁
+    void compile_in_background(std::pair<int, int> key);//在后台编译并缓存,需要持有推理锁
+    void wait_background_compile();//等待后台编译结束,派生类析构时调用(编译中会调用虚函数)
+    std::pair<int, int> bucket_key(cv::Size view_size) const;//view_size向上取整到步长后的尺寸
+
+    //从原始输出(ppp之后)构造图内NMS的框和得分,得分的条件与decode一致
+    //roi_limit为[2]的输入(letterbox有效区域的右下边界x,y,网络输入坐标),decode中按roi范围丢弃的条件需要在NMS之前用它判断
+    virtual GraphNmsInputs graph_nms_inputs(const ov::Output<ov::Node> &output, const ov::Output<ov::Node> &roi_limit) = 0;
+
+    //在模型末尾接上TopK和NMS,输出只保留NMS选中的锚框,排列与原始输出相同,因此decode不变
+    std::shared_ptr<ov::Model> append_graph_nms(const std::shared_ptr<ov::Model> &model);
+
+    void collect_profiling(ov::InferRequest &infer_request);//累计一帧的逐层耗时,需要持有推理锁
+    void recompile_unprofiled();//统计完成后在后台重新编译不带统计的模型,需要持有推理锁
+    void swap_unprofiled(InferBucket &bucket);//换入重新编译好的不带统计的模型,需要持有推理锁
+    void write_profiling_report();//输出逐层和按类型汇总的耗时报告
+
+    //把第index个候选的关键点加上roi偏移写入result,返回false表示丢弃该候选
+    virtual bool make_keypoints(const DecodeCandidates &candidates, int index, const LetterboxInfo &info, const cv::Rect &ori_img_bound, NNDetectData &result) = 0;
+
+public:
+    //线程安全推理: letterbox -> infer -> decode -> nms
+    virtual std::vector<NNDetectData> safe_predict(const cv::Mat &ori_img, cv::Rect roi);
+
+    //同上,结果写入调用者的results(先清空),中间数据放在workspace; 两者在帧之间复用时稳态下不分配内存
+    void safe_predict(const cv::Mat &ori_img, cv::Rect roi, std::vector<NNDetectData> &results, DetectWorkspace &workspace);
+
+    //以下各阶段单独公开,便于基准测试和离线工具使用
+
+    //裁剪roi,等比缩放并填充到所选尺寸,失败返回false
+    bool letterbox(const cv::Mat &ori_img, cv::Rect roi, cv::Mat &final_img, LetterboxInfo &info);
+
+    //同步推理,返回输出矩阵的拷贝
+    cv::Mat infer(const cv::Mat &final_img, const LetterboxInfo &info);
+
+    //同步推理,输出拷贝到output(尺寸不变时复用其内存)
+    void infer(const cv::Mat &final_img, const LetterboxInfo &info, cv::Mat &output);
+
+    //把letterbox后的图像张量(以及图内NMS需要的有效区域)绑定到推理请求
+    static void bind_inputs(const InferBucket &bucket, ov::InferRequest &infer_request, const ov::Tensor &image, const LetterboxInfo &info);
+
+    //推理请求输出张量上的矩阵头(不拷贝),图内NMS时按本次输出的锚框数; 没有锚框时返回空矩阵
+    static cv::Mat output_view(const InferBucket &bucket, ov::InferRequest &infer_request);
+
+    //把输出矩阵解码成候选,追加到candidates
+    virtual void decode(const cv::Mat &output, const LetterboxInfo &info, DecodeCandidates &candidates) = 0;
+
+    //用合成输入(随机噪声)推理iterations次,让内核、缓存和线程池进入稳态; iterations<0时使用配置文件的warmup_frames
+    //预热不计入阶段耗时和逐层统计; 动态尺寸下只预热默认尺寸
+    void warm_up(int iterations = -1);
+
+    //网络输入的最大图片尺寸
+    int get_target_size() const { return m_target_size; }
+
+    //是否按roi尺寸选择输入尺寸(否则每次推理都是target_size x target_size)
+    bool is_dynamic_shape() const { return m_dynamic_shape.load(std::memory_order_relaxed); }
+
+    //是否在网络图内做阈值和NMS(图编辑失败时会退回C++后处理)
+    bool is_graph_nms() const { return m_graph_nms.load(std::memory_order_relaxed); }
+
+    //动态尺寸下把网络输入的最长边限制为limit(取步长的倍数),0为恢复target_size; 固定尺寸时不起作用
+    //可以在letterbox的同时从其他线程调用,下一次letterbox生效
+    void set_input_limit(int limit);
+
+    //为frame_size的整帧同步编译limit对应的输入尺寸,第一次降级时直接使用该尺寸,不必等后台编译
+    void prepare_input_limit(int limit, cv::Size frame_size);
+
+    //之后letterbox总是使用默认尺寸(离线吞吐模式中所有帧共用一份吞吐模型)
+    void disable_dynamic_shape() { m_dynamic_shape.store(false, std::memory_order_relaxed); }
+
+    //用THROUGHPUT性能提示另外编译一份默认尺寸的模型,与实时推理的模型互不影响
+    //返回的bucket带一个推理请求,需要并行时由调用者用compiled_model创建更多的请求,这些请求不经过推理锁
+    InferBucket compile_throughput_bucket();
+
+    //非极大值抑制,缓冲区使用每个线程一份的scratch
+    void nms(const DecodeCandidates &candidates, std::vector<int> &indices);
+    void nms(const DecodeCandidates &candidates, std::vector<int> &indices, NmsScratch &scratch);
+
+    //后处理: decode -> nms -> 还原到原图坐标,ori_img_size为letterbox时原图的尺寸; 图内NMS的输出跳过nms
+    std::vector<NNDetectData> postprocess(const cv::Mat &output, const LetterboxInfo &info, cv::Size ori_img_size);
+
+    //同上,结果写入results(先清空),候选和NMS缓冲区使用workspace
+    void postprocess(const cv::Mat &output, const LetterboxInfo &info, cv::Size ori_img_size,
+                     std::vector<NNDetectData> &results, DetectWorkspace &workspace);
+
+    //默认虚析构函数
+    virtual ~YoloVino() = default;
+
+    //禁止拷贝构造和拷贝赋值
+    YoloVino(const YoloVino&) = delete;
+    YoloVino& operator=(const YoloVino&) = delete;
+
+};
+
+class Yolov8poseVino : public YoloVino
+{
 protected:
     void build_compiled_model() override;//构建推理模型
+    GraphNmsInputs graph_nms_inputs(const ov::Output<ov::Node> &output, const ov::Output<ov::Node> &roi_limit) override;
+    bool make_keypoints(const DecodeCandidates &candidates, int index, const LetterboxInfo &info, const cv::Rect &ori_img_bound, NNDetectData &result) override;
 public:
     explicit Yolov8poseVino(std::unique_ptr<YoloVinoLogger> &&logger_ptr);
-    std::vector<NNDetectData> safe_predict(const cv::Mat &ori_img, cv::Rect roi) override ;
-    ~Yolov8poseVino() = default;
+    void decode(const cv::Mat &output, const LetterboxInfo &info, DecodeCandidates &candidates) override;
+    ~Yolov8poseVino() { wait_background_compile(); }
 
 };
 
@@ -113,57 +310,60 @@ class Yolov5fourpointVino : public YoloVino
 {
 private:
     float m_box_conf_thresh = 0.65;//先验框的置信度阈值
-    std::unique_ptr<YoloVinoLogger> m_logger_ptr;//日志记录器,记录了模型的基础信息
 protected:
     inline float sigmoid(float x);//激活函数
     void build_compiled_model() override;//构建推理模型
+    GraphNmsInputs graph_nms_inputs(const ov::Output<ov::Node> &output, const ov::Output<ov::Node> &roi_limit) override;
+    bool make_keypoints(const DecodeCandidates &candidates, int index, const LetterboxInfo &info, const cv::Rect &ori_img_bound, NNDetectData &result) override;
 public:
     explicit Yolov5fourpointVino(std::unique_ptr<YoloVinoLogger> &&logger_ptr);
-    std::vector<NNDetectData> safe_predict(const cv::Mat &ori_img, cv::Rect roi) override ;
-    ~Yolov5fourpointVino() = default;
+    void decode(const cv::Mat &output, const LetterboxInfo &info, DecodeCandidates &candidates) override;
+    ~Yolov5fourpointVino() { wait_background_compile(); }
 
 };
 
+//在后台线程构造检测器(读取+编译模型)并预热,future就绪后可以直接推理
+//每次调用一个线程,多个模型同时编译; 构造或预热失败时异常在get()时抛出
+template <typename Detector>
+std::future<std::unique_ptr<Detector>> load_async(std::unique_ptr<YoloVinoLogger> &&logger_ptr, int warmup_iterations = -1)
+{
+    return std::async(std::launch::async, [logger = std::move(logger_ptr), warmup_iterations]() mutable
+    {
+        auto detector = std::make_unique<Detector>(std::move(logger));
+        detector->warm_up(warmup_iterations);
+        return detector;
+    });
+}
+
 template <typename... Args>
-inline void YoloVinoLogger::log(const std::string &type, Args &&...args)
+inline void YoloVinoLogger::log(LoggerInfoLevel info_level, Args &&...args)
 {   
-    std::lock_guard<std::mutex> lock(m_log_mutex);
-    std::cout << type;
-    (std::cout << ... << args);
-    std::cout << std::endl;
+    LogRecord record;
+    record.level = info_level;
+    (log_append(record, args), ...);
+    LogSink::instance().submit(record);
 }
 
-template <typename... Args>
-inline void YoloVinoLogger::YVL_LOG(const YoloVino * user_ptr, LoggerInfoLevel info_level, Args &&...args)
+template <LoggerInfoLevel info_level, typename... Args>
+inline void YoloVinoLogger::YVL_LOG(const YoloVino * user_ptr, Args &&...args)
 {   
-    if (user_ptr != m_owner_ptr)
-    {   
-        log("NN_WARNING","调用值者错误");
+    if constexpr (info_level < YVL_COMPILE_LEVEL)
+    {
+        (void)user_ptr;
         return;
     }
-    
-
-    if (info_level >= m_info_level)
-    {   
-        std::string type;
-
-        if (info_level == LoggerInfoLevel::debug_info)
-        {
-            type = "[NN_DEBUG]";
-        }
-        else if (info_level == LoggerInfoLevel::basic_info)
-        {
-            type = "[NN_INFO]";
-        }
-        else if (info_level == LoggerInfoLevel::warning_info)
-        {
-            type = "[NN_WARNING]";
-        }
-        else//错误的类型
-        {
+    else
+    {
+        if (user_ptr != m_owner_ptr)
+        {   
+            log(LoggerInfoLevel::warning_info, "调用值者错误");
             return;
         }
-        log(std::move(type),std::forward<Args>(args)...);
+
+        if (info_level >= m_info_level)
+        {   
+            log(info_level, std::forward<Args>(args)...);
+        }
     }
 }
 
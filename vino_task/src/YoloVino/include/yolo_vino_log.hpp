@@ -0,0 +1,171 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//编译期日志等级下限,低于该等级的YVL_LOG不会生成任何代码(0 debug, 1 info, 2 warning, 3 全部关闭)
+#ifndef YVL_COMPILE_LEVEL
+#define YVL_COMPILE_LEVEL 0
+#endif
+
+namespace YoloVino{
+
+enum LoggerInfoLevel
+{
+    debug_info = 0,//只要需要输出就大于等于这个等级
+    basic_info,//正常处理中的提示信息
+    warning_info//一般不会出现的情况
+
+};
+
+//一条日志,定长以便在环形缓冲中无分配地传递
+struct LogRecord
+{
+    LoggerInfoLevel level = debug_info;//日志等级
+    uint32_t repeated = 0;//在这条之前被限流省略的重复日志条数
+    uint16_t length = 0;//text中的有效字节数
+    char text[244];//已格式化的内容,不以'\0'结尾
+};
+
+//单生产者单消费者无锁环形缓冲: 生产者是记录日志的线程, 消费者是后台输出线程
+class LogRing
+{
+public:
+    static constexpr size_t capacity = 256;//必须是2的幂
+
+    //满了直接丢弃,绝不等待
+    bool try_push(const LogRecord &record)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= capacity)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_records[tail & (capacity - 1)] = record;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(LogRecord &record)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        record = m_records[head & (capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t take_dropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+
+    std::atomic<bool> orphaned{false};//所属线程已经退出,清空后即可回收
+
+private:
+    std::array<LogRecord, capacity> m_records;
+    alignas(64) std::atomic<size_t> m_head{0};//消费位置
+    alignas(64) std::atomic<size_t> m_tail{0};//生产位置
+    alignas(64) std::atomic<uint64_t> m_dropped{0};//缓冲满而丢弃的条数
+};
+
+//进程内唯一的日志输出端: 每个线程一个LogRing, 由后台线程统一格式化并写出
+class LogSink
+{
+public:
+    static LogSink &instance();
+
+    //记录线程调用: 限流后放入本线程的缓冲,不加锁也不产生系统调用
+    void submit(LogRecord &record);
+
+    //相同内容的日志在该时间窗内只输出一次
+    void set_rate_limit(std::chrono::milliseconds window) { m_rate_limit_ns.store(std::chrono::nanoseconds(window).count(), std::memory_order_relaxed); }
+
+    //立即写出所有缓冲中的日志(由后台线程以外的线程调用时会短暂加锁)
+    void flush();
+
+    LogSink(const LogSink &) = delete;
+    LogSink &operator=(const LogSink &) = delete;
+
+private:
+    //线程私有状态,线程退出时把缓冲标记为可回收
+    struct ThreadState
+    {
+        std::shared_ptr<LogRing> ring;
+        uint64_t last_hash = 0;//上一条日志内容的hash
+        int64_t last_ns = 0;//上一条日志真正写入的时间
+        uint32_t suppressed = 0;//被限流的重复条数
+        ~ThreadState();
+    };
+
+    LogSink();
+    ~LogSink();
+    ThreadState &thread_state();
+    void run();
+    void drain(std::string &out);
+
+    std::mutex m_rings_mutex;//只在线程第一次记录日志时以及后台线程取缓冲列表时使用
+    std::vector<std::shared_ptr<LogRing>> m_rings;
+    std::mutex m_drain_mutex;//保证同一时间只有一个消费者
+    std::atomic<int64_t> m_rate_limit_ns{1000000000};//默认1s
+    std::atomic<bool> m_running{true};
+    std::thread m_worker;
+};
+
+//把参数追加到日志记录,超出长度的部分截断
+template <typename T>
+inline void log_append(LogRecord &record, const T &arg)
+{
+    using U = std::decay_t<T>;
+    char *dst = record.text + record.length;
+    const size_t room = sizeof(record.text) - record.length;
+    if (room == 0)
+    {
+        return;
+    }
+
+    if constexpr (std::is_same_v<U, char>)
+    {
+        *dst = arg;
+        record.length += 1;
+    }
+    else if constexpr (std::is_same_v<U, bool>)
+    {
+        log_append(record, arg ? "true" : "false");
+    }
+    else if constexpr (std::is_integral_v<U> || std::is_enum_v<U>)
+    {
+        auto value = static_cast<long long>(arg);
+        std::to_chars_result res = std::to_chars(dst, dst + room, value);
+        if (res.ec == std::errc())
+        {
+            record.length = static_cast<uint16_t>(res.ptr - record.text);
+        }
+    }
+    else if constexpr (std::is_floating_point_v<U>)
+    {
+        char number[32];
+        int n = std::snprintf(number, sizeof(number), "%g", static_cast<double>(arg));
+        log_append(record, std::string_view(number, n > 0 ? static_cast<size_t>(n) : 0));
+    }
+    else
+    {
+        std::string_view text(arg);
+        const size_t n = std::min(room, text.size());
+        std::memcpy(dst, text.data(), n);
+        record.length += static_cast<uint16_t>(n);
+    }
+}
+
+} // namespace YoloVino
@@ -0,0 +1,394 @@
+#include "light_bar_proposer.hpp"
+#include "SimdKernels.h"
+#include "StageProfiler.h"
+#include <yaml-cpp/yaml.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace YoloVino
+{
+
+    namespace
+    {
+        //每帧最多参与配对的灯条数(按高度取最大的)
+        constexpr size_t max_bars = 64;
+
+        //装甲板高度约为灯条长度的2.2倍(包含上下的数字贴纸)
+        constexpr float armor_height_per_bar = 2.2f;
+
+        double elapsed_ms(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    } // namespace
+
+    LightBarConfig LightBarConfig::load(const std::string &yaml_path)
+    {
+        LightBarConfig config;
+        YAML::Node node = YAML::LoadFile(yaml_path);
+
+        // 都是可选参数,没有写就使用默认值
+        if (node["enemy_color"])
+        {
+            const std::string color = node["enemy_color"].as<std::string>();
+            config.enemy_color = color == "red" ? EnemyColor::red : color == "blue" ? EnemyColor::blue : EnemyColor::any;
+        }
+        if (node["min_value"])
+        {
+            config.min_value = std::min(255, std::max(0, node["min_value"].as<int>()));
+        }
+        if (node["min_diff"])
+        {
+            config.min_diff = std::min(255, std::max(0, node["min_diff"].as<int>()));
+        }
+        if (node["downscale"])
+        {
+            config.downscale = std::max(1, node["downscale"].as<int>());
+        }
+        if (node["min_bar_height"])
+        {
+            config.min_bar_height = node["min_bar_height"].as<int>();
+        }
+        if (node["min_bar_aspect"])
+        {
+            config.min_bar_aspect = node["min_bar_aspect"].as<float>();
+        }
+        if (node["max_height_ratio"])
+        {
+            config.max_height_ratio = node["max_height_ratio"].as<float>();
+        }
+        if (node["max_y_offset"])
+        {
+            config.max_y_offset = node["max_y_offset"].as<float>();
+        }
+        if (node["min_x_gap"])
+        {
+            config.min_x_gap = node["min_x_gap"].as<float>();
+        }
+        if (node["max_x_gap"])
+        {
+            config.max_x_gap = node["max_x_gap"].as<float>();
+        }
+        if (node["roi_expand"])
+        {
+            config.roi_expand = std::max(1.0f, node["roi_expand"].as<float>());
+        }
+        if (node["roi_min_size"])
+        {
+            config.roi_min_size = node["roi_min_size"].as<int>();
+        }
+        if (node["max_rois"])
+        {
+            config.max_rois = std::max(1, node["max_rois"].as<int>());
+        }
+        if (node["full_frame_interval"])
+        {
+            config.full_frame_interval = std::max(0, node["full_frame_interval"].as<int>());
+        }
+        if (node["full_frame_when_empty"])
+        {
+            config.full_frame_when_empty = node["full_frame_when_empty"].as<bool>();
+        }
+        return config;
+    }
+
+    void LightBarStats::print() const
+    {
+        const double frame_count = frames > 0 ? static_cast<double>(frames) : 1.0;
+        std::printf("========== 灯条候选区域统计 ==========\n");
+        std::printf("帧数 %llu, 整帧推理 %llu, 无候选跳过 %llu\n", static_cast<unsigned long long>(frames),
+                    static_cast<unsigned long long>(full_frames), static_cast<unsigned long long>(empty_frames));
+        std::printf("灯条 %.2f 根/帧, 候选区域 %.2f 个/帧, 找候选平均 %.3f ms/帧\n", bars / frame_count, rois / frame_count,
+                    propose_ms / frame_count);
+        if (frame_pixels > 0)
+        {
+            std::printf("推理覆盖的原图像素: 整帧的 %.1f%%\n", 100.0 * roi_pixels / frame_pixels);
+        }
+        if (full_nn_pixels > 0)
+        {
+            std::printf("网络输入像素: 整帧推理的 %.1f%%\n", 100.0 * nn_pixels / full_nn_pixels);
+        }
+        std::printf("=====================================\n");
+    }
+
+    LightBarProposer::LightBarProposer(const LightBarConfig &config)
+        : m_config(config)
+    {
+    }
+
+    bool LightBarProposer::next_frame_is_full()
+    {
+        m_stats.frames++;
+        const bool full = m_config.full_frame_interval > 0 && m_frame_index % m_config.full_frame_interval == 0;
+        m_frame_index++;
+        if (full)
+        {
+            m_stats.full_frames++;
+        }
+        return full;
+    }
+
+    void LightBarProposer::find_bars(const cv::Mat &bgr, EnemyColor color)
+    {
+        // 颜色阈值: 红灯条R明显高于B,蓝灯条反之(BGR顺序)
+        const int primary = color == EnemyColor::red ? 2 : 0;
+        const int secondary = 2 - primary;
+        const Simd::Kernels &kernels = Simd::kernels();
+        m_mask.create(bgr.size(), CV_8U);
+        if (bgr.isContinuous() && m_mask.isContinuous())
+        {
+            kernels.color_mask_u8c3(bgr.data, bgr.total(), primary, secondary, static_cast<uint8_t>(m_config.min_value),
+                                    static_cast<uint8_t>(m_config.min_diff), m_mask.data);
+        }
+        else
+        {
+            for (int row = 0; row < bgr.rows; row++)
+            {
+                kernels.color_mask_u8c3(bgr.ptr<uint8_t>(row), bgr.cols, primary, secondary, static_cast<uint8_t>(m_config.min_value),
+                                        static_cast<uint8_t>(m_config.min_diff), m_mask.ptr<uint8_t>(row));
+            }
+        }
+
+        // 最大值池化: 区域平均后非0即块内有灯条像素,宽1~2像素的远处灯条也能保留
+        const int ds = m_config.downscale;
+        if (ds > 1)
+        {
+            cv::resize(m_mask, m_pooled, cv::Size(bgr.cols / ds, bgr.rows / ds), 0, 0, cv::INTER_AREA);
+            cv::threshold(m_pooled, m_pooled, 0, 255, cv::THRESH_BINARY);
+        }
+        else
+        {
+            m_pooled = m_mask;
+        }
+
+        const int count = cv::connectedComponentsWithStats(m_pooled, m_labels, m_components, m_centroids, 8, CV_32S);
+        const size_t first = m_bars.size();
+        for (int label = 1; label < count; label++)
+        {
+            const int *stat = m_components.ptr<int>(label);
+            const int width = stat[cv::CC_STAT_WIDTH];
+            const int height = stat[cv::CC_STAT_HEIGHT];
+            if (height * ds < m_config.min_bar_height || height < m_config.min_bar_aspect * width)
+            {
+                continue;
+            }
+            LightBar bar;
+            bar.box = cv::Rect(stat[cv::CC_STAT_LEFT] * ds, stat[cv::CC_STAT_TOP] * ds, width * ds, height * ds);
+            const double *centroid = m_centroids.ptr<double>(label);
+            bar.center = cv::Point2f(static_cast<float>((centroid[0] + 0.5) * ds), static_cast<float>((centroid[1] + 0.5) * ds));
+            bar.color = color;
+            m_bars.push_back(bar);
+        }
+
+        // 灯条太多(画面中大片同色区域)时只保留最高的几根
+        if (m_bars.size() - first > max_bars)
+        {
+            std::partial_sort(m_bars.begin() + first, m_bars.begin() + first + max_bars, m_bars.end(),
+                              [](const LightBar &a, const LightBar &b)
+                              { return a.box.height > b.box.height; });
+            m_bars.resize(first + max_bars);
+        }
+    }
+
+    void LightBarProposer::pair_bars(cv::Size image_size, std::vector<cv::Rect> &rois) const
+    {
+        const cv::Rect image_bound(0, 0, image_size.width, image_size.height);
+        for (size_t i = 0; i < m_bars.size(); i++)
+        {
+            for (size_t j = i + 1; j < m_bars.size(); j++)
+            {
+                const LightBar &a = m_bars[i];
+                const LightBar &b = m_bars[j];
+                if (a.color != b.color)
+                {
+                    continue;
+                }
+                const float ha = static_cast<float>(a.box.height);
+                const float hb = static_cast<float>(b.box.height);
+                const float mean_height = (ha + hb) * 0.5f;
+                const float dx = std::abs(a.center.x - b.center.x);
+                const float dy = std::abs(a.center.y - b.center.y);
+                if (std::max(ha, hb) > m_config.max_height_ratio * std::min(ha, hb) || dy > m_config.max_y_offset * mean_height ||
+                    dx < m_config.min_x_gap * mean_height || dx > m_config.max_x_gap * mean_height)
+                {
+                    continue;
+                }
+
+                // 两根灯条左右外沿之间,高度按装甲板估计,再整体放大
+                const int left = std::min(a.box.x, b.box.x);
+                const int right = std::max(a.box.x + a.box.width, b.box.x + b.box.width);
+                const float cx = (left + right) * 0.5f;
+                const float cy = (a.center.y + b.center.y) * 0.5f;
+                const float width = std::max((right - left) * m_config.roi_expand, static_cast<float>(m_config.roi_min_size));
+                const float height = std::max(mean_height * armor_height_per_bar * m_config.roi_expand, static_cast<float>(m_config.roi_min_size));
+                const cv::Rect roi(cvRound(cx - width * 0.5f), cvRound(cy - height * 0.5f), cvRound(width), cvRound(height));
+                const cv::Rect clipped = roi & image_bound;
+                if (clipped.area() > 0)
+                {
+                    rois.push_back(clipped);
+                }
+            }
+        }
+    }
+
+    void LightBarProposer::merge_rois(std::vector<cv::Rect> &rois) const
+    {
+        // 重叠的区域合并为外接区域,直到没有重叠(合并后可能与其他区域产生新的重叠)
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+            for (size_t i = 0; i < rois.size() && !merged; i++)
+            {
+                for (size_t j = i + 1; j < rois.size(); j++)
+                {
+                    if ((rois[i] & rois[j]).area() > 0)
+                    {
+                        rois[i] |= rois[j];
+                        rois.erase(rois.begin() + j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (static_cast<int>(rois.size()) > m_config.max_rois)
+        {
+            cv::Rect bound = rois[0];
+            for (const cv::Rect &roi : rois)
+            {
+                bound |= roi;
+            }
+            rois.assign(1, bound);
+        }
+    }
+
+    int LightBarProposer::propose(const cv::Mat &bgr, std::vector<cv::Rect> &rois)
+    {
+        rois.clear();
+        m_bars.clear();
+        if (bgr.empty() || bgr.type() != CV_8UC3)
+        {
+            return 0;
+        }
+        STAGE_TIMER(proposal);
+        const auto start = std::chrono::steady_clock::now();
+
+        if (m_config.enemy_color != EnemyColor::blue)
+        {
+            find_bars(bgr, EnemyColor::red);
+        }
+        if (m_config.enemy_color != EnemyColor::red)
+        {
+            find_bars(bgr, EnemyColor::blue);
+        }
+        pair_bars(bgr.size(), rois);
+        merge_rois(rois);
+
+        m_stats.bars += m_bars.size();
+        m_stats.propose_ms += elapsed_ms(start);
+        return static_cast<int>(rois.size());
+    }
+
+    cv::Rect LightBarProposer::select_roi(const cv::Mat &bgr)
+    {
+        const cv::Rect full(0, 0, bgr.cols, bgr.rows);
+        m_stats.frame_pixels += full.area();
+        if (next_frame_is_full())
+        {
+            m_stats.roi_pixels += full.area();
+            return full;
+        }
+
+        if (propose(bgr, m_rois) == 0)
+        {
+            if (m_config.full_frame_when_empty)
+            {
+                m_stats.full_frames++;
+                m_stats.roi_pixels += full.area();
+                return full;
+            }
+            m_stats.empty_frames++;
+            return cv::Rect();
+        }
+
+        cv::Rect bound = m_rois[0];
+        for (const cv::Rect &roi : m_rois)
+        {
+            bound |= roi;
+        }
+        m_stats.rois++;
+        m_stats.roi_pixels += bound.area();
+        return bound;
+    }
+
+    LightBarDetector::LightBarDetector(YoloVino &net, const LightBarConfig &config)
+        : m_net(net),
+          m_proposer(config)
+    {
+    }
+
+    void LightBarDetector::predict(const cv::Mat &ori_img, std::vector<NNDetectData> &detections)
+    {
+        detections.clear();
+        LightBarStats &stats = m_proposer.stats();
+        const cv::Rect full(0, 0, ori_img.cols, ori_img.rows);
+        stats.frame_pixels += full.area();
+
+        // 整帧推理时网络输入的像素数,在第一次整帧推理之前按最大输入尺寸估计
+        const uint64_t full_nn_pixels = m_full_nn_pixels > 0 ? m_full_nn_pixels
+                                                              : static_cast<uint64_t>(m_net.get_target_size()) * m_net.get_target_size();
+        stats.full_nn_pixels += full_nn_pixels;
+
+        bool full_frame = m_proposer.next_frame_is_full();
+        if (!full_frame && m_proposer.propose(ori_img, m_rois) == 0)
+        {
+            if (!m_proposer.get_config().full_frame_when_empty)
+            {
+                stats.empty_frames++;
+                return;
+            }
+            stats.full_frames++;
+            full_frame = true;
+        }
+
+        if (full_frame)
+        {
+            m_rois.assign(1, full);
+        }
+        else
+        {
+            // 固定输入尺寸时每个区域的推理代价与整帧相同,合并为一个区域只推理一次
+            if (!m_net.is_dynamic_shape() && m_rois.size() > 1)
+            {
+                cv::Rect bound = m_rois[0];
+                for (const cv::Rect &roi : m_rois)
+                {
+                    bound |= roi;
+                }
+                m_rois.assign(1, bound);
+            }
+            stats.rois += m_rois.size();
+        }
+
+        for (const cv::Rect &roi : m_rois)
+        {
+            m_workspace.info.bucket = nullptr;//letterbox失败时不计入网络输入像素
+            m_net.safe_predict(ori_img, roi, m_roi_results, m_workspace);
+            detections.insert(detections.end(), m_roi_results.begin(), m_roi_results.end());
+            stats.roi_pixels += roi.area();
+            if (m_workspace.info.bucket != nullptr)
+            {
+                const uint64_t pixels = m_workspace.info.bucket->input_size.area();
+                stats.nn_pixels += pixels;
+                if (full_frame)
+                {
+                    m_full_nn_pixels = pixels;
+                }
+            }
+        }
+    }
+
+} // namespace YoloVino
@@ -0,0 +1,250 @@
+#include "yolo_cascade.hpp"
+#include "StageProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace YoloVino
+{
+
+    namespace
+    {
+        float rect_iou(const cv::Rect &a, const cv::Rect &b)
+        {
+            const int inter = (a & b).area();
+            const int uni = a.area() + b.area() - inter;
+            return uni > 0 ? static_cast<float>(inter) / uni : 0.0f;
+        }
+
+        double elapsed_ms(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    } // namespace
+
+    CascadeConfig CascadeConfig::load(const std::string &yaml_path)
+    {
+        CascadeConfig config;
+        YAML::Node node = YAML::LoadFile(yaml_path);
+
+        // 都是可选参数,没有写就使用默认值
+        if (node["refine_conf_below"])
+        {
+            config.refine_conf_below = node["refine_conf_below"].as<float>();
+        }
+        if (node["refine_height_below"])
+        {
+            config.refine_height_below = node["refine_height_below"].as<int>();
+        }
+        if (node["crop_expand"])
+        {
+            config.crop_expand = std::max(1.0f, node["crop_expand"].as<float>());
+        }
+        if (node["crop_min_size"])
+        {
+            config.crop_min_size = node["crop_min_size"].as<int>();
+        }
+        if (node["max_refine"])
+        {
+            config.max_refine = std::max(0, node["max_refine"].as<int>());
+        }
+        if (node["merge_iou"])
+        {
+            config.merge_iou = node["merge_iou"].as<float>();
+        }
+        if (node["keep_unconfirmed"])
+        {
+            config.keep_unconfirmed = node["keep_unconfirmed"].as<bool>();
+        }
+        if (node["refine_class_map"])
+        {
+            config.refine_class_map = node["refine_class_map"].as<std::vector<int>>();
+        }
+        return config;
+    }
+
+    void CascadeStats::print() const
+    {
+        const double frame_count = frames > 0 ? static_cast<double>(frames) : 1.0;
+        const double crop_count = crops > 0 ? static_cast<double>(crops) : 1.0;
+        std::printf("========== 级联检测统计 ==========\n");
+        std::printf("帧数 %llu, 触发第二级的帧 %llu (%.1f%%)\n", static_cast<unsigned long long>(frames),
+                    static_cast<unsigned long long>(frames_refined), 100.0 * frames_refined / frame_count);
+        std::printf("第一级候选 %llu, 第二级推理 %llu 次 (每帧 %.2f 次)\n", static_cast<unsigned long long>(proposals),
+                    static_cast<unsigned long long>(crops), crops / frame_count);
+        std::printf("确认替换 %llu, 未检出 %llu, 新增 %llu (类别没有对应而丢弃 %llu)\n", static_cast<unsigned long long>(confirmed),
+                    static_cast<unsigned long long>(unconfirmed), static_cast<unsigned long long>(added),
+                    static_cast<unsigned long long>(unmapped));
+        if (proposal_ms > 0.0)
+        {
+            std::printf("第一级平均 %.2f ms/帧\n", proposal_ms / frame_count);
+        }
+        std::printf("第二级平均 %.2f ms/帧, %.2f ms/次\n", refine_ms / frame_count, refine_ms / crop_count);
+        std::printf("=================================\n");
+    }
+
+    YoloCascade::YoloCascade(YoloVino &proposal, YoloVino &refiner, const CascadeConfig &config)
+        : m_proposal(proposal),
+          m_refiner(refiner),
+          m_config(config)
+    {
+    }
+
+    bool YoloCascade::needs_refine(const NNDetectData &detection) const
+    {
+        return detection.confidence < m_config.refine_conf_below ||
+               (m_config.refine_height_below > 0 && detection.rect.height < m_config.refine_height_below);
+    }
+
+    int YoloCascade::map_class(int refine_class_id) const
+    {
+        if (refine_class_id < 0 || refine_class_id >= static_cast<int>(m_config.refine_class_map.size()))
+        {
+            return -1;
+        }
+        return m_config.refine_class_map[refine_class_id];
+    }
+
+    cv::Rect YoloCascade::crop_around(const cv::Rect &rect, cv::Size image_size) const
+    {
+        // 以候选框中心放大,装甲板很扁,按长边取正方形,保证灯条和角点都在裁剪区域内
+        const float side = std::max({rect.width * m_config.crop_expand, rect.height * m_config.crop_expand,
+                                     static_cast<float>(m_config.crop_min_size)});
+        const float cx = rect.x + rect.width * 0.5f;
+        const float cy = rect.y + rect.height * 0.5f;
+        const cv::Rect crop(cvRound(cx - side * 0.5f), cvRound(cy - side * 0.5f), cvRound(side), cvRound(side));
+        return crop & cv::Rect(0, 0, image_size.width, image_size.height);
+    }
+
+    void YoloCascade::predict(const cv::Mat &ori_img, std::vector<NNDetectData> &detections)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        m_proposal.safe_predict(ori_img, cv::Rect(0, 0, ori_img.cols, ori_img.rows), detections, m_proposal_workspace);
+        m_stats.proposal_ms += elapsed_ms(start);
+
+        refine(ori_img, detections);
+    }
+
+    void YoloCascade::refine(const cv::Mat &ori_img, std::vector<NNDetectData> &detections)
+    {
+        m_stats.frames++;
+        m_stats.proposals += detections.size();
+
+        // 选出需要精检的候选,置信度低的优先
+        m_refine_order.clear();
+        for (int i = 0; i < static_cast<int>(detections.size()); i++)
+        {
+            if (needs_refine(detections[i]))
+            {
+                m_refine_order.push_back(i);
+            }
+        }
+        if (m_refine_order.empty() || m_config.max_refine == 0)
+        {
+            return;
+        }
+        std::sort(m_refine_order.begin(), m_refine_order.end(), [&detections](int a, int b)
+                  { return detections[a].confidence < detections[b].confidence; });
+        if (static_cast<int>(m_refine_order.size()) > m_config.max_refine)
+        {
+            m_refine_order.resize(m_config.max_refine);
+        }
+
+        STAGE_TIMER(refine);
+        const auto start = std::chrono::steady_clock::now();
+        m_stats.frames_refined++;
+        m_matched.assign(detections.size(), 0);
+        const size_t proposal_count = detections.size();
+
+        for (int index : m_refine_order)
+        {
+            // 前面的裁剪区域已经替换过该候选(两个目标挨得很近)
+            if (m_matched[index])
+            {
+                continue;
+            }
+            const cv::Rect crop = crop_around(detections[index].rect, ori_img.size());
+            if (crop.area() == 0)
+            {
+                continue;
+            }
+            m_refiner.safe_predict(ori_img, crop, m_refined, m_refine_workspace);
+            m_stats.crops++;
+
+            for (const NNDetectData &result : m_refined)
+            {
+                // 与IoU最大的未替换候选合并
+                int best = -1;
+                float best_iou = m_config.merge_iou;
+                for (size_t i = 0; i < proposal_count; i++)
+                {
+                    float iou = rect_iou(result.rect, detections[i].rect);
+                    if (!m_matched[i] && iou >= best_iou)
+                    {
+                        best = static_cast<int>(i);
+                        best_iou = iou;
+                    }
+                }
+                if (best >= 0)
+                {
+                    // 两级的类别含义不同,只取第二级的框、关键点和置信度
+                    NNDetectData &detection = detections[best];
+                    detection.confidence = result.confidence;
+                    detection.rect = result.rect;
+                    detection.keypoints = result.keypoints;
+                    m_matched[best] = 1;
+                    m_stats.confirmed++;
+                    continue;
+                }
+
+                // 不与任何已有结果重叠时作为新目标(第一级漏检的远处目标)
+                bool overlaps = false;
+                for (const NNDetectData &detection : detections)
+                {
+                    if (rect_iou(result.rect, detection.rect) >= m_config.merge_iou)
+                    {
+                        overlaps = true;
+                        break;
+                    }
+                }
+                if (!overlaps)
+                {
+                    const int class_id = map_class(result.class_id);
+                    if (class_id < 0)
+                    {
+                        m_stats.unmapped++;
+                        continue;
+                    }
+                    detections.push_back(result);
+                    detections.back().class_id = class_id;
+                    m_stats.added++;
+                }
+            }
+        }
+
+        // 第二级没有确认的候选
+        size_t write = 0;
+        for (size_t i = 0; i < detections.size(); i++)
+        {
+            const bool refined_proposal = i < proposal_count && !m_matched[i] &&
+                                          std::find(m_refine_order.begin(), m_refine_order.end(), static_cast<int>(i)) != m_refine_order.end();
+            if (refined_proposal)
+            {
+                m_stats.unconfirmed++;
+                if (!m_config.keep_unconfirmed)
+                {
+                    continue;
+                }
+            }
+            if (write != i)
+            {
+                detections[write] = detections[i];
+            }
+            write++;
+        }
+        detections.resize(write);
+
+        m_stats.refine_ms += elapsed_ms(start);
+    }
+
+} // namespace YoloVino
@@ -1,8 +1,70 @@
 #include "yolo_vino.hpp"
+#include "StageProfiler.h"
+#include "SimdKernels.h"
+#include <openvino/opsets/opset11.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
 
 namespace YoloVino
 {
 
+    namespace
+    {
+        // 把img(3通道)中inner以外的部分填成(c0,c1,c2)
+        void fill_border(cv::Mat &img, const cv::Rect &inner, uint8_t c0, uint8_t c1, uint8_t c2)
+        {
+            const Simd::Kernels &kernels = Simd::kernels();
+            const int right = inner.x + inner.width;
+            const int bottom = inner.y + inner.height;
+            for (int row = 0; row < img.rows; row++)
+            {
+                uint8_t *line = img.ptr<uint8_t>(row);
+                if (row < inner.y || row >= bottom)
+                {
+                    kernels.fill_u8c3(line, img.cols, c0, c1, c2); // 上下整行
+                }
+                else
+                {
+                    kernels.fill_u8c3(line, inner.x, c0, c1, c2);                          // 左侧
+                    kernels.fill_u8c3(line + 3 * right, img.cols - right, c0, c1, c2);     // 右侧
+                }
+            }
+        }
+
+        // 扫描结果的缓冲区,每个线程一份,避免每帧分配
+        thread_local std::vector<int> scan_indices;
+        thread_local std::vector<float> scan_values;
+        thread_local std::vector<int> scan_argmax;
+
+        // 不带工作区的接口使用的中间数据,每个线程一份
+        thread_local DetectWorkspace predict_workspace;
+        thread_local NmsScratch nms_scratch;
+
+        namespace op = ov::opset11;
+
+        template <typename T>
+        std::shared_ptr<op::Constant> constant(const ov::element::Type &type, const std::vector<T> &values)
+        {
+            return op::Constant::create(type, ov::Shape{values.size()}, values);
+        }
+
+        template <typename T>
+        std::shared_ptr<op::Constant> scalar(const ov::element::Type &type, T value)
+        {
+            return op::Constant::create(type, ov::Shape{}, {value});
+        }
+
+        // 取[1,锚框,通道]的第[begin,end)个通道
+        ov::Output<ov::Node> slice_channels(const ov::Output<ov::Node> &rows, int64_t begin, int64_t end)
+        {
+            return std::make_shared<op::Slice>(rows, constant<int64_t>(ov::element::i64, {begin}), constant<int64_t>(ov::element::i64, {end}),
+                                               constant<int64_t>(ov::element::i64, {1}), constant<int64_t>(ov::element::i64, {2}));
+        }
+    } // namespace
+
     void YoloVinoLogger::init_config(const std::string yaml_path)
     {
         YAML::Node config = YAML::LoadFile(yaml_path);
@@ -12,6 +74,58 @@ namespace YoloVino
         m_input_size = config["input_size"].as<std::string>();
         m_output_size = config["output_size"].as<std::string>();
         m_date = config["date"].as<std::string>();
+
+        // 可选参数,没有写就使用默认值
+        if (config["dynamic_shape"])
+        {
+            m_dynamic_shape = config["dynamic_shape"].as<bool>();
+        }
+        if (config["bucket_min"])
+        {
+            m_bucket_min = config["bucket_min"].as<int>();
+        }
+        if (config["bucket_step"])
+        {
+            m_bucket_step = config["bucket_step"].as<int>();
+        }
+        if (config["profiling_frames"])
+        {
+            m_profiling_frames = config["profiling_frames"].as<int>();
+        }
+        if (config["profiling_report"])
+        {
+            m_profiling_report = config["profiling_report"].as<std::string>();
+        }
+        if (config["warmup_frames"])
+        {
+            m_warmup_frames = config["warmup_frames"].as<int>();
+        }
+        if (config["cache_dir"])
+        {
+            m_cache_dir = config["cache_dir"].as<std::string>();
+        }
+        if (config["inference_threads"])
+        {
+            m_inference_threads = std::max(0, config["inference_threads"].as<int>());
+        }
+        if (config["graph_nms"])
+        {
+            m_graph_nms = config["graph_nms"].as<bool>();
+        }
+        if (config["graph_nms_topk"])
+        {
+            m_graph_nms_topk = std::max(1, config["graph_nms_topk"].as<int>());
+        }
+        if (config["graph_nms_max"])
+        {
+            m_graph_nms_max = std::max(1, config["graph_nms_max"].as<int>());
+        }
+
+        // 环境变量优先,便于不改配置文件临时打开
+        if (const char *env = std::getenv("YOLOVINO_PROFILE"))
+        {
+            m_profiling_frames = std::atoi(env);
+        }
     }
 
     YoloVinoLogger::YoloVinoLogger()
@@ -40,23 +154,66 @@ namespace YoloVino
         std::cout << "Input Size  : " << m_input_size << "\n";
         std::cout << "Output Size : " << m_output_size << "\n";
         std::cout << "Config Date : " << m_date << "\n";
+        std::cout << "Dyn. Shape  : " << (m_dynamic_shape ? "on" : "off")
+                  << " (min " << m_bucket_min << ", step " << m_bucket_step << ")\n";
+        std::cout << "Warm-up     : " << m_warmup_frames << " frames, cache " << (m_cache_dir.empty() ? "off" : m_cache_dir) << "\n";
+        std::cout << "Infer Thr.  : " << (m_inference_threads > 0 ? std::to_string(m_inference_threads) : "default") << "\n";
+        std::cout << "Graph NMS   : " << (m_graph_nms ? "on (topk " + std::to_string(m_graph_nms_topk) + ", max " + std::to_string(m_graph_nms_max) + ")" : "off") << "\n";
+        std::cout << "Profiling   : " << (m_profiling_frames > 0 ? std::to_string(m_profiling_frames) + " frames -> " + m_profiling_report : "off") << "\n";
         std::cout << "==============================================\n";
     }
 
-    YoloVino::YoloVino(int target_size, int archors_num, int channels_num, float class_conf_thresh, float NMS_IOU_threshold)
-        : m_target_size(target_size),
-          m_archors_num(archors_num),
-          m_channels_num(channels_num),
+    YoloVino::YoloVino(std::unique_ptr<YoloVinoLogger> &&logger_ptr, int target_size, float class_conf_thresh, float NMS_IOU_threshold)
+        : m_logger_ptr(std::move(logger_ptr)),
+          m_target_size(target_size),
           m_class_conf_thresh(class_conf_thresh),
           m_NMS_IOU_threshold(NMS_IOU_threshold)
     {
+        m_logger_ptr->set_owner(this);
+
+        // 动态尺寸参数: 步长至少为网络的最大下采样倍数32,下限不超过最大输入尺寸
+        m_dynamic_shape.store(m_logger_ptr->get_dynamic_shape(), std::memory_order_relaxed);
+        m_bucket_step = std::max(32, m_logger_ptr->get_bucket_step() / 32 * 32);
+        m_bucket_min = std::min(m_target_size, std::max(m_bucket_step, m_logger_ptr->get_bucket_min() / m_bucket_step * m_bucket_step));
+        m_profiling_frames = std::max(0, m_logger_ptr->get_profiling_frames());
+        m_profiling_compile.store(m_profiling_frames > 0, std::memory_order_relaxed);
+        m_warmup_frames = std::max(0, m_logger_ptr->get_warmup_frames());
+        m_graph_nms.store(m_logger_ptr->get_graph_nms(), std::memory_order_relaxed);
+
+        // 编译缓存: 第二次启动时直接加载编译好的模型,省去大部分编译时间
+        if (!m_logger_ptr->get_cache_dir().empty())
+        {
+            m_core.set_property(ov::cache_dir(m_logger_ptr->get_cache_dir()));
+        }
+
+        // 推理线程数: 与--rt中ov的cpu数一致,工作线程不会多于可用的核
+        if (m_logger_ptr->get_inference_threads() > 0)
+        {
+            m_core.set_property(m_logger_ptr->get_device_type(), ov::inference_num_threads(m_logger_ptr->get_inference_threads()));
+        }
     }
 
-    void Yolov8poseVino::build_compiled_model()
+    void YoloVino::build_default_bucket()
     {
         // 读取模型
-        ov::Core core;
-        std::shared_ptr<ov::Model> model = core.read_model(m_logger_ptr->get_model_path());
+        m_model = m_core.read_model(m_logger_ptr->get_model_path());
+
+        // 默认尺寸一定要能编译成功
+        InferBucket &bucket = m_buckets[{m_target_size, m_target_size}];
+        bucket = compile_bucket(cv::Size(m_target_size, m_target_size));
+        m_default_bucket = &bucket;
+    }
+
+    InferBucket YoloVino::compile_bucket(cv::Size input_size, const ov::AnyMap &properties)
+    {
+        std::shared_ptr<ov::Model> model = m_model->clone();
+
+        // 非默认尺寸需要先重设网络输入形状(NCHW)
+        if (input_size != cv::Size(m_target_size, m_target_size))
+        {
+            model->reshape(ov::PartialShape{1, 3, input_size.height, input_size.width});
+        }
+
         ov::preprocess::PrePostProcessor ppp(model); // ppp用于自动化部分预处理和后处理流程
 
         // 设置自动化的参数
@@ -65,181 +222,573 @@ namespace YoloVino
         ppp.input().model().set_layout("NCHW");                   // 可选,用于告知
         ppp.output().tensor().set_element_type(ov::element::f32); // 可选,用于告知
 
-        // 获取输出格式
-        const std::vector<ov::Output<ov::Node>> outputs = model->outputs();
-        const ov::Shape output_shape = outputs[0].get_shape();
-        short height = output_shape[1];
-        short width = output_shape[2];
-        m_output_shape = cv::Size(width, height);
+        // 获取输出格式,锚框数目随输入尺寸变化
+        InferBucket bucket;
+        bucket.input_size = input_size;
+        const ov::Shape output_shape = model->outputs()[0].get_shape();
+        int height = static_cast<int>(output_shape[1]);
+        int width = static_cast<int>(output_shape[2]);
+        bucket.output_shape = cv::Size(width, height);
 
         // 构建完整模型并加载到设备
-        m_compiled_model = core.compile_model(ppp.build(), m_logger_ptr->get_device_type());
+        std::shared_ptr<ov::Model> built = ppp.build();
+        ov::AnyMap config = properties;
+        config.insert(ov::enable_profiling(m_profiling_compile.load(std::memory_order_relaxed)));
+        bucket.profiling = config.at(ov::enable_profiling.name()).as<bool>();
+        if (is_graph_nms())
+        {
+            // 图内NMS: 在副本上编辑,编辑或编译失败时退回C++后处理,之后的尺寸也不再尝试
+            try
+            {
+                bucket.compiled_model = m_core.compile_model(append_graph_nms(built->clone()), m_logger_ptr->get_device_type(), config);
+                bucket.graph_nms = true;
+                bucket.roi_limit_input = bucket.compiled_model.inputs().size() > 1;
+            }
+            catch (const std::exception &e)
+            {
+                m_graph_nms.store(false, std::memory_order_relaxed);
+                m_logger_ptr->YVL_LOG<LoggerInfoLevel::warning_info>(this, "图内NMS构建失败,退回C++后处理: ", e.what());
+            }
+        }
+        if (!bucket.graph_nms)
+        {
+            bucket.compiled_model = m_core.compile_model(built, m_logger_ptr->get_device_type(), config);
+        }
 
         // 创建推理请求
-        m_infer_request = m_compiled_model.create_infer_request();
+        bucket.infer_request = bucket.compiled_model.create_infer_request();
+        return bucket;
+    }
+
+    std::shared_ptr<ov::Model> YoloVino::append_graph_nms(const std::shared_ptr<ov::Model> &model)
+    {
+        // letterbox有效区域的右下边界,只有用到它的模型才作为第二个输入
+        auto roi_limit = std::make_shared<op::Parameter>(ov::element::f32, ov::Shape{2});
+        roi_limit->set_friendly_name("roi_limit");
+        const GraphNmsInputs inputs = graph_nms_inputs(model->get_results()[0]->input_value(0), roi_limit);
+
+        // 先按得分取前topk个锚框,NMS只需要处理topk个框
+        const int64_t anchors = inputs.scores.get_partial_shape()[1].get_length();
+        const int64_t topk = std::min<int64_t>(anchors, m_logger_ptr->get_graph_nms_topk());
+        auto top = std::make_shared<op::TopK>(inputs.scores, scalar<int64_t>(ov::element::i64, topk), 1,
+                                              op::TopK::Mode::MAX, op::TopK::SortType::SORT_VALUES, ov::element::i32);
+        auto top_boxes = std::make_shared<op::Gather>(inputs.boxes, top->output(1), scalar<int64_t>(ov::element::i64, 1), 1);
+        auto top_scores = std::make_shared<op::Unsqueeze>(top->output(0), scalar<int64_t>(ov::element::i64, 1));
+
+        // 全部锚框作为同一类做NMS,与C++的nms一样不区分类别; 得分低于类别置信度阈值的框不会被选中
+        auto nms = std::make_shared<op::NonMaxSuppression>(top_boxes, top_scores,
+                                                           scalar<int64_t>(ov::element::i64, m_logger_ptr->get_graph_nms_max()),
+                                                           scalar<float>(ov::element::f32, m_NMS_IOU_threshold),
+                                                           scalar<float>(ov::element::f32, m_class_conf_thresh),
+                                                           inputs.center_boxes ? op::NonMaxSuppression::BoxEncodingType::CENTER
+                                                                               : op::NonMaxSuppression::BoxEncodingType::CORNER,
+                                                           true, ov::element::i32);
+
+        // 选中的(批次,类别,框)只取前valid_outputs行,框的下标换算回锚框下标,再取出这些锚框的整行输出
+        auto selected = std::make_shared<op::Slice>(nms->output(0), constant<int32_t>(ov::element::i32, {0}), nms->output(2),
+                                                    constant<int32_t>(ov::element::i32, {1}), constant<int32_t>(ov::element::i32, {0}));
+        auto box_index = std::make_shared<op::Gather>(selected, scalar<int32_t>(ov::element::i32, 2), scalar<int64_t>(ov::element::i64, 1));
+        auto anchor_index = std::make_shared<op::Gather>(top->output(1), box_index, scalar<int64_t>(ov::element::i64, 1));
+        ov::Output<ov::Node> compact = std::make_shared<op::Gather>(inputs.rows, anchor_index, scalar<int64_t>(ov::element::i64, 1), 1);
+        if (inputs.channels_first)
+        {
+            compact = std::make_shared<op::Transpose>(compact, constant<int64_t>(ov::element::i64, {0, 2, 1}));
+        }
+
+        auto result = std::make_shared<op::Result>(compact);
+        ov::ParameterVector parameters = model->get_parameters();
+        if (!roi_limit->output(0).get_target_inputs().empty())
+        {
+            parameters.push_back(roi_limit);
+        }
+        return std::make_shared<ov::Model>(ov::ResultVector{result}, parameters, model->get_friendly_name() + "_graph_nms");
+    }
+
+    InferBucket YoloVino::compile_throughput_bucket()
+    {
+        // 吞吐提示下插件按核数划分多个推理流,每个推理请求占一个流,多个请求同时推理时才能占满全部的核
+        // 吞吐模式不收集逐层统计,不需要承担统计开销
+        InferBucket bucket = compile_bucket(cv::Size(m_target_size, m_target_size),
+                                            {ov::hint::performance_mode(ov::hint::PerformanceMode::THROUGHPUT), ov::enable_profiling(false)});
+        m_logger_ptr->YVL_LOG<LoggerInfoLevel::basic_info>(this, "吞吐模式编译完成, 建议推理请求数 ",
+                                                           bucket.compiled_model.get_property(ov::optimal_number_of_infer_requests));
+        return bucket;
+    }
+
+    void YoloVino::set_input_limit(int limit)
+    {
+        limit = limit > 0 ? std::max(m_bucket_min, limit / m_bucket_step * m_bucket_step) : 0;
+        m_input_limit.store(limit >= m_target_size ? 0 : limit, std::memory_order_relaxed);
+    }
+
+    void YoloVino::prepare_input_limit(int limit, cv::Size frame_size)
+    {
+        if (!is_dynamic_shape() || limit <= 0 || frame_size.area() == 0)
+        {
+            return;
+        }
+        limit = std::max(m_bucket_min, limit / m_bucket_step * m_bucket_step);
+        const float scale = std::min({1.0f, static_cast<float>(limit) / frame_size.width, static_cast<float>(limit) / frame_size.height});
+        std::lock_guard<std::mutex> lock(m_infer_mutex);
+        compile_and_cache(bucket_key(cv::Size(static_cast<int>(frame_size.width * scale), static_cast<int>(frame_size.height * scale))));
+    }
+
+    std::pair<int, int> YoloVino::bucket_key(cv::Size view_size) const
+    {
+        // 向上取整到步长,并限制在[m_bucket_min, m_target_size]
+        auto round_up = [this](int length)
+        {
+            int size = (length + m_bucket_step - 1) / m_bucket_step * m_bucket_step;
+            return std::max(m_bucket_min, std::min(size, m_target_size));
+        };
+        return std::pair<int, int>(round_up(view_size.width), round_up(view_size.height));
+    }
+
+    InferBucket &YoloVino::select_bucket(cv::Size view_size)
+    {
+        if (!is_dynamic_shape())
+        {
+            return *m_default_bucket;
+        }
+
+        const std::pair<int, int> key = bucket_key(view_size);
+        auto it = m_buckets.find(key);
+        if (it != m_buckets.end())
+        {
+            return it->second;
+        }
+
+        // 第一次遇到该尺寸: 编译要几百毫秒,不能在推理路径上等待,交给后台编译,
+        // 本帧使用已编译的能装下该尺寸的最小尺寸(默认尺寸一定能装下)
+        compile_in_background(key);
+        InferBucket *best = m_default_bucket;
+        for (auto &entry : m_buckets)
+        {
+            const cv::Size size = entry.second.input_size;
+            if (size.width >= key.first && size.height >= key.second && size.area() < best->input_size.area())
+            {
+                best = &entry.second;
+            }
+        }
+        return *best;
+    }
+
+    InferBucket &YoloVino::compile_and_cache(std::pair<int, int> key)
+    {
+        auto it = m_buckets.find(key);
+        if (it != m_buckets.end())
+        {
+            return it->second;
+        }
+        try
+        {
+            m_logger_ptr->YVL_LOG<LoggerInfoLevel::debug_info>(this, "编译输入尺寸 ", key.first, "x", key.second);
+            return m_buckets.emplace(key, compile_bucket(cv::Size(key.first, key.second))).first->second;
+        }
+        catch (const std::exception &e)
+        {
+            // 模型不支持重设形状,退回固定尺寸
+            m_dynamic_shape.store(false, std::memory_order_relaxed);
+            m_logger_ptr->YVL_LOG<LoggerInfoLevel::warning_info>(this, "动态尺寸编译失败,退回固定尺寸: ", e.what());
+            return *m_default_bucket;
+        }
     }
 
-    std::vector<NNDetectData> Yolov8poseVino::safe_predict(const cv::Mat &ori_img, cv::Rect roi)
+    void YoloVino::compile_in_background(std::pair<int, int> key)
     {
+        // 同一时间只编译一个尺寸,正在编译时其他新尺寸等下一次遇到再提交
+        if (m_compile_future.valid() && m_compile_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return;
+        }
+        m_compile_future = std::async(std::launch::async, [this, key]()
+                                      {
+            try
+            {
+                m_logger_ptr->YVL_LOG<LoggerInfoLevel::debug_info>(this, "后台编译输入尺寸 ", key.first, "x", key.second);
+                InferBucket bucket = compile_bucket(cv::Size(key.first, key.second));
+                std::lock_guard<std::mutex> lock(m_infer_mutex);
+                m_buckets.emplace(key, std::move(bucket));
+            }
+            catch (const std::exception &e)
+            {
+                // 模型不支持重设形状,退回固定尺寸
+                m_dynamic_shape.store(false, std::memory_order_relaxed);
+                m_logger_ptr->YVL_LOG<LoggerInfoLevel::warning_info>(this, "动态尺寸编译失败,退回固定尺寸: ", e.what());
+            } });
+    }
 
+    void YoloVino::wait_background_compile()
+    {
+        if (m_compile_future.valid())
+        {
+            m_compile_future.wait();
+        }
+        if (m_unprofile_future.valid())
+        {
+            m_unprofile_future.wait();
+        }
+    }
+
+    bool YoloVino::letterbox(const cv::Mat &ori_img, cv::Rect roi, cv::Mat &final_img, LetterboxInfo &info)
+    {
         if (ori_img.empty())
         {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::warning_info, "传入图像为空");
-            return {};
+            m_logger_ptr->YVL_LOG<LoggerInfoLevel::warning_info>(this, "传入图像为空");
+            return false;
         }
 
+        STAGE_TIMER_NAMED(crop_timer, roi_crop);
+
         cv::Rect ori_img_bound(0, 0, ori_img.cols, ori_img.rows);
-        cv::Rect final_roi = roi & ori_img_bound;
-        if (final_roi.area() == 0)
+        info.final_roi = roi & ori_img_bound;
+        if (info.final_roi.area() == 0)
         {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::warning_info, "roi落在图像外");
-            return {};
+            m_logger_ptr->YVL_LOG<LoggerInfoLevel::warning_info>(this, "roi落在图像外");
+            return false;
         }
 
         // 视图截取
-        cv::Mat src_view = ori_img(final_roi);
+        cv::Mat src_view = ori_img(info.final_roi);
 
         // 等比缩放, 并记录缩放值
         int src_view_width = src_view.cols;
         int src_view_height = src_view.rows;
 
-        // 计算缩放系数
+        // 计算缩放系数, 动态尺寸下不放大roi, 并受运行时上限约束
         float scale = std::min(static_cast<float>(m_target_size) / src_view_width,
                                static_cast<float>(m_target_size) / src_view_height);
+        if (is_dynamic_shape())
+        {
+            scale = std::min(1.0f, scale);
+            const int limit = m_input_limit.load(std::memory_order_relaxed);
+            if (limit > 0)
+            {
+                scale = std::min(scale, std::min(static_cast<float>(limit) / src_view_width,
+                                                 static_cast<float>(limit) / src_view_height));
+            }
+        }
+
+        // 选择能装下缩放后roi的最小尺寸
+        {
+            std::lock_guard<std::mutex> lock(m_infer_mutex);
+            info.bucket = &select_bucket(cv::Size(static_cast<int>(src_view_width * scale),
+                                                  static_cast<int>(src_view_height * scale)));
+        }
+        const cv::Size input_size = info.bucket->input_size;
+
+        // 编译失败退回固定尺寸时需要重新计算缩放
+        scale = std::min(scale, std::min(static_cast<float>(input_size.width) / src_view_width,
+                                         static_cast<float>(input_size.height) / src_view_height));
         int new_width = static_cast<int>(src_view_width * scale);
         int new_height = static_cast<int>(src_view_height * scale);
 
         if (new_width == 0 || new_height == 0)
         {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::warning_info, "原图形状过于狭长");
-            return {};
+            m_logger_ptr->YVL_LOG<LoggerInfoLevel::warning_info>(this, "原图形状过于狭长");
+            return false;
         }
 
-        cv::Mat resized_view;
-
-        // 等比缩放，速度(INTER_NEAREST > INTER_AREA >INTER_LINEAR)
-        cv::resize(src_view, resized_view, cv::Size(new_width, new_height), 0, 0, cv::INTER_LINEAR);
+        STAGE_TIMER_STOP(crop_timer);
+        STAGE_TIMER(letterbox);
 
         // 填充, 并记录填充值
-        int pad_x = std::max(0, (m_target_size - new_width) / 2);
-        int pad_y = std::max(0, (m_target_size - new_height) / 2);
+        info.scale = scale;
+        info.pad_x = std::max(0, (input_size.width - new_width) / 2);
+        info.pad_y = std::max(0, (input_size.height - new_height) / 2);
+
+        // 直接缩放到输出图像的中间区域,再只填充四周,不再经过copyMakeBorder多拷贝一次
+        const cv::Rect inner(info.pad_x, info.pad_y, new_width, new_height);
+        final_img.create(input_size, src_view.type());
+        cv::Mat inner_view = final_img(inner);
 
-        cv::Mat final_img; // 最终处理好的图片
-        cv::copyMakeBorder(resized_view, final_img,
-                           pad_y, m_target_size - new_height - pad_y, // 上下填充
-                           pad_x, m_target_size - new_width - pad_x,  // 左右填充
-                           cv::BORDER_CONSTANT, cv::Scalar(124, 124, 124));
+        // 等比缩放，速度(INTER_NEAREST > INTER_AREA >INTER_LINEAR), 原尺度时直接拷贝
+        if (new_width == src_view_width && new_height == src_view_height)
+        {
+            src_view.copyTo(inner_view);
+        }
+        else
+        {
+            cv::resize(src_view, inner_view, inner.size(), 0, 0, cv::INTER_LINEAR);
+        }
 
-        // 极端情况：如果填充后的图像尺寸不符合目标，则再次调整尺寸
-        if (final_img.cols != m_target_size || final_img.rows != m_target_size)
+        if (final_img.type() == CV_8UC3)
+        {
+            fill_border(final_img, inner, 124, 124, 124);
+        }
+        else
         {
-            cv::resize(final_img, final_img, cv::Size(m_target_size, m_target_size), 0, 0, cv::INTER_NEAREST);
+            cv::Mat border_mask(input_size, CV_8U, cv::Scalar(255));
+            border_mask(inner).setTo(0);
+            final_img.setTo(cv::Scalar(124, 124, 124), border_mask);
         }
+        return true;
+    }
+
+    cv::Mat YoloVino::infer(const cv::Mat &final_img, const LetterboxInfo &info)
+    {
+        cv::Mat output;
+        infer(final_img, info, output);
+        return output;
+    }
+
+    void YoloVino::infer(const cv::Mat &final_img, const LetterboxInfo &info, cv::Mat &output)
+    {
+        STAGE_TIMER(infer);
 
-        // 转化到输入张量
-        ov::Tensor input_tensor = ov::Tensor(
-            m_compiled_model.input().get_element_type(),
-            m_compiled_model.input().get_shape(),
-            final_img.data);
+        InferBucket &bucket = *info.bucket;
 
-        cv::Mat output; // 准备接受输出
+        // 等锁的时间单独记录(级联时第二级可能在用同一个模型)
+        std::unique_lock<std::mutex> lock(m_infer_mutex, std::defer_lock);
         {
-            std::lock_guard<std::mutex> lock(m_infer_mutex);
-            // 设置输入//需要注意的是，这里只是绑定input的数据到推理流，所以input的生命周期不能小于这次推理
-            m_infer_request.set_input_tensor(input_tensor);
+            FRAME_TRACE_SPAN("infer_lock");
+            lock.lock();
+        }
 
-            // 进行同步推理
-            m_infer_request.infer();
+        // 统计完成后换入不带统计的模型,之后的帧不再承担统计开销
+        if (bucket.profiling && m_profiling_frames == 0)
+        {
+            swap_unprofiled(bucket);
+        }
 
-            // 获取推理结果指针,转化到矩阵形式便于遍历
-            const float *output_data_ptr = m_infer_request.get_output_tensor().data<const float>();
-            output = cv::Mat(m_output_shape, CV_32F, (float *)output_data_ptr).clone();
+        // 转化到输入张量: 按缓冲区地址缓存,同一块输入缓冲区复用时不再创建张量
+        // 需要注意的是，这里只是绑定input的数据到推理流，所以input的生命周期不能小于这次推理
+        auto cached = std::find_if(bucket.input_tensors.begin(), bucket.input_tensors.end(),
+                                   [&](const std::pair<const void *, ov::Tensor> &entry)
+                                   { return entry.first == final_img.data; });
+        if (cached == bucket.input_tensors.end())
+        {
+            // 流水线循环使用十几个帧对象,各自的输入缓冲区地址固定; 地址一直在变(每帧新分配)时只保留最近的几个
+            if (bucket.input_tensors.size() >= 16)
+            {
+                bucket.input_tensors.erase(bucket.input_tensors.begin());
+            }
+            bucket.input_tensors.emplace_back(final_img.data, ov::Tensor(bucket.compiled_model.input(0).get_element_type(),
+                                                                         bucket.compiled_model.input(0).get_shape(),
+                                                                         final_img.data));
+            cached = bucket.input_tensors.end() - 1;
         }
+        bind_inputs(bucket, bucket.infer_request, cached->second, info);
 
-        //////后处理///////
+        // 进行同步推理
+        bucket.infer_request.infer();
+
+        // 逐层性能统计
+        if (m_profiling_frames > 0)
+        {
+            collect_profiling(bucket.infer_request);
+        }
 
-        std::vector<int> class_ids_temp;         // 类别容器
-        std::vector<cv::Rect> rects_temp;        // rect容器
-        std::vector<float> confs_temp;           // conf容器
-        std::vector<cv::Point3f> keypoints_temp; // keypoints容器
+        // 拷贝到output(尺寸不变时不重新分配)
+        output_view(bucket, bucket.infer_request).copyTo(output);
+    }
 
-        for (int archor_idx = 0; archor_idx < m_archors_num; archor_idx++)
+    void YoloVino::bind_inputs(const InferBucket &bucket, ov::InferRequest &infer_request, const ov::Tensor &image, const LetterboxInfo &info)
+    {
+        infer_request.set_input_tensor(0, image);
+        if (bucket.roi_limit_input)
         {
-            // 置信度最高的类别的索引和置信度
-            double max_class_conf = 0.0f;
-            cv::Point best_class_idx; // 最佳类别，y为索引(4-13)
-            const cv::Mat classes_conf = output.col(archor_idx).rowRange(4, 14);
-            cv::minMaxLoc(classes_conf, nullptr, &max_class_conf, nullptr, &best_class_idx);
+            // decode中关键点还原到roi后要落在[0, roi宽高)内,换算到网络输入坐标: x < pad_x + (roi宽 - 0.5) * scale
+            float *limit = infer_request.get_input_tensor(1).data<float>();
+            limit[0] = info.pad_x + (info.final_roi.width - 0.5f) * info.scale;
+            limit[1] = info.pad_y + (info.final_roi.height - 0.5f) * info.scale;
+        }
+    }
 
-            // 如果最大的置信度也低于阈值,则跳过该锚框
-            if (max_class_conf < m_class_conf_thresh)
+    cv::Mat YoloVino::output_view(const InferBucket &bucket, ov::InferRequest &infer_request)
+    {
+        const ov::Tensor output = infer_request.get_output_tensor();
+        cv::Size size = bucket.output_shape;
+        if (bucket.graph_nms)
+        {
+            // [1,通道,锚框]或[1,锚框,通道],锚框数为本次NMS选中的数目
+            const ov::Shape shape = output.get_shape();
+            size = cv::Size(static_cast<int>(shape[2]), static_cast<int>(shape[1]));
+            if (size.area() == 0)
             {
-                continue;
+                return cv::Mat();
             }
+        }
+        return cv::Mat(size, CV_32F, const_cast<float *>(output.data<const float>()));
+    }
 
-            // 说明有类别的置信度够高，那么进行解码
-            float cx_temp = output.at<float>(0, archor_idx);
-            float cy_temp = output.at<float>(1, archor_idx);
-            float w_temp = output.at<float>(2, archor_idx);
-            float h_temp = output.at<float>(3, archor_idx);
-
-            // 还原到原图尺度
-            int lt_x = std::max(0.f, (((cx_temp - 0.5f * w_temp) - pad_x) / scale) + 0.5f);
-            int lt_y = std::max(0.f, (((cy_temp - 0.5f * h_temp) - pad_y) / scale) + 0.5f);
-            float w = w_temp / scale;
-            float h = h_temp / scale;
+    void YoloVino::warm_up(int iterations)
+    {
+        if (iterations < 0)
+        {
+            iterations = m_warmup_frames;
+        }
+        if (iterations == 0)
+        {
+            return;
+        }
 
-            // 放入容器
-            class_ids_temp.push_back(best_class_idx.y);
-            confs_temp.push_back((float)max_class_conf);
-            rects_temp.push_back(cv::Rect(lt_x, lt_y, static_cast<int>(w + 0.5), static_cast<int>(h + 0.5)));
+        // 噪声输入,避免全常数输入走到与实际不同的快速路径
+        InferBucket &bucket = *m_default_bucket;
+        cv::Mat input(bucket.input_size, CV_8UC3);
+        cv::randu(input, cv::Scalar::all(0), cv::Scalar::all(255));
+        ov::Tensor input_tensor(bucket.compiled_model.input(0).get_element_type(), bucket.compiled_model.input(0).get_shape(), input.data);
+        LetterboxInfo info;
+        info.final_roi = cv::Rect(cv::Point(0, 0), bucket.input_size);
 
-            // kepoints解码(4个关键点)
-            for (int kpt_num = 0; kpt_num < 4; kpt_num++)
+        double first_ms = 0.0;
+        double last_ms = 0.0;
+        {
+            std::lock_guard<std::mutex> lock(m_infer_mutex);
+            bind_inputs(bucket, bucket.infer_request, input_tensor, info);
+            for (int i = 0; i < iterations; i++)
             {
-                float kpt_x_temp = output.at<float>(14 + kpt_num * 3 + 0, archor_idx); // x
-                float kpt_y_temp = output.at<float>(14 + kpt_num * 3 + 1, archor_idx); // y
-                float kpt_conf = output.at<float>(14 + kpt_num * 3 + 2, archor_idx);   // conf
+                const auto start = std::chrono::steady_clock::now();
+                bucket.infer_request.infer();
+                last_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (i == 0)
+                {
+                    first_ms = last_ms;
+                }
+            }
+        }
+        m_logger_ptr->YVL_LOG<LoggerInfoLevel::basic_info>(this, "预热", iterations, "次: 首次", first_ms, "ms, 最后一次", last_ms, "ms");
+    }
 
-                // 还原到原图尺度
-                int kpt_x = std::max(0, static_cast<int>((kpt_x_temp - pad_x) / scale + 0.5f));
-                int kpt_y = std::max(0, static_cast<int>((kpt_y_temp - pad_y) / scale + 0.5f));
+    void YoloVino::nms(const DecodeCandidates &candidates, std::vector<int> &indices)
+    {
+        nms(candidates, indices, nms_scratch);
+    }
 
-                // 放入容器
-                keypoints_temp.push_back(cv::Point3f(kpt_x, kpt_y, kpt_conf));
+    void YoloVino::nms(const DecodeCandidates &candidates, std::vector<int> &indices, NmsScratch &scratch)
+    {
+        STAGE_TIMER(nms);
+
+        // 与cv::dnn::NMSBoxes相同的贪心NMS: 按置信度从高到低,保留的框抑制与它IoU超过阈值的其余框
+        std::vector<int> &order = scratch.order;
+        order.clear();
+        for (int i = 0; i < static_cast<int>(candidates.confs.size()); i++)
+        {
+            if (candidates.confs[i] >= m_class_conf_thresh)
+            {
+                order.push_back(i);
+            }
+        }
+        // 置信度相同时按下标,与stable_sort结果一致,且不需要临时缓冲区
+        std::sort(order.begin(), order.end(), [&](int a, int b)
+                  { return candidates.confs[a] > candidates.confs[b] ||
+                           (candidates.confs[a] == candidates.confs[b] && a < b); });
+
+        // 排序后的框按结构体数组存放,IoU由SIMD内核批量计算
+        const int count = static_cast<int>(order.size());
+        scratch.coords.resize(5 * count);
+        float *x1 = scratch.coords.data(), *y1 = x1 + count, *x2 = y1 + count, *y2 = x2 + count, *area = y2 + count;
+        for (int i = 0; i < count; i++)
+        {
+            const cv::Rect &rect = candidates.rects[order[i]];
+            x1[i] = static_cast<float>(rect.x);
+            y1[i] = static_cast<float>(rect.y);
+            x2[i] = static_cast<float>(rect.x + rect.width);
+            y2[i] = static_cast<float>(rect.y + rect.height);
+            area[i] = static_cast<float>(rect.area());
+        }
+        const Simd::BoxesSoA boxes{x1, y1, x2, y2, area};
+        const Simd::Kernels &kernels = Simd::kernels();
+
+        std::vector<uint8_t> &suppressed = scratch.suppressed;
+        suppressed.assign(count, 0);
+        indices.clear();
+        for (int k = 0; k < count; k++)
+        {
+            if (suppressed[k])
+            {
+                continue;
             }
+            indices.push_back(order[k]);
+            kernels.suppress_overlaps(boxes, k, k + 1, count, m_NMS_IOU_threshold, suppressed.data());
         }
+    }
+
+    std::vector<NNDetectData> YoloVino::safe_predict(const cv::Mat &ori_img, cv::Rect roi)
+    {
+        std::vector<NNDetectData> results;
+        safe_predict(ori_img, roi, results, predict_workspace);
+        return results;
+    }
+
+    void YoloVino::safe_predict(const cv::Mat &ori_img, cv::Rect roi, std::vector<NNDetectData> &results, DetectWorkspace &workspace)
+    {
+        results.clear();
+
+        // 裁剪roi,等比缩放并填充
+        if (!letterbox(ori_img, roi, workspace.final_img, workspace.info))
+        {
+            return;
+        }
+
+        // 同步推理
+        infer(workspace.final_img, workspace.info, workspace.output);
+
+        postprocess(workspace.output, workspace.info, ori_img.size(), results, workspace);
+    }
+
+    std::vector<NNDetectData> YoloVino::postprocess(const cv::Mat &output, const LetterboxInfo &info, cv::Size ori_img_size)
+    {
+        std::vector<NNDetectData> results;
+        postprocess(output, info, ori_img_size, results, predict_workspace);
+        return results;
+    }
+
+    void YoloVino::postprocess(const cv::Mat &output, const LetterboxInfo &info, cv::Size ori_img_size,
+                               std::vector<NNDetectData> &results, DetectWorkspace &workspace)
+    {
+        results.clear();
+
+        // 图内NMS没有选中任何锚框时输出为空
+        if (output.empty())
+        {
+            m_logger_ptr->YVL_LOG<LoggerInfoLevel::basic_info>(this, "未检测到结果");
+            return;
+        }
+
+        //////后处理///////
+        DecodeCandidates &candidates = workspace.candidates;
+        candidates.clear();
+        decode(output, info, candidates);
 
         // 只要任何一个容器为空,说明没有结果
-        if (class_ids_temp.empty())
+        if (candidates.empty())
         {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::basic_info, "未检测到结果");
-            return {};
+            m_logger_ptr->YVL_LOG<LoggerInfoLevel::basic_info>(this, "未检测到结果");
+            return;
         }
 
         // 非极大值抑制
-        std::vector<int> indices; // 索引容器
-        cv::dnn::NMSBoxes(rects_temp, confs_temp, m_class_conf_thresh, m_NMS_IOU_threshold, indices);
+        std::vector<int> &indices = workspace.indices; // 索引容器
+        if (info.bucket != nullptr && info.bucket->graph_nms)
+        {
+            // 网络内已经做完NMS并按得分排序,候选全部保留
+            indices.resize(candidates.confs.size());
+            std::iota(indices.begin(), indices.end(), 0);
+        }
+        else
+        {
+            nms(candidates, indices, workspace.nms);
+        }
 
         // 如果非极大值抑制后没有检测到目标直接返回
         if (indices.empty())
         {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::basic_info, "非极大值抑制后没有检测到目标");
-            return {};
+            m_logger_ptr->YVL_LOG<LoggerInfoLevel::basic_info>(this, "非极大值抑制后没有检测到目标");
+            return;
         }
 
         // 遍历indices并且处理偏移来生成最终的返回值
-        std::vector<NNDetectData> results;
-        results.reserve(indices.size());
+        const cv::Rect ori_img_bound(0, 0, ori_img_size.width, ori_img_size.height);
         for (const int &index : indices)
         {
             // 准备结果
             NNDetectData result;
 
             // 存储预测框：加上roi偏移，并且确保在图像内
-            cv::Rect rect = rects_temp[index];
-            rect.x += final_roi.x;
-            rect.y += final_roi.y;
+            cv::Rect rect = candidates.rects[index];
+            rect.x += info.final_roi.x;
+            rect.y += info.final_roi.y;
             rect &= ori_img_bound;
             if (rect.area() == 0)
             {
@@ -248,36 +797,116 @@ namespace YoloVino
             result.rect = rect;
 
             // 存储置信度
-            result.confidence = confs_temp[index];
+            result.confidence = candidates.confs[index];
 
-            // 存储置信度
-            result.class_id = class_ids_temp[index];
+            // 存储类别
+            result.class_id = candidates.class_ids[index];
 
-            // 存储关键点：钳制关键点到有效范围，避免越界访问
-            result.keypoints.reserve(4);
-            for (int i = 0; i < 4; i++)
+            // 存储关键点,由各模型决定越界的处理方式
+            if (!make_keypoints(candidates, index, info, ori_img_bound, result))
             {
-                cv::Point3f keypoint = keypoints_temp[index * 4 + i];
-                int x = keypoint.x + final_roi.x;
-                int y = keypoint.y + final_roi.y;
-                keypoint.x = std::max(0, std::min(x, ori_img.cols - 1));
-                keypoint.y = std::max(0, std::min(y, ori_img.rows - 1));
-                result.keypoints.emplace_back(cv::Point3f(x, y, keypoint.z)); // 存储关键点
+                continue;
             }
 
-            results.emplace_back(std::move(result));
+            results.push_back(result);
         }
+    }
 
-        return results;
+    void Yolov8poseVino::build_compiled_model()
+    {
+        // 读取模型并编译默认尺寸,其余尺寸在第一次使用时编译
+        build_default_bucket();
+    }
+
+    GraphNmsInputs Yolov8poseVino::graph_nms_inputs(const ov::Output<ov::Node> &output, const ov::Output<ov::Node> &)
+    {
+        // v8的关键点越界时钳制而不丢弃,不需要roi_limit
+        // 输出为[1,通道,锚框],转成按锚框排列; 第0-3通道为(cx,cy,w,h),第4-13通道为各类别的置信度
+        GraphNmsInputs inputs;
+        inputs.rows = std::make_shared<op::Transpose>(output, constant<int64_t>(ov::element::i64, {0, 2, 1}));
+        inputs.boxes = slice_channels(inputs.rows, 0, 4);
+        inputs.scores = std::make_shared<op::ReduceMax>(slice_channels(inputs.rows, 4, 14), scalar<int64_t>(ov::element::i64, 2), false);
+        inputs.center_boxes = true;
+        inputs.channels_first = true;
+        return inputs;
+    }
+
+    void Yolov8poseVino::decode(const cv::Mat &output, const LetterboxInfo &info, DecodeCandidates &candidates)
+    {
+        STAGE_TIMER(decode);
+
+        const float scale = info.scale;
+        const int pad_x = info.pad_x;
+        const int pad_y = info.pad_y;
+
+        // 输出按通道存放(通道 x 锚框),先用SIMD内核对每个锚框求第4-13行的最大类别置信度,只留下够高的锚框
+        const int anchors = output.cols;
+        scan_indices.resize(anchors);
+        scan_values.resize(anchors);
+        scan_argmax.resize(anchors);
+        const int hits = Simd::kernels().scan_column_max(output.ptr<float>(4), 10, anchors, static_cast<int>(output.step1()), m_class_conf_thresh,
+                                                         scan_indices.data(), scan_values.data(), scan_argmax.data());
+
+        for (int hit = 0; hit < hits; hit++)
+        {
+            const int archor_idx = scan_indices[hit];
+            const float max_class_conf = scan_values[hit]; // 置信度最高的类别的置信度
+            const int best_class_idx = scan_argmax[hit];   // 置信度最高的类别(0-9)
+
+            // 说明有类别的置信度够高，那么进行解码
+            float cx_temp = output.at<float>(0, archor_idx);
+            float cy_temp = output.at<float>(1, archor_idx);
+            float w_temp = output.at<float>(2, archor_idx);
+            float h_temp = output.at<float>(3, archor_idx);
+
+            // 还原到原图尺度
+            int lt_x = std::max(0.f, (((cx_temp - 0.5f * w_temp) - pad_x) / scale) + 0.5f);
+            int lt_y = std::max(0.f, (((cy_temp - 0.5f * h_temp) - pad_y) / scale) + 0.5f);
+            float w = w_temp / scale;
+            float h = h_temp / scale;
+
+            // 放入容器
+            candidates.class_ids.push_back(best_class_idx);
+            candidates.confs.push_back(max_class_conf);
+            candidates.rects.push_back(cv::Rect(lt_x, lt_y, static_cast<int>(w + 0.5), static_cast<int>(h + 0.5)));
+
+            // kepoints解码(4个关键点)
+            for (int kpt_num = 0; kpt_num < 4; kpt_num++)
+            {
+                float kpt_x_temp = output.at<float>(14 + kpt_num * 3 + 0, archor_idx); // x
+                float kpt_y_temp = output.at<float>(14 + kpt_num * 3 + 1, archor_idx); // y
+                float kpt_conf = output.at<float>(14 + kpt_num * 3 + 2, archor_idx);   // conf
+
+                // 还原到原图尺度
+                int kpt_x = std::max(0, static_cast<int>((kpt_x_temp - pad_x) / scale + 0.5f));
+                int kpt_y = std::max(0, static_cast<int>((kpt_y_temp - pad_y) / scale + 0.5f));
+
+                // 放入容器
+                candidates.keypoints.push_back(cv::Point3f(kpt_x, kpt_y, kpt_conf));
+            }
+        }
+    }
+
+    bool Yolov8poseVino::make_keypoints(const DecodeCandidates &candidates, int index, const LetterboxInfo &info, const cv::Rect &ori_img_bound, NNDetectData &result)
+    {
+        // 存储关键点：钳制关键点到有效范围，避免越界访问
+        for (int i = 0; i < NNDetectData::keypoint_count; i++)
+        {
+            cv::Point3f keypoint = candidates.keypoints[index * 4 + i];
+            int x = keypoint.x + info.final_roi.x;
+            int y = keypoint.y + info.final_roi.y;
+            keypoint.x = std::max(0, std::min(x, ori_img_bound.width - 1));
+            keypoint.y = std::max(0, std::min(y, ori_img_bound.height - 1));
+            result.keypoints[i] = cv::Point3f(x, y, keypoint.z); // 存储关键点
+        }
+        return true;
     }
 
     Yolov8poseVino::Yolov8poseVino(std::unique_ptr<YoloVinoLogger> &&logger_ptr)
-        : YoloVino(320, 2100, 26, 0.5, 0.4), // 输入尺寸,输出锚框,通道数,类别置信度阈值,NMS阈值
-          m_logger_ptr(std::move(logger_ptr))
+        : YoloVino(std::move(logger_ptr), 320, 0.5, 0.4) // 日志,输入尺寸,类别置信度阈值,NMS阈值(锚框数和通道数从模型输出读取)
     {
-        m_logger_ptr->set_owner(this);
         build_compiled_model();
-        m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::debug_info, "模", "型", "初", "始", "化", "成", "功", '!');
+        m_logger_ptr->YVL_LOG<LoggerInfoLevel::debug_info>(this, "模", "型", "初", "始", "化", "成", "功", '!');
     }
 
     inline float Yolov5fourpointVino::sigmoid(float x)
@@ -294,132 +923,74 @@ namespace YoloVino
 
     void Yolov5fourpointVino::build_compiled_model()
     {
-        // 读取模型
-        ov::Core core;
-        std::shared_ptr<ov::Model> model = core.read_model(m_logger_ptr->get_model_path());
-        ov::preprocess::PrePostProcessor ppp(model); // ppp用于自动化部分预处理和后处理流程
-
-        // 设置自动化的参数
-        ppp.input().tensor().set_element_type(ov::element::u8).set_layout("NHWC").set_color_format(ov::preprocess::ColorFormat::BGR);
-        ppp.input().preprocess().convert_element_type(ov::element::f32).convert_color(ov::preprocess::ColorFormat::RGB).scale({255.f, 255.f, 255.f});
-        ppp.input().model().set_layout("NCHW");                   // 可选,用于告知
-        ppp.output().tensor().set_element_type(ov::element::f32); // 可选,用于告知
-
-        // 获取输出格式
-        const std::vector<ov::Output<ov::Node>> outputs = model->outputs();
-        const ov::Shape output_shape = outputs[0].get_shape();
-        short height = output_shape[1];
-        short width = output_shape[2];
-        m_output_shape = cv::Size(width, height);
-
-        // 构建完整模型并加载到设备
-        m_compiled_model = core.compile_model(ppp.build(), m_logger_ptr->get_device_type());
+        // 读取模型并编译默认尺寸,其余尺寸在第一次使用时编译
+        build_default_bucket();
+    }
 
-        // 创建推理请求
-        m_infer_request = m_compiled_model.create_infer_request();
+    GraphNmsInputs Yolov5fourpointVino::graph_nms_inputs(const ov::Output<ov::Node> &output, const ov::Output<ov::Node> &roi_limit)
+    {
+        // 输出为[1,锚框,22]: 第0-7列为4个关键点,第8列为先验框置信度(未激活),第13-21列为类别得分
+        GraphNmsInputs inputs;
+        inputs.rows = output;
+
+        // 框为4个关键点的外接矩形(x1,y1,x2,y2)
+        const auto axis = scalar<int64_t>(ov::element::i64, 2);
+        auto xs = std::make_shared<op::Gather>(output, constant<int64_t>(ov::element::i64, {0, 2, 4, 6}), axis);
+        auto ys = std::make_shared<op::Gather>(output, constant<int64_t>(ov::element::i64, {1, 3, 5, 7}), axis);
+        auto max_x = std::make_shared<op::ReduceMax>(xs, axis, true);
+        auto max_y = std::make_shared<op::ReduceMax>(ys, axis, true);
+        inputs.boxes = std::make_shared<op::Concat>(ov::OutputVector{std::make_shared<op::ReduceMin>(xs, axis, true),
+                                                                     std::make_shared<op::ReduceMin>(ys, axis, true),
+                                                                     max_x, max_y},
+                                                    2);
+
+        // 与decode一致: 先验框置信度够高,最高类别不是第8类(第21列,并列时取前面的类别),4个关键点都在roi内
+        // (左上由decode钳制到0,只需检查右下); 在NMS之前判断,被丢弃的锚框不会抑制其他锚框
+        auto box_conf = std::make_shared<op::Sigmoid>(slice_channels(output, 8, 9));
+        auto class_score = std::make_shared<op::ReduceMax>(slice_channels(output, 13, 21), axis, true);
+        auto limit_x = std::make_shared<op::Gather>(roi_limit, scalar<int64_t>(ov::element::i64, 0), scalar<int64_t>(ov::element::i64, 0));
+        auto limit_y = std::make_shared<op::Gather>(roi_limit, scalar<int64_t>(ov::element::i64, 1), scalar<int64_t>(ov::element::i64, 0));
+        auto keep = std::make_shared<op::LogicalAnd>(std::make_shared<op::GreaterEqual>(box_conf, scalar<float>(ov::element::f32, m_box_conf_thresh)),
+                                                     std::make_shared<op::GreaterEqual>(class_score, slice_channels(output, 21, 22)));
+        auto inside = std::make_shared<op::LogicalAnd>(std::make_shared<op::Less>(max_x, limit_x), std::make_shared<op::Less>(max_y, limit_y));
+
+        // 得分为 先验框置信度 x sigmoid(最高类别得分), 不满足条件的锚框得分为0
+        auto score = std::make_shared<op::Multiply>(box_conf, std::make_shared<op::Sigmoid>(class_score));
+        inputs.scores = std::make_shared<op::Squeeze>(std::make_shared<op::Select>(std::make_shared<op::LogicalAnd>(keep, inside), score,
+                                                                                   scalar<float>(ov::element::f32, 0.0f)),
+                                                      axis);
+        return inputs;
     }
 
     Yolov5fourpointVino::Yolov5fourpointVino(std::unique_ptr<YoloVinoLogger> &&logger_ptr)
-        : YoloVino(640, 25200, 22, 0.5, 0.4), // 输入尺寸,输出锚框,通道数,类别置信度阈值,NMS阈值
-          m_logger_ptr(std::move(logger_ptr))
+        : YoloVino(std::move(logger_ptr), 640, 0.5, 0.4) // 日志,输入尺寸,类别置信度阈值,NMS阈值(锚框数和通道数从模型输出读取)
     {
-        m_logger_ptr->set_owner(this);
         build_compiled_model();
-        m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::debug_info, "模", "型", "初", "始", "化", "成", "功", '!');
+        m_logger_ptr->YVL_LOG<LoggerInfoLevel::debug_info>(this, "模", "型", "初", "始", "化", "成", "功", '!');
     }
 
-    std::vector<NNDetectData> Yolov5fourpointVino::safe_predict(const cv::Mat &ori_img, cv::Rect roi)
+    void Yolov5fourpointVino::decode(const cv::Mat &output, const LetterboxInfo &info, DecodeCandidates &candidates)
     {
-
-        if (ori_img.empty())
-        {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::warning_info, "传入图像为空");
-            return {};
-        }
-
-        cv::Rect ori_img_bound(0, 0, ori_img.cols, ori_img.rows);
-        cv::Rect final_roi = roi & ori_img_bound;
-        if (final_roi.area() == 0)
-        {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::warning_info, "roi落在图像外");
-            return {};
-        }
-
-        // 视图截取
-        cv::Mat src_view = ori_img(final_roi);
-
-        // 等比缩放, 并记录缩放值
-        int src_view_width = src_view.cols;
-        int src_view_height = src_view.rows;
-
-        // 计算缩放系数
-        float scale = std::min(static_cast<float>(m_target_size) / src_view_width,
-                               static_cast<float>(m_target_size) / src_view_height);
-        int new_width = static_cast<int>(src_view_width * scale);
-        int new_height = static_cast<int>(src_view_height * scale);
-
-        if (new_width == 0 || new_height == 0)
-        {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::warning_info, "原图形状过于狭长");
-            return {};
-        }
-
-        cv::Mat resized_view;
-
-        // 等比缩放，速度(INTER_NEAREST > INTER_AREA >INTER_LINEAR)
-        cv::resize(src_view, resized_view, cv::Size(new_width, new_height), 0, 0, cv::INTER_LINEAR);
-
-        // 填充, 并记录填充值
-        int pad_x = std::max(0, (m_target_size - new_width) / 2);
-        int pad_y = std::max(0, (m_target_size - new_height) / 2);
-
-        cv::Mat final_img; // 最终处理好的图片
-        cv::copyMakeBorder(resized_view, final_img,
-                           pad_y, m_target_size - new_height - pad_y, // 上下填充
-                           pad_x, m_target_size - new_width - pad_x,  // 左右填充
-                           cv::BORDER_CONSTANT, cv::Scalar(124, 124, 124));
-
-        // 极端情况：如果填充后的图像尺寸不符合目标，则再次调整尺寸
-        if (final_img.cols != m_target_size || final_img.rows != m_target_size)
-        {
-            cv::resize(final_img, final_img, cv::Size(m_target_size, m_target_size), 0, 0, cv::INTER_NEAREST);
-        }
-
-        // 转化到输入张量
-        ov::Tensor input_tensor = ov::Tensor(
-            m_compiled_model.input().get_element_type(),
-            m_compiled_model.input().get_shape(),
-            final_img.data);
-
-        cv::Mat output; // 准备接受输出
-        {
-            std::lock_guard<std::mutex> lock(m_infer_mutex);
-            // 设置输入//需要注意的是，这里只是绑定input的数据到推理流，所以input的生命周期不能小于这次推理
-            m_infer_request.set_input_tensor(input_tensor);
-
-            // 进行同步推理
-            m_infer_request.infer();
-
-            // 获取推理结果指针,转化到矩阵形式便于遍历
-            const float *output_data_ptr = m_infer_request.get_output_tensor().data<const float>();
-            output = cv::Mat(m_output_shape, CV_32F, (float *)output_data_ptr).clone();
-        }
-
-        //////后处理///////
-
-        std::vector<int> class_ids_temp;                      // 类别容器
-        std::vector<cv::Rect> rects_temp;                     // rect容器
-        std::vector<float> confs_temp;                        // conf容器
-        std::vector<std::vector<cv::Point2i>> keypoints_temp; // keypoints容器
-
-        for (int archor_idx = 0; archor_idx < m_archors_num; archor_idx++)
+        STAGE_TIMER(decode);
+
+        // 关键点在roi内的坐标,roi偏移在make_keypoints中才加上,所以按roi自身的范围检查
+        const cv::Rect roi_bound(0, 0, info.final_roi.width, info.final_roi.height);
+        const float scale = info.scale;
+        const int pad_x = info.pad_x;
+        const int pad_y = info.pad_y;
+
+        // sigmoid单调, sigmoid(x) >= t 等价于 x >= ln(t/(1-t)),
+        // 先用SIMD内核在第8列的原始值上筛出先验框置信度够高的锚框,只对它们求sigmoid
+        const int anchors = output.rows;
+        const float box_logit_thresh = std::log(m_box_conf_thresh / (1.0f - m_box_conf_thresh));
+        scan_indices.resize(anchors);
+        const int hits = Simd::kernels().scan_strided(output.ptr<float>(0) + 8, anchors, static_cast<int>(output.step1()), box_logit_thresh,
+                                                      scan_indices.data());
+
+        for (int hit = 0; hit < hits; hit++)
         {
-            // 检查先验预测框的置信度是否满足阈值
+            const int archor_idx = scan_indices[hit];
             float box_confidence = sigmoid(output.at<float>(archor_idx, 8));
-            if (box_confidence < m_box_conf_thresh)
-            {
-                continue;
-            }
 
             // 获取颜色和类别的最高得分
             cv::Mat color_scores = output.row(archor_idx).colRange(9, 12); // 不要12,12表示purple
@@ -434,8 +1005,8 @@ namespace YoloVino
             }
 
             // 关键点解码
-            std::vector<cv::Point2i> fourpoint;
-            fourpoint.reserve(4);
+            cv::Point2i fourpoint[4];
+            int fourpoint_num = 0;
             for (int kpt_num = 0; kpt_num < 4; kpt_num++)
             {
                 float kpt_x_temp = output.at<float>(archor_idx, kpt_num * 2 + 0); // x
@@ -444,96 +1015,48 @@ namespace YoloVino
                 int kpt_x = std::max(0, static_cast<int>((kpt_x_temp - pad_x) / scale + 0.5f));
                 int kpt_y = std::max(0, static_cast<int>((kpt_y_temp - pad_y) / scale + 0.5f));
 
-                // 检查关键点是否在图像范围内
-                if (!final_roi.contains(cv::Point(kpt_x, kpt_y)))
+                // 检查关键点是否在roi范围内
+                if (!roi_bound.contains(cv::Point(kpt_x, kpt_y)))
                 {
                     continue;
                 }
                 // 在的话放入
-                fourpoint.emplace_back(kpt_x, kpt_y);
+                fourpoint[fourpoint_num++] = cv::Point2i(kpt_x, kpt_y);
             }
 
             // 如果没有到4个点说明装甲板在视图范围外,直接跳过
-            if (fourpoint.size() != 4)
+            if (fourpoint_num != 4)
             {
                 continue;
             }
 
             // 将解码的数据放入容器
-            class_ids_temp.emplace_back(class_id.x);
-            rects_temp.emplace_back(cv::boundingRect(fourpoint));
-            confs_temp.emplace_back(box_confidence * sigmoid(static_cast<float>(score_num)));
-            keypoints_temp.emplace_back(fourpoint);
-        }
-
-        // 只要任何一个容器为空,说明没有结果
-        if (class_ids_temp.empty())
-        {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::basic_info, "未检测到结果");
-            return {};
-        }
-
-        // 非极大值抑制
-        std::vector<int> indices; // 索引容器
-        cv::dnn::NMSBoxes(rects_temp, confs_temp, m_class_conf_thresh, m_NMS_IOU_threshold, indices);
-
-        // 如果非极大值抑制后没有检测到目标直接返回
-        if (indices.empty())
-        {
-            m_logger_ptr->YVL_LOG(this, LoggerInfoLevel::basic_info, "非极大值抑制后没有检测到目标");
-            return {};
-        }
-
-        // 遍历indices并且处理偏移来生成最终的返回值
-        std::vector<NNDetectData> results;
-        results.reserve(indices.size());
-        for (const int &index : indices)
-        {
-            // 准备结果
-            NNDetectData result;
-
-            // 存储预测框：加上roi偏移，并且确保在图像内
-            cv::Rect rect = rects_temp[index];
-            rect.x += final_roi.x;
-            rect.y += final_roi.y;
-            rect &= ori_img_bound;
-            if (rect.area() == 0)
+            candidates.class_ids.emplace_back(class_id.x);
+            candidates.rects.emplace_back(cv::boundingRect(cv::Mat(4, 1, CV_32SC2, fourpoint)));
+            candidates.confs.emplace_back(box_confidence * sigmoid(static_cast<float>(score_num)));
+            for (const cv::Point2i &point : fourpoint)
             {
-                continue;
+                candidates.keypoints.emplace_back(point.x, point.y, 1);
             }
-            result.rect = rect;
-
-            // 存储置信度
-            result.confidence = confs_temp[index];
-
-            // 存储置信度
-            result.class_id = class_ids_temp[index];
+        }
+    }
 
-            // 存储关键点：钳制关键点到有效范围，避免越界访问
-            std::vector<cv::Point3f> keypoints;
-            keypoints.reserve(4);
-            for (auto keypoint : keypoints_temp[index])
+    bool Yolov5fourpointVino::make_keypoints(const DecodeCandidates &candidates, int index, const LetterboxInfo &info, const cv::Rect &ori_img_bound, NNDetectData &result)
+    {
+        // 加上ROI偏移,4个点都在图像内才保留
+        for (int i = 0; i < NNDetectData::keypoint_count; i++)
+        {
+            const cv::Point3f &keypoint = candidates.keypoints[index * 4 + i];
+            int x = keypoint.x + info.final_roi.x; // 加上ROI偏移
+            int y = keypoint.y + info.final_roi.y;
+            if (!ori_img_bound.contains(cv::Point(x, y)))
             {
-                int x = keypoint.x + final_roi.x; // 加上ROI偏移
-                int y = keypoint.y + final_roi.y;
-                if (!ori_img_bound.contains(cv::Point(x, y)))
-                {
-                    continue;
-                }
-
-                keypoints.emplace_back(x, y, 1);
-            }
-            if (keypoints.size() != 4)
-            {   
-                continue;
+                return false;
             }
-            result.keypoints = keypoints; // 说明4个点都在范围内，可以存储
 
-            // 放到最终返回结果中
-            results.emplace_back(std::move(result));
+            result.keypoints[i] = cv::Point3f(x, y, 1);
         }
-
-        return results;
+        return true; // 说明4个点都在范围内
     }
 
-} // namespace YoloVino
\ No newline at end of file
+} // namespace YoloVino
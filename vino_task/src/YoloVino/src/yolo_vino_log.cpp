@@ -0,0 +1,169 @@
+#include "yolo_vino_log.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace YoloVino
+{
+
+    namespace
+    {
+        int64_t steady_now_ns()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        // FNV-1a,用于判断是否为重复日志
+        uint64_t record_hash(const LogRecord &record)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            hash = (hash ^ static_cast<uint64_t>(record.level)) * 1099511628211ull;
+            for (uint16_t i = 0; i < record.length; i++)
+            {
+                hash = (hash ^ static_cast<unsigned char>(record.text[i])) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        const char *level_tag(LoggerInfoLevel level)
+        {
+            switch (level)
+            {
+            case LoggerInfoLevel::debug_info:
+                return "[NN_DEBUG]";
+            case LoggerInfoLevel::basic_info:
+                return "[NN_INFO]";
+            default:
+                return "[NN_WARNING]";
+            }
+        }
+    } // namespace
+
+    LogSink &LogSink::instance()
+    {
+        static LogSink sink;
+        return sink;
+    }
+
+    LogSink::LogSink()
+    {
+        m_worker = std::thread(&LogSink::run, this);
+    }
+
+    LogSink::~LogSink()
+    {
+        m_running = false;
+        if (m_worker.joinable())
+        {
+            m_worker.join();
+        }
+        flush();
+    }
+
+    LogSink::ThreadState::~ThreadState()
+    {
+        if (ring)
+        {
+            ring->orphaned.store(true, std::memory_order_release);
+        }
+    }
+
+    LogSink::ThreadState &LogSink::thread_state()
+    {
+        thread_local ThreadState state;
+        if (!state.ring)
+        {
+            // 每个线程只在第一次记录日志时注册一次
+            state.ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> lock(m_rings_mutex);
+            m_rings.push_back(state.ring);
+        }
+        return state;
+    }
+
+    void LogSink::submit(LogRecord &record)
+    {
+        ThreadState &state = thread_state();
+
+        // 限流: 时间窗内的重复内容只计数不写入
+        const int64_t now_ns = steady_now_ns();
+        const uint64_t hash = record_hash(record);
+        if (hash == state.last_hash &&
+            now_ns - state.last_ns < m_rate_limit_ns.load(std::memory_order_relaxed))
+        {
+            state.suppressed++;
+            return;
+        }
+
+        record.repeated = state.suppressed;
+        if (state.ring->try_push(record))
+        {
+            state.suppressed = 0;
+            state.last_hash = hash;
+            state.last_ns = now_ns;
+        }
+    }
+
+    void LogSink::drain(std::string &out)
+    {
+        std::vector<std::shared_ptr<LogRing>> rings;
+        {
+            std::lock_guard<std::mutex> lock(m_rings_mutex);
+            rings = m_rings;
+        }
+
+        LogRecord record;
+        for (const std::shared_ptr<LogRing> &ring : rings)
+        {
+            // 先读标记再清空,保证回收时缓冲里已经没有遗漏
+            const bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+            while (ring->try_pop(record))
+            {
+                if (record.repeated > 0)
+                {
+                    out += "[NN_LOG]上一条日志重复了" + std::to_string(record.repeated) + "次\n";
+                }
+                out += level_tag(record.level);
+                out.append(record.text, record.length);
+                out += '\n';
+            }
+
+            const uint64_t dropped = ring->take_dropped();
+            if (dropped > 0)
+            {
+                out += "[NN_LOG]日志缓冲已满,丢弃" + std::to_string(dropped) + "条\n";
+            }
+
+            if (orphaned)
+            {
+                std::lock_guard<std::mutex> lock(m_rings_mutex);
+                m_rings.erase(std::remove(m_rings.begin(), m_rings.end(), ring), m_rings.end());
+            }
+        }
+    }
+
+    void LogSink::flush()
+    {
+        std::string out;
+        {
+            std::lock_guard<std::mutex> lock(m_drain_mutex);
+            drain(out);
+        }
+        if (!out.empty())
+        {
+            std::cout << out << std::flush;
+        }
+    }
+
+    void LogSink::run()
+    {
+        while (m_running.load(std::memory_order_relaxed))
+        {
+            flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+} // namespace YoloVino
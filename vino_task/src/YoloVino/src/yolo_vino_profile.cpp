@@ -0,0 +1,191 @@
+#include "yolo_vino.hpp"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+namespace YoloVino
+{
+
+    namespace
+    {
+        // 从实现名中取出执行精度,例如 jit_avx2_FP32 -> FP32
+        std::string exec_precision(const std::string &exec_type)
+        {
+            size_t pos = exec_type.find_last_of('_');
+            if (pos == std::string::npos)
+            {
+                return "";
+            }
+            std::string precision = exec_type.substr(pos + 1);
+            for (const char *known : {"FP32", "FP16", "BF16", "I8", "U8", "I32", "I64", "U1"})
+            {
+                if (precision == known)
+                {
+                    return precision;
+                }
+            }
+            return "";
+        }
+    } // namespace
+
+    void YoloVino::collect_profiling(ov::InferRequest &infer_request)
+    {
+        for (const ov::ProfilingInfo &info : infer_request.get_profiling_info())
+        {
+            if (info.status == ov::ProfilingInfo::Status::NOT_RUN)
+            {
+                continue;
+            }
+            LayerProfile &layer = m_layer_profiles[info.node_name];
+            layer.node_type = info.node_type;
+            layer.exec_type = info.exec_type;
+            layer.real_us += info.real_time.count();
+            layer.cpu_us += info.cpu_time.count();
+            layer.count++;
+        }
+
+        m_profiled_frames++;
+        if (m_profiled_frames >= m_profiling_frames)
+        {
+            write_profiling_report();
+            m_profiling_frames = 0; // 统计完成,后续帧不再收集
+            m_profiling_compile.store(false, std::memory_order_relaxed);
+            recompile_unprofiled();
+        }
+    }
+
+    void YoloVino::recompile_unprofiled()
+    {
+        // enable_profiling在编译时确定,打开后每次推理都要计时; 统计完成后在后台重新编译已缓存的尺寸,编译期间继续用旧模型
+        if (m_unprofile_future.valid() && m_unprofile_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return;
+        }
+        std::vector<std::pair<int, int>> keys;
+        for (const auto &entry : m_buckets)
+        {
+            if (entry.second.profiling && m_unprofiled_buckets.count(entry.first) == 0)
+            {
+                keys.push_back(entry.first);
+            }
+        }
+        if (keys.empty())
+        {
+            return;
+        }
+        m_unprofile_future = std::async(std::launch::async, [this, keys]()
+                                        {
+            for (const std::pair<int, int> &key : keys)
+            {
+                try
+                {
+                    InferBucket bucket = compile_bucket(cv::Size(key.first, key.second));
+                    std::lock_guard<std::mutex> lock(m_infer_mutex);
+                    m_unprofiled_buckets.emplace(key, std::move(bucket));
+                }
+                catch (const std::exception &e)
+                {
+                    // 编译失败时继续使用带统计的模型,只是多一些开销; 不再重试该尺寸
+                    m_logger_ptr->YVL_LOG<LoggerInfoLevel::warning_info>(this, "重新编译不带统计的模型失败: ", e.what());
+                    std::lock_guard<std::mutex> lock(m_infer_mutex);
+                    auto it = m_buckets.find(key);
+                    if (it != m_buckets.end())
+                    {
+                        it->second.profiling = false;
+                    }
+                }
+            } });
+    }
+
+    void YoloVino::swap_unprofiled(InferBucket &bucket)
+    {
+        auto it = m_unprofiled_buckets.find({bucket.input_size.width, bucket.input_size.height});
+        if (it == m_unprofiled_buckets.end())
+        {
+            // 还没编译好,或者是统计完成前后台编译出来的尺寸(再提交一次,编译中时忽略)
+            recompile_unprofiled();
+            return;
+        }
+        // 只替换推理锁内才访问的成员: input_size/output_shape/graph_nms等会被letterbox和后处理线程不加锁读取,
+        // 不能整体赋值; 输出格式与原模型不同(例如这次图内NMS构建失败)时放弃替换,继续用带统计的模型
+        InferBucket &unprofiled = it->second;
+        if (unprofiled.output_shape == bucket.output_shape && unprofiled.graph_nms == bucket.graph_nms &&
+            unprofiled.roi_limit_input == bucket.roi_limit_input)
+        {
+            bucket.compiled_model = std::move(unprofiled.compiled_model);
+            bucket.infer_request = std::move(unprofiled.infer_request); // 输入张量只包装输入缓冲区,缓存可以继续用
+        }
+        bucket.profiling = false;
+        m_unprofiled_buckets.erase(it);
+    }
+
+    void YoloVino::write_profiling_report()
+    {
+        if (m_layer_profiles.empty() || m_profiled_frames == 0)
+        {
+            return;
+        }
+
+        // 逐层,按平均耗时从大到小排序
+        std::vector<std::pair<std::string, LayerProfile>> layers(m_layer_profiles.begin(), m_layer_profiles.end());
+        std::sort(layers.begin(), layers.end(), [](const auto &a, const auto &b)
+                  { return a.second.real_us > b.second.real_us; });
+
+        // 按(层类型,实现)汇总
+        std::map<std::pair<std::string, std::string>, LayerProfile> primitives;
+        double total_us = 0.0;
+        for (const auto &[name, layer] : layers)
+        {
+            LayerProfile &primitive = primitives[{layer.node_type, layer.exec_type}];
+            primitive.node_type = layer.node_type;
+            primitive.exec_type = layer.exec_type;
+            primitive.real_us += layer.real_us;
+            primitive.cpu_us += layer.cpu_us;
+            primitive.count += layer.count;
+            total_us += layer.real_us;
+        }
+        std::vector<LayerProfile> primitive_list;
+        for (const auto &[key, primitive] : primitives)
+        {
+            primitive_list.push_back(primitive);
+        }
+        std::sort(primitive_list.begin(), primitive_list.end(), [](const LayerProfile &a, const LayerProfile &b)
+                  { return a.real_us > b.real_us; });
+
+        const double frames = m_profiled_frames;
+        const std::string &report_path = m_logger_ptr->get_profiling_report();
+        std::ofstream csv(report_path);
+        csv << "section,name,node_type,exec_type,precision,avg_real_us,avg_cpu_us,percent,count\n";
+        for (const auto &[name, layer] : layers)
+        {
+            csv << "layer," << name << ',' << layer.node_type << ',' << layer.exec_type << ','
+                << exec_precision(layer.exec_type) << ',' << layer.real_us / frames << ','
+                << layer.cpu_us / frames << ',' << 100.0 * layer.real_us / total_us << ',' << layer.count << '\n';
+        }
+        for (const LayerProfile &primitive : primitive_list)
+        {
+            csv << "primitive,," << primitive.node_type << ',' << primitive.exec_type << ','
+                << exec_precision(primitive.exec_type) << ',' << primitive.real_us / frames << ','
+                << primitive.cpu_us / frames << ',' << 100.0 * primitive.real_us / total_us << ',' << primitive.count << '\n';
+        }
+
+        // 控制台只打印按类型汇总的表和最慢的10层
+        std::cout << "========== YoloVino Layer Profile (" << m_profiled_frames << " frames, "
+                  << total_us / frames << " us/frame) ==========\n";
+        std::printf("%-22s %-28s %10s %7s\n", "node_type", "exec_type", "avg_us", "%");
+        for (const LayerProfile &primitive : primitive_list)
+        {
+            std::printf("%-22s %-28s %10.1f %6.1f%%\n", primitive.node_type.c_str(), primitive.exec_type.c_str(),
+                        primitive.real_us / frames, 100.0 * primitive.real_us / total_us);
+        }
+        std::printf("---------- slowest layers ----------\n");
+        for (size_t i = 0; i < layers.size() && i < 10; i++)
+        {
+            const auto &[name, layer] = layers[i];
+            std::printf("%-40s %-22s %-20s %8.1f us\n", name.c_str(), layer.node_type.c_str(),
+                        layer.exec_type.c_str(), layer.real_us / frames);
+        }
+        std::cout << "完整报告: " << report_path << std::endl;
+    }
+
+} // namespace YoloVino
@@ -0,0 +1,168 @@
+#include "FrameBus.h"
+#include "VisualSink.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <thread>
+
+// 帧总线读者: 只读映射Task8 --frame-bus发布的共享内存,显示最新帧并统计帧率、跳帧和延迟
+// 用法: frame_bus_viewer [--bus 名称] [--record 文件.avi] [--headless]
+// 读者跟不上时直接取最新帧,跳过的帧计入跳帧,不影响采集进程
+
+namespace
+{
+    volatile std::sig_atomic_t stop_signal = 0;
+
+    void handle_signal(int)
+    {
+        stop_signal = 1;
+    }
+
+    struct Options
+    {
+        std::string bus = "task8_frames"; // 总线名称
+        std::string record;               // 录像文件,为空时不录像
+    };
+
+    bool parse_options(int argc, char const *argv[], Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--bus" && i + 1 < argc) options.bus = argv[++i];
+            else if (arg == "--record" && i + 1 < argc) options.record = argv[++i];
+            else if (arg == "--headless") Visual::set_headless(true);
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+} // namespace
+
+int main(int argc, char const *argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cout << "用法: frame_bus_viewer [--bus 名称] [--record 文件.avi] [--headless]" << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, handle_signal);
+
+    // 采集进程可能还没有启动,等待总线出现
+    std::unique_ptr<FrameBus::Reader> reader;
+    while (!stop_signal && !(reader = FrameBus::Reader::open(options.bus)))
+    {
+        std::cout << "等待帧总线 " << options.bus << " ..." << std::endl;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    if (!reader)
+    {
+        return 0;
+    }
+    std::cout << "已连接帧总线 " << options.bus << ", " << reader->get_slot_count() << " 个槽位" << std::endl;
+
+    cv::VideoWriter writer;
+    FrameBus::FrameView view;
+    cv::Mat copy;
+    uint64_t last_sequence = reader->get_latest_sequence();
+    uint64_t received = 0, skipped = 0, overwritten = 0;
+    uint64_t window_frames = 0;
+    double window_latency_ms = 0.0;
+    auto window_start = std::chrono::steady_clock::now();
+
+    while (!stop_signal)
+    {
+        if (!reader->wait(last_sequence, 500))
+        {
+            if (reader->writer_closed())
+            {
+                std::cout << "采集进程已关闭帧总线" << std::endl;
+                break;
+            }
+            continue;
+        }
+
+        // 录像需要完整的一帧,拷贝出来; 只显示时直接使用共享内存中的图像
+        FrameBus::FrameMeta meta;
+        cv::Mat image;
+        const bool zero_copy = options.record.empty();
+        if (!zero_copy)
+        {
+            if (!reader->read_copy(copy, meta, last_sequence))
+            {
+                continue;
+            }
+            image = copy;
+        }
+        else
+        {
+            if (!reader->latest(view, last_sequence))
+            {
+                continue;
+            }
+            meta = view.meta;
+            image = view.image;
+        }
+
+        if (last_sequence != 0 && meta.sequence > last_sequence + 1)
+        {
+            skipped += meta.sequence - last_sequence - 1;
+        }
+        last_sequence = meta.sequence;
+        received++;
+        window_frames++;
+        window_latency_ms += (now_ns() - meta.timestamp_ns) * 1e-6;
+
+        if (!options.record.empty() && !writer.isOpened())
+        {
+            writer.open(options.record, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30.0, image.size(), image.channels() == 3);
+            if (!writer.isOpened())
+            {
+                std::cout << "无法打开录像文件 " << options.record << std::endl;
+                options.record.clear();
+            }
+        }
+        if (writer.isOpened())
+        {
+            writer.write(image);
+        }
+
+        if (!Visual::is_headless())
+        {
+            cv::imshow("frame_bus", image);
+            // 显示期间槽位被覆盖时画面可能撕裂,只计数不重画
+            if (zero_copy && !reader->still_valid(view))
+            {
+                overwritten++;
+            }
+            if (cv::waitKey(1) == 27)
+            {
+                break;
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double>(now - window_start).count();
+        if (elapsed >= 1.0)
+        {
+            std::cout << "fps " << window_frames / elapsed
+                      << "  延迟 " << window_latency_ms / window_frames << " ms"
+                      << "  已收 " << received << "  跳帧 " << skipped << "  显示中被覆盖 " << overwritten << std::endl;
+            window_start = now;
+            window_frames = 0;
+            window_latency_ms = 0.0;
+        }
+    }
+
+    std::cout << "共收到 " << received << " 帧, 跳过 " << skipped << " 帧" << std::endl;
+    return 0;
+}
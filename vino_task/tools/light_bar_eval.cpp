@@ -0,0 +1,257 @@
+#include "yolo_vino.hpp"
+#include "light_bar_proposer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+// 灯条候选区域的评估工具: 在一段录像(或图片目录)上分别做整帧推理和灯条候选区域推理,
+// 以整帧推理的结果为参考,统计候选区域推理的召回率、网络输入像素的比例和每帧耗时
+// light_bar_eval --frames <录像|目录> [--model v8|v5] [--config yaml] [--light-bar-config yaml] [--iou 0.5] [--max-frames N]
+// 候选区域漏检的主要来源: 灯条被遮挡或过曝(靠周期整帧推理找回),颜色阈值与场地光照不符(调min_value/min_diff)
+// 另外单独统计推理区域不含原点的帧: 这类帧的召回明显偏低说明检测器对roi偏移的处理有问题,而不是候选区域的质量
+
+namespace
+{
+    struct Options
+    {
+        std::string model = "v5";       // v8或v5
+        std::string config;             // 模型配置文件,为空时使用默认配置
+        std::string light_bar_config;   // 灯条参数,为空时使用默认配置
+        std::string frames;             // 录像文件或图片目录
+        float iou = 0.5f;               // 与参考检测匹配的IoU下限
+        int max_frames = 0;             // 最多处理的帧数,0为全部
+    };
+
+    struct Recall
+    {
+        uint64_t reference = 0; // 参考检测数
+        uint64_t matched = 0;   // 被候选区域推理检出的数目
+
+        double rate() const { return reference > 0 ? static_cast<double>(matched) / reference : 1.0; }
+    };
+
+    void print_usage()
+    {
+        std::cout << "用法: light_bar_eval --frames <录像|目录> [--model v8|v5] [--config yaml] [--light-bar-config yaml]\n"
+                  << "                      [--iou 0.5] [--max-frames N]\n";
+    }
+
+    bool parse_options(int argc, char const *argv[], Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string
+            { return i + 1 < argc ? argv[++i] : ""; };
+
+            if (arg == "--model") options.model = next();
+            else if (arg == "--config") options.config = next();
+            else if (arg == "--light-bar-config") options.light_bar_config = next();
+            else if (arg == "--frames") options.frames = next();
+            else if (arg == "--iou") options.iou = std::stof(next());
+            else if (arg == "--max-frames") options.max_frames = std::max(0, std::stoi(next()));
+            else
+            {
+                return false;
+            }
+        }
+        return !options.frames.empty() && (options.model == "v8" || options.model == "v5");
+    }
+
+    std::unique_ptr<YoloVino::YoloVino> make_detector(const Options &options)
+    {
+        std::string config = options.config;
+        if (config.empty())
+        {
+            config = std::string(YOLOVINO_CONFIG_DIR) +
+                     (options.model == "v8" ? "/yolov8pose_vino_config.yaml" : "/yolov5fourpoint_vino_config.yaml");
+        }
+        auto logger = std::make_unique<YoloVino::YoloVinoLogger>(config);
+        logger->set_info_level(YoloVino::LoggerInfoLevel::warning_info);
+        if (options.model == "v8")
+        {
+            return std::make_unique<YoloVino::Yolov8poseVino>(std::move(logger));
+        }
+        return std::make_unique<YoloVino::Yolov5fourpointVino>(std::move(logger));
+    }
+
+    // 按顺序读取录像或目录下的图片(按文件名排序)
+    class FrameSource
+    {
+    private:
+        cv::VideoCapture m_capture;
+        std::vector<cv::String> m_files;
+        size_t m_next = 0;
+
+    public:
+        bool open(const std::string &path)
+        {
+            for (const char *pattern : {"/*.png", "/*.jpg", "/*.bmp"})
+            {
+                std::vector<cv::String> found;
+                cv::glob(path + pattern, found, false);
+                m_files.insert(m_files.end(), found.begin(), found.end());
+            }
+            if (!m_files.empty())
+            {
+                std::sort(m_files.begin(), m_files.end());
+                return true;
+            }
+            return m_capture.open(path);
+        }
+
+        bool read(cv::Mat &frame)
+        {
+            if (m_capture.isOpened())
+            {
+                return m_capture.read(frame) && !frame.empty();
+            }
+            while (m_next < m_files.size())
+            {
+                frame = cv::imread(m_files[m_next++]);
+                if (!frame.empty())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    float iou(const cv::Rect &a, const cv::Rect &b)
+    {
+        const float inter = static_cast<float>((a & b).area());
+        const float uni = static_cast<float>(a.area() + b.area()) - inter;
+        return uni > 0.0f ? inter / uni : 0.0f;
+    }
+
+    // 每个参考检测找同类别、IoU最大且未被使用的检测
+    uint64_t count_matched(const std::vector<YoloVino::NNDetectData> &reference, const std::vector<YoloVino::NNDetectData> &detections, float min_iou)
+    {
+        uint64_t matched = 0;
+        std::vector<bool> used(detections.size(), false);
+        for (const auto &expected : reference)
+        {
+            int best = -1;
+            float best_iou = min_iou;
+            for (size_t i = 0; i < detections.size(); i++)
+            {
+                if (used[i] || detections[i].class_id != expected.class_id)
+                {
+                    continue;
+                }
+                const float overlap = iou(detections[i].rect, expected.rect);
+                if (overlap >= best_iou)
+                {
+                    best_iou = overlap;
+                    best = static_cast<int>(i);
+                }
+            }
+            if (best >= 0)
+            {
+                used[best] = true;
+                matched++;
+            }
+        }
+        return matched;
+    }
+
+    double median(std::vector<double> values)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        return values[values.size() / 2];
+    }
+
+    double elapsed_ms(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+} // namespace
+
+int main(int argc, char const *argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage();
+        return 2;
+    }
+
+    std::unique_ptr<YoloVino::YoloVino> vino = make_detector(options);
+    vino->warm_up();
+    const YoloVino::LightBarConfig light_bar_config = options.light_bar_config.empty() ? YoloVino::LightBarConfig()
+                                                                                       : YoloVino::LightBarConfig::load(options.light_bar_config);
+    YoloVino::LightBarDetector detector(*vino, light_bar_config);
+    if (!vino->is_dynamic_shape())
+    {
+        std::cout << "注意: 模型没有打开dynamic_shape,每个候选区域仍按完整输入尺寸推理\n";
+    }
+
+    FrameSource source;
+    if (!source.open(options.frames))
+    {
+        std::cout << "无法打开 " << options.frames << "\n";
+        return 1;
+    }
+
+    std::vector<YoloVino::NNDetectData> reference, detections;
+    YoloVino::DetectWorkspace workspace;
+    Recall all, proposed, off_origin;
+    std::vector<double> full_ms, light_bar_ms;
+    cv::Mat frame;
+    int frame_count = 0;
+    while ((options.max_frames == 0 || frame_count < options.max_frames) && source.read(frame))
+    {
+        frame_count++;
+
+        auto start = std::chrono::steady_clock::now();
+        vino->safe_predict(frame, cv::Rect(0, 0, frame.cols, frame.rows), reference, workspace);
+        full_ms.push_back(elapsed_ms(start));
+
+        // 本帧是否为整帧推理(周期帧或没有候选时整帧),只统计候选区域帧的召回才能看出候选的质量
+        const uint64_t full_before = detector.get_stats().full_frames;
+        const uint64_t empty_before = detector.get_stats().empty_frames;
+        start = std::chrono::steady_clock::now();
+        detector.predict(frame, detections);
+        light_bar_ms.push_back(elapsed_ms(start));
+        const bool full_frame = detector.get_stats().full_frames != full_before;
+
+        const uint64_t matched = count_matched(reference, detections, options.iou);
+        all.reference += reference.size();
+        all.matched += matched;
+        if (!full_frame)
+        {
+            proposed.reference += reference.size();
+            proposed.matched += matched;
+
+            const std::vector<cv::Rect> &rois = detector.get_rois();
+            const bool offset = std::none_of(rois.begin(), rois.end(), [](const cv::Rect &roi)
+                                             { return roi.x == 0 && roi.y == 0; });
+            if (empty_before == detector.get_stats().empty_frames && offset)
+            {
+                off_origin.reference += reference.size();
+                off_origin.matched += matched;
+            }
+        }
+    }
+    if (frame_count == 0)
+    {
+        std::cout << "没有读到任何帧\n";
+        return 1;
+    }
+
+    detector.get_stats().print();
+    std::printf("========== 灯条候选区域评估 ==========\n");
+    std::printf("帧数 %d, 参考检测 %llu (IoU >= %.2f 视为检出)\n", frame_count, static_cast<unsigned long long>(all.reference), options.iou);
+    std::printf("召回率: 全部帧 %.2f%%, 候选区域帧 %.2f%% (%llu/%llu)\n", 100.0 * all.rate(), 100.0 * proposed.rate(),
+                static_cast<unsigned long long>(proposed.matched), static_cast<unsigned long long>(proposed.reference));
+    std::printf("          推理区域不含原点的帧 %.2f%% (%llu/%llu)\n", 100.0 * off_origin.rate(),
+                static_cast<unsigned long long>(off_origin.matched), static_cast<unsigned long long>(off_origin.reference));
+    std::printf("每帧耗时中位数: 整帧推理 %.3f ms, 灯条候选区域 %.3f ms\n", median(full_ms), median(light_bar_ms));
+    return 0;
+}
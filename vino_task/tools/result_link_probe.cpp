@@ -0,0 +1,205 @@
+#include "ResultLink.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// 结果输出通道的接收/测速工具
+// 接收: result_link_probe --listen udp://127.0.0.1:9000 [--verbose]
+//       统计Task8 --result-link发来的消息: 每秒消息数、发送到接收的延迟、采集到接收的延迟、丢失的帧
+// 测速: result_link_probe --bench unix:///tmp/task8_results.sock [--count N] [--armors K] [--rate Hz]
+//       本进程内一个线程发送、一个线程接收,输出延迟分位数和吞吐量
+//       --rate 0 不限速,测最大吞吐量(Unix数据报队列很短,接收跟不上时发送失败)
+
+namespace
+{
+    volatile std::sig_atomic_t stop_signal = 0;
+
+    void handle_signal(int)
+    {
+        stop_signal = 1;
+    }
+
+    struct Options
+    {
+        std::string listen_uri;  // 接收模式的地址
+        std::string bench_uri;   // 测速模式的地址
+        int count = 10000;       // 测速发送的消息数
+        int armors = 4;          // 测速每条消息的装甲板数
+        double rate = 1000.0;    // 测速发送频率(Hz),0为不限速
+        bool verbose = false;    // 接收模式打印每条消息
+    };
+
+    bool parse_options(int argc, char const *argv[], Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string
+            { return i + 1 < argc ? argv[++i] : ""; };
+
+            if (arg == "--listen") options.listen_uri = next();
+            else if (arg == "--bench") options.bench_uri = next();
+            else if (arg == "--count") options.count = std::max(1, std::stoi(next()));
+            else if (arg == "--armors") options.armors = std::min(std::max(0, std::stoi(next())), ResultLink::MAX_ARMORS);
+            else if (arg == "--rate") options.rate = std::max(0.0, std::stod(next()));
+            else if (arg == "--verbose") options.verbose = true;
+            else
+            {
+                return false;
+            }
+        }
+        return options.listen_uri.empty() != options.bench_uri.empty();
+    }
+
+    // 排序后的分位数(us)
+    double percentile_us(std::vector<int64_t> &latencies_ns, double p)
+    {
+        if (latencies_ns.empty())
+        {
+            return 0.0;
+        }
+        const size_t index = std::min(latencies_ns.size() - 1, static_cast<size_t>(p * latencies_ns.size()));
+        std::nth_element(latencies_ns.begin(), latencies_ns.begin() + index, latencies_ns.end());
+        return latencies_ns[index] * 1e-3;
+    }
+
+    void print_message(const ResultLink::Message &message)
+    {
+        std::printf("帧 %llu: %d 块装甲板, 质量等级 %d\n", static_cast<unsigned long long>(message.header.frame_id), message.header.count,
+                    message.header.quality_level);
+        for (int i = 0; i < message.header.count; i++)
+        {
+            const ResultLink::ArmorRecord &armor = message.armors[i];
+            std::printf("  #%d 类别 %d 置信度 %.2f 距离 %.2f m yaw %.2f pitch %.2f roll %.2f%s\n",
+                        armor.track_id, armor.class_id, armor.confidence, armor.distance,
+                        armor.yaw, armor.pitch, armor.roll, armor.pose_valid ? "" : " (位姿无效)");
+        }
+    }
+
+    int listen(const Options &options)
+    {
+        auto receiver = ResultLink::Receiver::bind(options.listen_uri);
+        if (!receiver)
+        {
+            return 1;
+        }
+        std::cout << "正在接收 " << options.listen_uri << ", Ctrl+C退出" << std::endl;
+
+        ResultLink::Message message;
+        std::vector<int64_t> link_ns, total_ns;
+        uint64_t received = 0, lost = 0, last_frame = 0;
+        auto window_start = std::chrono::steady_clock::now();
+        while (!stop_signal)
+        {
+            if (receiver->receive(message, 200))
+            {
+                const int64_t now = ResultLink::now_ns();
+                link_ns.push_back(now - message.header.publish_ns);
+                total_ns.push_back(now - message.header.capture_ns);
+                if (last_frame != 0 && message.header.frame_id > last_frame + 1)
+                {
+                    lost += message.header.frame_id - last_frame - 1;
+                }
+                last_frame = message.header.frame_id;
+                received++;
+                if (options.verbose)
+                {
+                    print_message(message);
+                }
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double>(now - window_start).count();
+            if (elapsed >= 1.0)
+            {
+                std::printf("%.1f 条/s  发送->接收 p50 %.1f us p99 %.1f us  采集->接收 p50 %.2f ms  已收 %llu  丢失 %llu  无效 %llu\n",
+                            link_ns.size() / elapsed, percentile_us(link_ns, 0.5), percentile_us(link_ns, 0.99),
+                            percentile_us(total_ns, 0.5) * 1e-3, static_cast<unsigned long long>(received),
+                            static_cast<unsigned long long>(lost), static_cast<unsigned long long>(receiver->get_invalid()));
+                link_ns.clear();
+                total_ns.clear();
+                window_start = now;
+            }
+        }
+        return 0;
+    }
+
+    int bench(const Options &options)
+    {
+        auto receiver = ResultLink::Receiver::bind(options.bench_uri);
+        auto transport = ResultLink::open_transport(options.bench_uri);
+        if (!receiver || !transport)
+        {
+            return 1;
+        }
+        ResultLink::Publisher publisher(std::move(transport));
+
+        // 接收线程先启动,记录每条消息的延迟
+        std::vector<int64_t> latencies_ns;
+        latencies_ns.reserve(options.count);
+        std::atomic<bool> sending{true};
+        std::thread receive_thread([&]()
+                                   {
+            ResultLink::Message message;
+            while (receiver->receive(message, 100) || sending)
+            {
+                if (message.header.frame_id != 0)
+                {
+                    latencies_ns.push_back(ResultLink::now_ns() - message.header.publish_ns);
+                    message.header.frame_id = 0;
+                }
+            } });
+
+        // 按固定频率发送,测的是单条延迟而不是缓冲区排队
+        const auto start = std::chrono::steady_clock::now();
+        const std::chrono::duration<double> period(options.rate > 0 ? 1.0 / options.rate : 0.0);
+        for (int i = 1; i <= options.count && !stop_signal; i++)
+        {
+            if (options.rate > 0)
+            {
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * (i - 1)));
+            }
+            publisher.begin(i, ResultLink::now_ns());
+            for (int k = 0; k < options.armors; k++)
+            {
+                ResultLink::ArmorRecord *armor = publisher.add();
+                armor->class_id = k;
+                armor->track_id = k;
+                armor->pose_valid = 1;
+                armor->distance = 3.0f;
+            }
+            publisher.send();
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sending = false;
+        receive_thread.join();
+
+        std::printf("%s: %d 条消息, 每条 %zu 字节\n", options.bench_uri.c_str(), options.count, ResultLink::message_bytes(options.armors));
+        std::printf("发送 %llu 条, 发送失败 %llu 条, 收到 %zu 条, 发送速率 %.0f 条/s\n",
+                    static_cast<unsigned long long>(publisher.get_sent()), static_cast<unsigned long long>(publisher.get_dropped()),
+                    latencies_ns.size(), options.count / elapsed);
+        std::printf("发送->接收延迟 p50 %.1f us  p90 %.1f us  p99 %.1f us  p99.9 %.1f us\n",
+                    percentile_us(latencies_ns, 0.5), percentile_us(latencies_ns, 0.9),
+                    percentile_us(latencies_ns, 0.99), percentile_us(latencies_ns, 0.999));
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char const *argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cout << "用法: result_link_probe --listen <地址> [--verbose]\n"
+                  << "      result_link_probe --bench <地址> [--count N] [--armors K] [--rate Hz]\n"
+                  << "地址: udp://127.0.0.1:9000 或 unix:///tmp/task8_results.sock" << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, handle_signal);
+    return options.listen_uri.empty() ? bench(options) : listen(options);
+}
@@ -0,0 +1,311 @@
+#include "Pipeline.h"
+#include "ThreadPlacement.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+// 线程布局的抖动测试: 与Task8相同的流水线结构(capture -> infer -> postprocess),
+// capture按固定频率用绝对时间唤醒(模拟相机帧),infer做固定计算量的合成负载,postprocess记录延迟
+// 后台负载线程模拟OpenVINO工作线程和其他进程,持续大块内存拷贝
+// 分别在不使用布局(off)和使用布局(on,负载线程限定在ov的cpu上)时运行,输出帧间隔和延迟的分位数
+//
+// rt_jitter [--mode off|on|both] [--rt <布局>] [--lock] [--rate Hz] [--seconds S] [--work-us N] [--load N]
+//   --rt 格式与Task8相同,默认按cpu数生成: capture=0:80,infer=1:70,postprocess=2:60,ov=3-(n-1)
+//   SCHED_FIFO需要root/CAP_SYS_NICE或ulimit -r,失败时只限定cpu
+
+namespace
+{
+    struct Options
+    {
+        std::string mode = "both";
+        std::string rt_spec;
+        bool lock = false;
+        double rate = 200.0;  // 帧率(Hz)
+        double seconds = 5.0; // 每次运行的时长
+        int work_us = 2000;   // infer阶段每帧的计算量(空载时的耗时)
+        int load = -1;        // 后台负载线程数,-1为cpu数
+    };
+
+    bool parse_options(int argc, char const *argv[], Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string
+            { return i + 1 < argc ? argv[++i] : ""; };
+
+            if (arg == "--mode") options.mode = next();
+            else if (arg == "--rt") options.rt_spec = next();
+            else if (arg == "--lock") options.lock = true;
+            else if (arg == "--rate") options.rate = std::max(1.0, std::stod(next()));
+            else if (arg == "--seconds") options.seconds = std::max(0.1, std::stod(next()));
+            else if (arg == "--work-us") options.work_us = std::max(0, std::stoi(next()));
+            else if (arg == "--load") options.load = std::max(0, std::stoi(next()));
+            else
+            {
+                return false;
+            }
+        }
+        return options.mode == "off" || options.mode == "on" || options.mode == "both";
+    }
+
+    // 按cpu数生成默认布局: 流水线各占一个核,其余给负载线程
+    std::string default_spec(int cpus)
+    {
+        if (cpus >= 4)
+        {
+            return "capture=0:80,infer=1:70,postprocess=2:60,ov=3-" + std::to_string(cpus - 1);
+        }
+        // 核数不够分开时只设置优先级
+        return "capture=:80,infer=:70,postprocess=:60";
+    }
+
+    int64_t now_ns()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // 合成负载: 反复遍历一块与推理中间数据相当的内存,对缓存和调度干扰敏感
+    struct SyntheticWork
+    {
+        std::vector<float> buffer = std::vector<float>(64 * 1024);
+        int rounds = 0;
+
+        float run() const
+        {
+            float sum = 0.0f;
+            for (int r = 0; r < rounds; r++)
+            {
+                for (size_t i = 0; i < buffer.size(); i += 16)
+                {
+                    sum += buffer[i] * 0.5f;
+                }
+            }
+            return sum;
+        }
+
+        // 空载时标定轮数,使一次run约为work_us
+        void calibrate(int work_us)
+        {
+            rounds = 64;
+            const int64_t start = now_ns();
+            volatile float sink = run();
+            (void)sink;
+            const double per_round_us = (now_ns() - start) * 1e-3 / rounds;
+            rounds = per_round_us > 0.0 ? std::max(0, static_cast<int>(work_us / per_round_us)) : 0;
+        }
+    };
+
+    struct Tick
+    {
+        int index = -1;
+        int64_t scheduled_ns = 0; // 计划的采集时间
+        int64_t woke_ns = 0;      // 实际唤醒的时间
+    };
+
+    struct Result
+    {
+        std::vector<int64_t> interval_ns; // 相邻两帧的唤醒间隔
+        std::vector<int64_t> wake_ns;     // 唤醒相对计划的延迟
+        std::vector<int64_t> latency_ns;  // 计划采集到postprocess完成
+        uint64_t dropped = 0;
+    };
+
+    // 排序后的分位数(us)
+    double percentile_us(std::vector<int64_t> values, double p)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index] * 1e-3;
+    }
+
+    double max_us(const std::vector<int64_t> &values)
+    {
+        return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end()) * 1e-3;
+    }
+
+    void print_row(const char *mode, const char *metric, const std::vector<int64_t> &values)
+    {
+        std::printf("%-4s %-14s %10.1f %10.1f %10.1f %10.1f\n", mode, metric, percentile_us(values, 0.5),
+                    percentile_us(values, 0.99), percentile_us(values, 0.999), max_us(values));
+    }
+
+    Result run(const Options &options, const ThreadPlacement::Config *placement, const SyntheticWork &work)
+    {
+        const int frames = static_cast<int>(options.rate * options.seconds);
+        const int64_t period_ns = static_cast<int64_t>(1e9 / options.rate);
+        std::vector<int64_t> woke(frames, 0), scheduled(frames, 0), done(frames, 0);
+
+        // 负载线程: 使用布局时在ov的cpu上创建,与Task8中OpenVINO工作线程的限定方式相同
+        std::atomic<bool> loading{true};
+        std::vector<std::thread> load_threads;
+        {
+            const ThreadPlacement::ThreadSpec *ov_spec = placement ? placement->find("ov") : nullptr;
+            ThreadPlacement::ScopedAffinity fence(ov_spec ? ov_spec->cpus : std::vector<int>());
+            const int load = options.load >= 0 ? options.load : static_cast<int>(std::thread::hardware_concurrency());
+            for (int i = 0; i < load; i++)
+            {
+                load_threads.emplace_back([&loading]()
+                                          {
+                    std::vector<char> src(16 << 20, 1), dst(16 << 20);
+                    while (loading.load(std::memory_order_relaxed))
+                    {
+                        std::memcpy(dst.data(), src.data(), src.size());
+                    } });
+            }
+        }
+
+        Pipeline::Pipeline<Tick> pipeline;
+        if (placement)
+        {
+            pipeline.set_thread_init([placement](const std::string &name)
+                                     {
+                if (const ThreadPlacement::ThreadSpec *spec = placement->find(name))
+                {
+                    ThreadPlacement::apply_to_current_thread(name, *spec);
+                } });
+        }
+
+        // 采集: 按绝对时间唤醒,不累积误差
+        int next_index = 0;
+        int64_t start_ns = 0;
+        pipeline.set_source("capture", [&](Tick &tick)
+                            {
+            if (next_index >= frames)
+            {
+                return false;
+            }
+            if (next_index == 0)
+            {
+                start_ns = now_ns() + period_ns;
+            }
+            tick.index = next_index++;
+            tick.scheduled_ns = start_ns + tick.index * period_ns;
+            timespec ts;
+            ts.tv_sec = tick.scheduled_ns / 1000000000;
+            ts.tv_nsec = tick.scheduled_ns % 1000000000;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+            {
+            }
+            tick.woke_ns = now_ns();
+            return true; });
+
+        pipeline.add_stage("infer", [&work](Tick &)
+                           {
+            volatile float sink = work.run();
+            (void)sink;
+            return true; }, {2, Pipeline::keep_latest});
+
+        pipeline.add_stage("postprocess", [&](Tick &tick)
+                           {
+            scheduled[tick.index] = tick.scheduled_ns;
+            woke[tick.index] = tick.woke_ns;
+            done[tick.index] = now_ns();
+            return true; }, {2, Pipeline::block});
+
+        pipeline.start();
+        pipeline.wait();
+        loading = false;
+        for (std::thread &thread : load_threads)
+        {
+            thread.join();
+        }
+        Pipeline::print_stats(pipeline.get_stats());
+
+        // 只统计走完流水线的帧,帧间隔按唤醒时间计算(与下游是否丢帧无关)
+        Result result;
+        int64_t last_woke = 0;
+        for (int i = 0; i < frames; i++)
+        {
+            if (done[i] == 0)
+            {
+                result.dropped++;
+                continue;
+            }
+            if (last_woke != 0)
+            {
+                result.interval_ns.push_back(woke[i] - last_woke);
+            }
+            last_woke = woke[i];
+            result.wake_ns.push_back(woke[i] - scheduled[i]);
+            result.latency_ns.push_back(done[i] - scheduled[i]);
+        }
+        return result;
+    }
+} // namespace
+
+int main(int argc, char const *argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cout << "用法: rt_jitter [--mode off|on|both] [--rt <布局>] [--lock] [--rate Hz] [--seconds S] [--work-us N] [--load N]" << std::endl;
+        return 1;
+    }
+    const int cpus = static_cast<int>(std::thread::hardware_concurrency());
+    if (options.rt_spec.empty())
+    {
+        options.rt_spec = default_spec(cpus);
+    }
+    ThreadPlacement::Config placement;
+    if (!ThreadPlacement::Config::parse(options.rt_spec, placement))
+    {
+        return 1;
+    }
+
+    SyntheticWork work;
+    work.calibrate(options.work_us);
+    std::printf("%d 个cpu, %.0f Hz, 每次 %.1f s, 每帧计算 %d us, 负载线程 %d\n", cpus, options.rate, options.seconds,
+                options.work_us, options.load >= 0 ? options.load : cpus);
+
+    Result off, on;
+    if (options.mode != "on")
+    {
+        std::printf("---------- off: 默认调度,线程不绑核 ----------\n");
+        off = run(options, nullptr, work);
+    }
+    if (options.mode != "off")
+    {
+        std::printf("---------- on: %s%s ----------\n", options.rt_spec.c_str(), options.lock ? " + mlockall" : "");
+        placement.print();
+        if (options.lock)
+        {
+            ThreadPlacement::lock_memory();
+        }
+        on = run(options, &placement, work);
+    }
+
+    std::printf("========== 抖动统计(us) ==========\n");
+    std::printf("周期 %.1f us\n", 1e6 / options.rate);
+    std::printf("%-4s %-14s %10s %10s %10s %10s\n", "", "", "p50", "p99", "p99.9", "max");
+    if (options.mode != "on")
+    {
+        print_row("off", "帧间隔", off.interval_ns);
+        print_row("off", "唤醒延迟", off.wake_ns);
+        print_row("off", "端到端延迟", off.latency_ns);
+    }
+    if (options.mode != "off")
+    {
+        print_row("on", "帧间隔", on.interval_ns);
+        print_row("on", "唤醒延迟", on.wake_ns);
+        print_row("on", "端到端延迟", on.latency_ns);
+    }
+    if (options.mode == "both")
+    {
+        std::printf("丢帧 off %llu, on %llu\n", static_cast<unsigned long long>(off.dropped), static_cast<unsigned long long>(on.dropped));
+    }
+    return 0;
+}
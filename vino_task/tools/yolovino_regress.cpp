@@ -0,0 +1,387 @@
+#include "yolo_vino.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+
+// 检测结果回归工具: 把一组图片的NNDetectData与保存的golden文件比较,同时比较延迟
+// 生成golden: yolovino_regress --model v5 --golden <目录> --update
+// 检查:       yolovino_regress --model v5 --golden <目录> [--frames <图片目录>]
+// 另外对每个检测在远离原点的裁剪区域上重新推理,必须检出同一个装甲板(检查roi偏移的处理)
+// 精度超出容差、裁剪区域漏检或延迟变慢超过阈值时返回1
+
+namespace
+{
+    struct Options
+    {
+        std::string model = "v8";                    // v8或v5
+        std::string config;                          // 配置文件,为空时使用默认配置
+        std::string frames_dir;                      // 额外的图片目录
+        std::string golden_dir = "golden";           // golden文件目录
+        bool update = false;                         // 重新生成golden
+        int repeat = 5;                              // 每张图推理次数,取中位数延迟
+        float box_tol = 2.0f;                        // 框的像素容差
+        float kpt_tol = 2.0f;                        // 关键点的像素容差
+        float conf_tol = 0.02f;                      // 置信度容差
+        float latency_tol = 0.2f;                    // 总延迟允许变慢的比例
+        float crop_iou = 0.5f;                       // 裁剪区域的检测与整帧检测的IoU下限,0为不检查
+    };
+
+    struct FrameResult
+    {
+        std::vector<YoloVino::NNDetectData> detections;
+        double latency_us = 0.0; // 中位数延迟
+    };
+
+    void print_usage()
+    {
+        std::cout << "用法: yolovino_regress --model v8|v5 [--config yaml] [--frames 目录] --golden 目录 [--update]\n"
+                  << "                       [--repeat N] [--box-tol px] [--kpt-tol px] [--conf-tol c] [--latency-tol r] [--crop-iou r]\n";
+    }
+
+    bool parse_options(int argc, char const *argv[], Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string
+            { return i + 1 < argc ? argv[++i] : ""; };
+
+            if (arg == "--model") options.model = next();
+            else if (arg == "--config") options.config = next();
+            else if (arg == "--frames") options.frames_dir = next();
+            else if (arg == "--golden") options.golden_dir = next();
+            else if (arg == "--update") options.update = true;
+            else if (arg == "--repeat") options.repeat = std::max(1, std::stoi(next()));
+            else if (arg == "--box-tol") options.box_tol = std::stof(next());
+            else if (arg == "--kpt-tol") options.kpt_tol = std::stof(next());
+            else if (arg == "--conf-tol") options.conf_tol = std::stof(next());
+            else if (arg == "--latency-tol") options.latency_tol = std::stof(next());
+            else if (arg == "--crop-iou") options.crop_iou = std::stof(next());
+            else
+            {
+                return false;
+            }
+        }
+        return options.model == "v8" || options.model == "v5";
+    }
+
+    std::unique_ptr<YoloVino::YoloVino> make_detector(const Options &options)
+    {
+        std::string config = options.config;
+        if (config.empty())
+        {
+            config = std::string(YOLOVINO_CONFIG_DIR) +
+                     (options.model == "v8" ? "/yolov8pose_vino_config.yaml" : "/yolov5fourpoint_vino_config.yaml");
+        }
+        auto logger = std::make_unique<YoloVino::YoloVinoLogger>(config);
+        logger->set_info_level(YoloVino::LoggerInfoLevel::warning_info);
+        if (options.model == "v8")
+        {
+            return std::make_unique<YoloVino::Yolov8poseVino>(std::move(logger));
+        }
+        return std::make_unique<YoloVino::Yolov5fourpointVino>(std::move(logger));
+    }
+
+    // 测试图片加上frames目录下的全部图片,按文件名排序保证顺序固定
+    std::vector<std::string> list_frames(const Options &options)
+    {
+        std::vector<std::string> frames;
+        if (!options.frames_dir.empty())
+        {
+            for (const char *pattern : {"/*.png", "/*.jpg", "/*.bmp"})
+            {
+                std::vector<cv::String> found;
+                cv::glob(options.frames_dir + pattern, found, false);
+                frames.insert(frames.end(), found.begin(), found.end());
+            }
+            std::sort(frames.begin(), frames.end());
+        }
+        frames.insert(frames.begin(), YOLOVINO_TEST_IMG);
+        return frames;
+    }
+
+    std::string golden_name(const std::string &frame_path)
+    {
+        std::string name = frame_path.substr(frame_path.find_last_of('/') + 1);
+        return name.substr(0, name.find_last_of('.')) + ".yml";
+    }
+
+    FrameResult run_frame(YoloVino::YoloVino &vino, const cv::Mat &img, int repeat)
+    {
+        FrameResult result;
+        std::vector<double> latencies;
+        for (int i = 0; i < repeat; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            result.detections = vino.safe_predict(img, cv::Rect(0, 0, img.cols, img.rows));
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::nth_element(latencies.begin(), latencies.begin() + latencies.size() / 2, latencies.end());
+        result.latency_us = latencies[latencies.size() / 2];
+
+        // 按置信度排序,便于比较和阅读
+        std::sort(result.detections.begin(), result.detections.end(),
+                  [](const YoloVino::NNDetectData &a, const YoloVino::NNDetectData &b)
+                  { return a.confidence > b.confidence; });
+        return result;
+    }
+
+    // 打不开文件时返回false
+    bool write_golden(const std::string &path, const FrameResult &result)
+    {
+        cv::FileStorage fs(path, cv::FileStorage::WRITE);
+        if (!fs.isOpened())
+        {
+            return false;
+        }
+        fs << "latency_us" << result.latency_us;
+        fs << "detections" << "[";
+        for (const auto &det : result.detections)
+        {
+            fs << "{";
+            fs << "class_id" << det.class_id;
+            fs << "confidence" << det.confidence;
+            fs << "rect" << det.rect;
+            fs << "keypoints" << std::vector<cv::Point3f>(det.keypoints.begin(), det.keypoints.end());
+            fs << "}";
+        }
+        fs << "]";
+        return true;
+    }
+
+    bool read_golden(const std::string &path, FrameResult &result)
+    {
+        cv::FileStorage fs(path, cv::FileStorage::READ);
+        if (!fs.isOpened())
+        {
+            return false;
+        }
+        fs["latency_us"] >> result.latency_us;
+        for (const auto &node : fs["detections"])
+        {
+            YoloVino::NNDetectData det;
+            node["class_id"] >> det.class_id;
+            node["confidence"] >> det.confidence;
+            node["rect"] >> det.rect;
+            std::vector<cv::Point3f> keypoints;
+            node["keypoints"] >> keypoints;
+            for (size_t k = 0; k < keypoints.size() && k < det.keypoints.size(); k++)
+            {
+                det.keypoints[k] = keypoints[k];
+            }
+            result.detections.push_back(det);
+        }
+        return true;
+    }
+
+    float rect_distance(const cv::Rect &a, const cv::Rect &b)
+    {
+        return std::max({std::abs(a.x - b.x), std::abs(a.y - b.y),
+                         std::abs(a.br().x - b.br().x), std::abs(a.br().y - b.br().y)});
+    }
+
+    float keypoint_distance(const YoloVino::NNDetectData &a, const YoloVino::NNDetectData &b)
+    {
+        float distance = 0.0f;
+        for (size_t i = 0; i < a.keypoints.size(); i++)
+        {
+            distance = std::max(distance, static_cast<float>(cv::norm(cv::Point2f(a.keypoints[i].x - b.keypoints[i].x,
+                                                                                  a.keypoints[i].y - b.keypoints[i].y))));
+        }
+        return distance;
+    }
+
+    float rect_iou(const cv::Rect &a, const cv::Rect &b)
+    {
+        const float inter = static_cast<float>((a & b).area());
+        const float uni = static_cast<float>(a.area() + b.area()) - inter;
+        return uni > 0.0f ? inter / uni : 0.0f;
+    }
+
+    // 对每个整帧检测,以它为中心取3倍大小的裁剪区域重新推理,裁剪区域不含原点时必须检出同类别、IoU够高的装甲板
+    // 返回漏检的数目; 用于发现只在roi为整帧时才正确的坐标处理
+    int check_crops(YoloVino::YoloVino &vino, const std::string &name, const cv::Mat &img, const FrameResult &full, const Options &options)
+    {
+        if (options.crop_iou <= 0.0f)
+        {
+            return 0;
+        }
+        int failures = 0;
+        const cv::Rect img_bound(0, 0, img.cols, img.rows);
+        std::vector<YoloVino::NNDetectData> cropped;
+        for (const auto &expected : full.detections)
+        {
+            const cv::Rect &rect = expected.rect;
+            const cv::Rect crop = cv::Rect(rect.x - rect.width, rect.y - rect.height, rect.width * 3, rect.height * 3) & img_bound;
+            if (crop.x == 0 && crop.y == 0)
+            {
+                continue;
+            }
+
+            cropped = vino.safe_predict(img, crop);
+            const bool found = std::any_of(cropped.begin(), cropped.end(), [&](const YoloVino::NNDetectData &det)
+                                           { return det.class_id == expected.class_id && rect_iou(det.rect, expected.rect) >= options.crop_iou; });
+            if (!found)
+            {
+                std::cout << "  [FAIL] " << name << ": 裁剪区域 " << crop << " 内没有检出 class " << expected.class_id
+                          << " rect " << expected.rect << "\n";
+                failures++;
+            }
+        }
+        return failures;
+    }
+
+    // 每个golden检测找同类别、框最接近的当前检测,返回不一致的条数
+    int compare_frame(const std::string &name, const FrameResult &golden, const FrameResult &current, const Options &options)
+    {
+        int failures = 0;
+        std::vector<bool> used(current.detections.size(), false);
+        for (const auto &expected : golden.detections)
+        {
+            int best = -1;
+            float best_distance = std::numeric_limits<float>::infinity();
+            for (size_t i = 0; i < current.detections.size(); i++)
+            {
+                if (used[i] || current.detections[i].class_id != expected.class_id)
+                {
+                    continue;
+                }
+                float distance = rect_distance(current.detections[i].rect, expected.rect);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best = static_cast<int>(i);
+                }
+            }
+
+            if (best < 0)
+            {
+                std::cout << "  [FAIL] " << name << ": 丢失检测 class " << expected.class_id << " rect " << expected.rect << "\n";
+                failures++;
+                continue;
+            }
+            used[best] = true;
+
+            const auto &actual = current.detections[best];
+            float kpt_distance = keypoint_distance(actual, expected);
+            float conf_diff = std::abs(actual.confidence - expected.confidence);
+            if (best_distance > options.box_tol || kpt_distance > options.kpt_tol || conf_diff > options.conf_tol)
+            {
+                std::cout << "  [FAIL] " << name << ": class " << expected.class_id
+                          << " 框偏差 " << best_distance << "px, 关键点偏差 " << kpt_distance
+                          << "px, 置信度偏差 " << conf_diff << "\n";
+                failures++;
+            }
+        }
+
+        for (size_t i = 0; i < current.detections.size(); i++)
+        {
+            if (!used[i])
+            {
+                std::cout << "  [FAIL] " << name << ": 多出检测 class " << current.detections[i].class_id
+                          << " rect " << current.detections[i].rect << "\n";
+                failures++;
+            }
+        }
+        return failures;
+    }
+} // namespace
+
+int main(int argc, char const *argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage();
+        return 2;
+    }
+
+    std::unique_ptr<YoloVino::YoloVino> vino = make_detector(options);
+    std::vector<std::string> frames = list_frames(options);
+
+    // 生成golden时先创建目录(新检出的仓库中没有)
+    if (options.update)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(options.golden_dir, error);
+        if (error)
+        {
+            std::cout << "无法创建golden目录 " << options.golden_dir << ": " << error.message() << "\n";
+            return 1;
+        }
+    }
+
+    // 先推理一次,避免首帧的初始化耗时计入延迟
+    vino->safe_predict(cv::Mat(640, 640, CV_8UC3, cv::Scalar(124, 124, 124)), cv::Rect(0, 0, 640, 640));
+
+    int accuracy_failures = 0;
+    int crop_failures = 0;
+    int missing_golden = 0;
+    int write_failures = 0;
+    double golden_latency = 0.0;
+    double current_latency = 0.0;
+    for (const std::string &frame : frames)
+    {
+        cv::Mat img = cv::imread(frame);
+        if (img.empty())
+        {
+            std::cout << "  [SKIP] 无法读取 " << frame << "\n";
+            continue;
+        }
+
+        const std::string name = golden_name(frame);
+        const std::string golden_path = options.golden_dir + "/" + name;
+        FrameResult current = run_frame(*vino, img, options.repeat);
+        crop_failures += check_crops(*vino, name, img, current, options);
+
+        if (options.update)
+        {
+            if (!write_golden(golden_path, current))
+            {
+                std::cout << "  [FAIL] 无法写入 " << golden_path << "\n";
+                write_failures++;
+                continue;
+            }
+            std::cout << "  [UPDATE] " << name << ": " << current.detections.size() << " 个检测, "
+                      << current.latency_us << " us\n";
+            continue;
+        }
+
+        FrameResult golden;
+        if (!read_golden(golden_path, golden))
+        {
+            std::cout << "  [FAIL] 缺少golden文件 " << golden_path << "\n";
+            missing_golden++;
+            continue;
+        }
+
+        accuracy_failures += compare_frame(name, golden, current, options);
+        golden_latency += golden.latency_us;
+        current_latency += current.latency_us;
+    }
+
+    if (options.update)
+    {
+        if (write_failures)
+        {
+            std::cout << write_failures << " 个golden文件写入失败\n";
+            return 1;
+        }
+        std::cout << "golden已写入 " << options.golden_dir << "\n";
+        return crop_failures ? 1 : 0;
+    }
+
+    bool latency_regressed = golden_latency > 0.0 && current_latency > golden_latency * (1.0 + options.latency_tol);
+    std::cout << "========== 回归结果 ==========\n"
+              << "图片数       : " << frames.size() << "\n"
+              << "精度不一致   : " << accuracy_failures << "\n"
+              << "裁剪区域漏检 : " << crop_failures << "\n"
+              << "缺少golden   : " << missing_golden << "\n"
+              << "总延迟(us)   : " << current_latency << " (golden " << golden_latency << ", 允许 +"
+              << options.latency_tol * 100 << "%)\n"
+              << "结论         : " << ((accuracy_failures || crop_failures || missing_golden || latency_regressed) ? "FAIL" : "PASS") << "\n";
+
+    return (accuracy_failures || crop_failures || missing_golden || latency_regressed) ? 1 : 0;
+}